@@ -23,6 +23,10 @@
 //----------------------------------------------------------------------
 
 #include "AxesFinder.hh"
+#include "MinimizationKernels.hh"
+
+#include <algorithm>
+#include <stdint.h>
 
 FASTJET_BEGIN_NAMESPACE      // defined in fastjet/internal/base.hh
 
@@ -34,127 +38,113 @@ namespace contrib{
 //
 ///////
 
+// Below this many axes, the vectorized comparison with every axis beats the AxisGrid lookup
+static const unsigned grid_min_axes = 16;
+
 // Given starting axes, update to find better axes by using Kmeans clustering around the old axes
+// The assignment and the weighted sums are done by the vectorized kernels in MinimizationKernels.hh
 template <int N>
-std::vector<LightLikeAxis> AxesFinderFromOnePassMinimization::UpdateAxesFast(const std::vector <LightLikeAxis> & old_axes, 
-                                  const std::vector <fastjet::PseudoJet> & inputJets) const {
+void AxesFinderFromOnePassMinimization::UpdateAxesFast(const std::vector <LightLikeAxis> & old_axes,
+                                                       std::vector <LightLikeAxis> & new_axes,
+                                                       kernels::MinimizationWorkspace & workspace,
+                                                       kernels::ReassignmentState * incremental) const {
    assert(old_axes.size() == N);
    
-   // some storage, declared static to save allocation/re-allocation costs
-   static LightLikeAxis new_axes[N];
-   static fastjet::PseudoJet new_jets[N];
-   for (int n = 0; n < N; ++n) {
-      new_axes[n].reset(0.0,0.0,0.0,0.0);
-      new_jets[n].reset_momentum(0.0,0.0,0.0,0.0);
+   double old_rap[N], old_phi[N];
+   for (int k = 0; k < N; ++k) {
+      old_rap[k] = old_axes[k].rap();
+      old_phi[k] = old_axes[k].phi();
    }
-
-   double precision = _precision;
    
-   /////////////// Assignment Step //////////////////////////////////////////////////////////
-   std::vector<int> assignment_index(inputJets.size()); 
-   int k_assign = -1;
-   
-   for (unsigned i = 0; i < inputJets.size(); i++){
-      double smallestDist = std::numeric_limits<double>::max();  //large number
-      for (int k = 0; k < N; k++) {
-         double thisDist = old_axes[k].DistanceSq(inputJets[i]);
-         if (thisDist < smallestDist) {
-            smallestDist = thisDist;
-            k_assign = k;
-         }
+   kernels::AxisSums sums[N];
+   if (_single_precision && !incremental) {
+      // Same steps in single precision, with twice as many particles per vector;
+      // only the per-axis sums are added up in double
+      float old_rap_float[N], old_phi_float[N];
+      for (int k = 0; k < N; ++k) {
+         old_rap_float[k] = old_rap[k];
+         old_phi_float[k] = old_phi[k];
+      }
+      kernels::assign_to_axes<N>(workspace.particlesFloat(), old_rap_float, old_phi_float, (float) sq(_Rcutoff),
+                                 workspace.assignment(), workspace.distSqFloat());
+      kernels::update_weights(workspace.distSqFloat(), workspace.size(), _beta, sq(_precision), workspace.weightFloat());
+      kernels::accumulate_axes<N>(workspace.particlesFloat(), workspace.assignment(), workspace.weightFloat(), old_phi_float, sums);
+   } else {
+      /////////////// Assignment Step //////////////////////////////////////////////////////////
+      if (incremental) {
+         // only particles close to a boundary are reassigned
+         kernels::reassign_incremental<N>(workspace.particles(), old_rap, old_phi, _Rcutoff, *incremental,
+                                          workspace.assignment(), workspace.distSq(), workspace.margin());
+      } else if (AxisGrid::worthwhile(workspace.size(), N, grid_min_axes)
+                 && workspace.grid().reset(old_rap, old_phi, N, workspace.particles().rap_min(),
+                                           workspace.particles().rap_max(), sq(_Rcutoff), workspace.size())) {
+         // many axes: only compare with the axes near each particle
+         kernels::assign_with_grid(workspace.particles(), workspace.grid(), old_rap, old_phi, sq(_Rcutoff),
+                                   workspace.assignment(), workspace.distSq());
+      } else {
+         // distance to every axis for several particles at once, branch-free argmin
+         kernels::assign_to_axes<N>(workspace.particles(), old_rap, old_phi, sq(_Rcutoff),
+                                    workspace.assignment(), workspace.distSq());
       }
-      if (smallestDist > sq(_Rcutoff)) {k_assign = -1;}
-      assignment_index[i] = k_assign;
-   }
    
-   //////////////// Update Step /////////////////////////////////////////////////////////////
-   double distPhi, old_dist;
-   for (unsigned i = 0; i < inputJets.size(); i++) {
-      int old_jet_i = assignment_index[i];
-      if (old_jet_i == -1) {continue;}
-
-      const fastjet::PseudoJet& inputJet_i = inputJets[i];
-      LightLikeAxis& new_axis_i = new_axes[old_jet_i];
-      double inputPhi_i = inputJet_i.phi();
-      double inputRap_i = inputJet_i.rap();
-            
-      // optimize pow() call
+      //////////////// Update Step /////////////////////////////////////////////////////////////
       // add noise (the precision term) to make sure we don't divide by zero
-      if (_beta == 1.0) {
-         double DR = std::sqrt(sq(precision) + old_axes[old_jet_i].DistanceSq(inputJet_i));
-         old_dist = 1.0/DR;
-      } else if (_beta == 2.0) {
-         old_dist = 1.0;
-      } else if (_beta == 0.0) {
-         double DRSq = sq(precision) + old_axes[old_jet_i].DistanceSq(inputJet_i);
-         old_dist = 1.0/DRSq;
+      if (incremental) {
+         // frozen axes get no particles, so they keep their old position below
+         kernels::accumulate_incremental<N>(workspace.particles(), workspace.assignment(), workspace.distSq(),
+                                            _beta, sq(_precision), *incremental, old_phi, sums);
       } else {
-         old_dist = sq(precision) + old_axes[old_jet_i].DistanceSq(inputJet_i);
-         old_dist = std::pow(old_dist, (0.5*_beta-1.0));
-      }
-      
-      // TODO:  Put some of these addition functions into light-like axes
-      // rapidity sum
-      new_axis_i.set_rap(new_axis_i.rap() + inputJet_i.perp() * inputRap_i * old_dist);
-      // phi sum
-      distPhi = inputPhi_i - old_axes[old_jet_i].phi();
-      if (fabs(distPhi) <= M_PI){
-         new_axis_i.set_phi( new_axis_i.phi() + inputJet_i.perp() * inputPhi_i * old_dist );
-      } else if (distPhi > M_PI) {
-         new_axis_i.set_phi( new_axis_i.phi() + inputJet_i.perp() * (-2*M_PI + inputPhi_i) * old_dist );
-      } else if (distPhi < -M_PI) {
-         new_axis_i.set_phi( new_axis_i.phi() + inputJet_i.perp() * (+2*M_PI + inputPhi_i) * old_dist );
+         kernels::update_weights(workspace.distSq(), workspace.size(), _beta, sq(_precision), workspace.weight());
+         kernels::accumulate_axes<N>(workspace.particles(), workspace.assignment(), workspace.weight(), old_phi, sums);
       }
-      // weights sum
-      new_axis_i.set_weight( new_axis_i.weight() + inputJet_i.perp() * old_dist );
-      // momentum magnitude sum
-      new_jets[old_jet_i] += inputJet_i;
    }
+   
    // normalize sums
+   new_axes.resize(N);
    for (int k = 0; k < N; k++) {
-      if (new_axes[k].weight() == 0) {
+      if (sums[k].weight == 0) {
          // no particles were closest to this axis!  Return to old axis instead of (0,0,0,0)
          new_axes[k] = old_axes[k];
       } else {
-         new_axes[k].set_rap( new_axes[k].rap() / new_axes[k].weight() );
-         new_axes[k].set_phi( new_axes[k].phi() / new_axes[k].weight() );
+         new_axes[k].set_rap( sums[k].rap / sums[k].weight );
+         new_axes[k].set_phi( sums[k].phi / sums[k].weight );
          new_axes[k].set_phi( std::fmod(new_axes[k].phi() + 2*M_PI, 2*M_PI) );
-         new_axes[k].set_mom( std::sqrt(new_jets[k].modp2()) );
+         new_axes[k].set_weight( sums[k].weight );
+         new_axes[k].set_mom( std::sqrt(sq(sums[k].px) + sq(sums[k].py) + sq(sums[k].pz)) );
       }
    }
-   std::vector<LightLikeAxis> new_axes_vec(N);
-   for (unsigned k = 0; k < N; ++k) new_axes_vec[k] = new_axes[k];
-   return new_axes_vec;
 }
 
 // Given N starting axes, this function updates all axes to find N better axes. 
 // (This is just a wrapper for the templated version above.)
-std::vector<LightLikeAxis> AxesFinderFromOnePassMinimization::UpdateAxes(const std::vector <LightLikeAxis> & old_axes,
-                                      const std::vector <fastjet::PseudoJet> & inputJets) const {
+void AxesFinderFromOnePassMinimization::UpdateAxes(const std::vector <LightLikeAxis> & old_axes,
+                                                   std::vector <LightLikeAxis> & new_axes,
+                                                   kernels::MinimizationWorkspace & workspace,
+                                                   kernels::ReassignmentState * incremental) const {
    int N = old_axes.size();
    switch (N) {
-      case 1: return UpdateAxesFast<1>(old_axes, inputJets);
-      case 2: return UpdateAxesFast<2>(old_axes, inputJets);
-      case 3: return UpdateAxesFast<3>(old_axes, inputJets);
-      case 4: return UpdateAxesFast<4>(old_axes, inputJets);
-      case 5: return UpdateAxesFast<5>(old_axes, inputJets);
-      case 6: return UpdateAxesFast<6>(old_axes, inputJets);
-      case 7: return UpdateAxesFast<7>(old_axes, inputJets);
-      case 8: return UpdateAxesFast<8>(old_axes, inputJets);
-      case 9: return UpdateAxesFast<9>(old_axes, inputJets);
-      case 10: return UpdateAxesFast<10>(old_axes, inputJets);
-      case 11: return UpdateAxesFast<11>(old_axes, inputJets);
-      case 12: return UpdateAxesFast<12>(old_axes, inputJets);
-      case 13: return UpdateAxesFast<13>(old_axes, inputJets);
-      case 14: return UpdateAxesFast<14>(old_axes, inputJets);
-      case 15: return UpdateAxesFast<15>(old_axes, inputJets);
-      case 16: return UpdateAxesFast<16>(old_axes, inputJets);
-      case 17: return UpdateAxesFast<17>(old_axes, inputJets);
-      case 18: return UpdateAxesFast<18>(old_axes, inputJets);
-      case 19: return UpdateAxesFast<19>(old_axes, inputJets);
-      case 20: return UpdateAxesFast<20>(old_axes, inputJets);
+      case 1: UpdateAxesFast<1>(old_axes, new_axes, workspace, incremental); break;
+      case 2: UpdateAxesFast<2>(old_axes, new_axes, workspace, incremental); break;
+      case 3: UpdateAxesFast<3>(old_axes, new_axes, workspace, incremental); break;
+      case 4: UpdateAxesFast<4>(old_axes, new_axes, workspace, incremental); break;
+      case 5: UpdateAxesFast<5>(old_axes, new_axes, workspace, incremental); break;
+      case 6: UpdateAxesFast<6>(old_axes, new_axes, workspace, incremental); break;
+      case 7: UpdateAxesFast<7>(old_axes, new_axes, workspace, incremental); break;
+      case 8: UpdateAxesFast<8>(old_axes, new_axes, workspace, incremental); break;
+      case 9: UpdateAxesFast<9>(old_axes, new_axes, workspace, incremental); break;
+      case 10: UpdateAxesFast<10>(old_axes, new_axes, workspace, incremental); break;
+      case 11: UpdateAxesFast<11>(old_axes, new_axes, workspace, incremental); break;
+      case 12: UpdateAxesFast<12>(old_axes, new_axes, workspace, incremental); break;
+      case 13: UpdateAxesFast<13>(old_axes, new_axes, workspace, incremental); break;
+      case 14: UpdateAxesFast<14>(old_axes, new_axes, workspace, incremental); break;
+      case 15: UpdateAxesFast<15>(old_axes, new_axes, workspace, incremental); break;
+      case 16: UpdateAxesFast<16>(old_axes, new_axes, workspace, incremental); break;
+      case 17: UpdateAxesFast<17>(old_axes, new_axes, workspace, incremental); break;
+      case 18: UpdateAxesFast<18>(old_axes, new_axes, workspace, incremental); break;
+      case 19: UpdateAxesFast<19>(old_axes, new_axes, workspace, incremental); break;
+      case 20: UpdateAxesFast<20>(old_axes, new_axes, workspace, incremental); break;
       default: std::cout << "N-jettiness is hard-coded to only allow up to 20 jets!" << std::endl;
-         return std::vector<LightLikeAxis>();
+         new_axes.clear();
    }
 
 }
@@ -162,34 +152,101 @@ std::vector<LightLikeAxis> AxesFinderFromOnePassMinimization::UpdateAxes(const s
 // uses minimization of N-jettiness to continually update axes until convergence.
 // The function returns the axes found at the (local) minimum
 std::vector<fastjet::PseudoJet> AxesFinderFromOnePassMinimization::getAxes(int n_jets, const std::vector <fastjet::PseudoJet> & inputJets, const std::vector<fastjet::PseudoJet>& seedAxes) const {
+   AxesFinderWorkspace workspace;
+   std::vector<fastjet::PseudoJet> outputAxes;
+   getAxesInto(n_jets, inputJets, seedAxes, outputAxes, workspace);
+   return outputAxes;
+}
+
+void AxesFinderFromOnePassMinimization::getAxesInto(int n_jets, const std::vector <fastjet::PseudoJet> & inputJets, const std::vector<fastjet::PseudoJet>& seedAxes,
+                                                    std::vector<fastjet::PseudoJet>& outputAxes, AxesFinderWorkspace& workspace) const {
 	  
    // convert from PseudoJets to LightLikeAxes
-   std::vector< LightLikeAxis > old_axes(n_jets, LightLikeAxis(0,0,0,0));
+   std::vector< LightLikeAxis > & old_axes = workspace.oldAxes();
+   old_axes.assign(n_jets, LightLikeAxis(0,0,0,0));
    for (int k = 0; k < n_jets; k++) {
       old_axes[k].set_rap( seedAxes[k].rap() );
       old_axes[k].set_phi( seedAxes[k].phi() );
    }
    
+   // copy the particle kinematics into flat arrays once for all iterations
+   kernels::MinimizationWorkspace & minimization = workspace.minimization();
+   minimization.reset(inputJets, _single_precision && !_incremental);
+   
    // Find new axes by iterating (only one pass here)
-   std::vector< LightLikeAxis > new_axes(n_jets, LightLikeAxis(0,0,0,0));
+   std::vector< LightLikeAxis > & new_axes = workspace.newAxes();
+   new_axes.assign(n_jets, LightLikeAxis(0,0,0,0));
    double cmp = std::numeric_limits<double>::max();  //large number
    int h = 0;
-   while (cmp > _precision && h < _halt) { // Keep updating axes until near-convergence or too many update steps
-      cmp = 0.0;
-      h++;
-      new_axes = UpdateAxes(old_axes, inputJets); // Update axes
+   bool converged = false;
+   if (!_incremental || n_jets > kernels::ReassignmentState::max_axes) {
+      while (cmp > _precision && h < _halt) { // Keep updating axes until near-convergence or too many update steps
+         cmp = 0.0;
+         h++;
+         UpdateAxes(old_axes, new_axes, minimization); // Update axes
+         for (int k = 0; k < n_jets; k++) {
+            cmp += old_axes[k].Distance(new_axes[k]);
+         }
+         cmp = cmp / ((double) n_jets);
+         old_axes.swap(new_axes);
+      }
+      converged = (cmp <= _precision);
+   } else {
+      // Same iteration, but particles are only reassigned near the boundaries, and an axis is
+      // frozen once it moves less than _precision without gaining or losing particles.
+      // A frozen axis stays where it is until its particles change; when all are frozen, we are done.
+      kernels::ReassignmentState state;
+      state.first = true;
       for (int k = 0; k < n_jets; k++) {
-         cmp += old_axes[k].Distance(new_axes[k]);
+         state.move[k] = 0.0;
+         state.frozen[k] = false;
+      }
+      bool all_frozen = false;
+      while (cmp > _precision && h < _halt && !all_frozen) {
+         bool first = state.first;
+         int n_moving = 0;
+         cmp = 0.0;
+         h++;
+         // an axis that gains or loses particles in this step is thawed again
+         // (its sums are then missing from this step, so it moves on the next one)
+         UpdateAxes(old_axes, new_axes, minimization, &state);
+         all_frozen = true;
+         for (int k = 0; k < n_jets; k++) {
+            if (state.frozen[k]) {
+               new_axes[k] = old_axes[k];
+               state.move[k] = 0.0;
+               if (state.changed[k]) {
+                  state.frozen[k] = false;
+                  all_frozen = false;
+               }
+               continue;
+            }
+            state.move[k] = old_axes[k].Distance(new_axes[k]);
+            cmp += state.move[k];
+            n_moving++;
+            if (!first && !state.changed[k] && state.move[k] < _precision) state.frozen[k] = true;
+            else all_frozen = false;
+         }
+         // average over the axes that were not frozen, so frozen ones do not hide the others
+         if (n_moving > 0) cmp = cmp / ((double) n_moving);
+         old_axes.swap(new_axes);
       }
-      cmp = cmp / ((double) n_jets);
-      old_axes = new_axes;
+      converged = (cmp <= _precision || all_frozen);
    }
+   
+   // count the steps, and note whether some axis has no particles in the last assignment
+   std::vector<bool> & owned = workspace.axisOwned();
+   owned.assign(n_jets, false);
+   const int * assignment = minimization.assignment();
+   for (unsigned i = 0; i < minimization.size(); i++) {
+      if (assignment[i] >= 0 && assignment[i] < n_jets) owned[assignment[i]] = true;
+   }
+   workspace.recordMinimization(h, converged, std::find(owned.begin(), owned.end(), false) != owned.end());
       
    // Convert from internal LightLikeAxes to PseudoJet
-   std::vector<fastjet::PseudoJet> outputAxes;
+   outputAxes.resize(n_jets);
    for (int k = 0; k < n_jets; k++) {
-      fastjet::PseudoJet temp = old_axes[k].ConvertToPseudoJet();
-      outputAxes.push_back(temp);
+      outputAxes[k] = old_axes[k].ConvertToPseudoJet();
    }
    
    // this is used to debug the minimization routine to make sure that it works.
@@ -202,13 +259,22 @@ std::vector<fastjet::PseudoJet> AxesFinderFromOnePassMinimization::getAxes(int n
       double outputTau = tau_components.tau();
       assert(outputTau <= seed_tau);
    }
-   
-   return outputAxes;
 }
 
-PseudoJet AxesFinderFromKmeansMinimization::jiggle(const PseudoJet& axis) const {
-   double phi_noise = ((double)rand()/(double)RAND_MAX) * _noise_range * 2.0 - _noise_range;
-   double rap_noise = ((double)rand()/(double)RAND_MAX) * _noise_range * 2.0 - _noise_range;
+// Counter-based random numbers for the multi-pass noise: the k-th number of a trial only
+// depends on (seed, trial, k), which is what makes the trials independent of each other.
+// (This is the splitmix64 finalizer applied to the counter.)
+static double counter_uniform(unsigned long seed, unsigned int trial, unsigned int k) {
+   uint64_t x = (uint64_t) seed + 0x9E3779B97F4A7C15ULL * ((((uint64_t) trial) << 32) + k + 1);
+   x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+   x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+   x = x ^ (x >> 31);
+   return (x >> 11) * (1.0 / 9007199254740992.0);  // 53 bits in [0,1)
+}
+
+PseudoJet AxesFinderFromKmeansMinimization::jiggle(const PseudoJet& axis, unsigned int trial, unsigned int k) const {
+   double phi_noise = counter_uniform(_seed, trial, 2*k) * _noise_range * 2.0 - _noise_range;
+   double rap_noise = counter_uniform(_seed, trial, 2*k+1) * _noise_range * 2.0 - _noise_range;
    
    double new_phi = axis.phi() + phi_noise;
    if (new_phi >= 2.0*M_PI) new_phi -= 2.0*M_PI;
@@ -218,80 +284,230 @@ PseudoJet AxesFinderFromKmeansMinimization::jiggle(const PseudoJet& axis) const
    newAxis.reset_PtYPhiM(axis.perp(),axis.rap() + rap_noise,new_phi);
    return newAxis;
 }
-   
+
+void AxesFinderFromKmeansMinimization::setParallelism(unsigned int n_threads, unsigned int batch_size) {
+   _batch_size = std::max(batch_size, 1u);
+   if (n_threads > 1) _threadPool.reset(new ThreadPool(n_threads));
+   else _threadPool.reset();
+}
    
 // Repeatedly calls the one pass finder to try to find global minimum
 std::vector<fastjet::PseudoJet> AxesFinderFromKmeansMinimization::getAxes(int n_jets, const std::vector <fastjet::PseudoJet> & inputJets, const std::vector<fastjet::PseudoJet>& seedAxes) const {
+   AxesFinderWorkspace workspace;
+   std::vector<fastjet::PseudoJet> bestAxes;
+   getAxesInto(n_jets, inputJets, seedAxes, bestAxes, workspace);
+   return bestAxes;
+}
+
+void AxesFinderFromKmeansMinimization::getAxesInto(int n_jets, const std::vector <fastjet::PseudoJet> & inputJets, const std::vector<fastjet::PseudoJet>& seedAxes,
+                                                   std::vector<fastjet::PseudoJet>& bestAxes, AxesFinderWorkspace& workspace) const {
    
    // first iteration
-	std::vector<fastjet::PseudoJet> bestAxes = _onePassFinder.getAxes(n_jets, inputJets, seedAxes);
+   _onePassFinder.getAxesInto(n_jets, inputJets, seedAxes, bestAxes, workspace);
    
-   double bestTau = (_measureFunction.result(inputJets,bestAxes)).tau();
+   TauComponents & tau_components = workspace.trialTauComponents();
+   _measureFunction.result(inputJets, bestAxes, tau_components, NULL, &workspace.tauGrid());
+   double bestTau = tau_components.tau();
    
-   for (int l = 1; l < _n_iterations; l++) { // Do minimization procedure multiple times (l = 1 to start since first iteration is done already)
-   
-      // Add noise to current best axes
-      std::vector< PseudoJet > noiseAxes(n_jets, PseudoJet(0,0,0,0));
+   // one trial: jiggle the current best axes, minimize, and find tau (only touches batch(i))
+   unsigned int first_trial = 1;
+   ThreadPool::Task trial = [&](unsigned int i, unsigned int /*thread*/) {
+      AxesFinderWorkspace & trialWorkspace = workspace.batch(i);
+      std::vector<PseudoJet> & noiseAxes = trialWorkspace.noiseAxes();
+      noiseAxes.resize(n_jets);
       for (int k = 0; k < n_jets; k++) {
-         noiseAxes[k] = jiggle(bestAxes[k]);
+         noiseAxes[k] = jiggle(bestAxes[k], first_trial + i, k);
       }
-
-      std::vector<fastjet::PseudoJet> testAxes = _onePassFinder.getAxes(n_jets, inputJets, noiseAxes);
-      double testTau = (_measureFunction.result(inputJets,testAxes)).tau();
+      _onePassFinder.getAxesInto(n_jets, inputJets, noiseAxes, trialWorkspace.trialAxes(), trialWorkspace);
+      _measureFunction.result(inputJets, trialWorkspace.trialAxes(), trialWorkspace.trialTauComponents(), NULL, &trialWorkspace.tauGrid());
+   };
+   
+   unsigned int last_improvement = 0;
+   while (first_trial < (unsigned int) _n_iterations) { // Do minimization procedure multiple times (trial 0 is done already)
+      unsigned int n_trials = std::min(_batch_size, _n_iterations - first_trial);
+      workspace.resizeBatch(n_trials);
       
-      if (testTau < bestTau) {
-         bestTau = testTau;
-         bestAxes = testAxes;
+      if (_threadPool) _threadPool->parallel_for(n_trials, trial);
+      else for (unsigned int i = 0; i < n_trials; i++) trial(i, 0);
+      
+      // keep the best, going through the trials in order so that ties are resolved the same way every time
+      for (unsigned int i = 0; i < n_trials; i++) {
+         double testTau = workspace.batch(i).trialTauComponents().tau();
+         if (testTau < bestTau) {
+            bestTau = testTau;
+            bestAxes.swap(workspace.batch(i).trialAxes());
+            last_improvement = first_trial + i;
+         }
       }
+      first_trial += n_trials;
+      
+      // no improvement for a while
+      if (_stop_window > 0 && first_trial - last_improvement > _stop_window) break;
    }
-   
-   return bestAxes;
 }
 
 // Uses minimization of the geometric distance in order to find the minimum axes.
 // It continually updates until it reaches convergence or it reaches the maximum number of attempts.
 // This is essentially the same as a stable cone finder.
+// The pass that finds tau for the new axes also assigns the particles for the next step, and
+// once the assignment stops changing the axes cannot change either.
 std::vector<fastjet::PseudoJet> AxesFinderFromGeometricMinimization::getAxes(int /*n_jets*/, const std::vector <fastjet::PseudoJet> & particles, const std::vector<fastjet::PseudoJet>& currentAxes) const {
 
    std::vector<fastjet::PseudoJet> seedAxes = currentAxes;
-   double seedTau = _function.tau(particles, seedAxes);
+   std::vector<int> assignment, newAssignment;
+   TauComponents tau_components;
+   _function.result(particles, seedAxes, tau_components, &assignment);
+   double seedTau = tau_components.tau();
    
+   std::vector<fastjet::PseudoJet> newAxes;
    for (int i = 0; i < _nAttempts; i++) {
       
-      std::vector<fastjet::PseudoJet> newAxes(seedAxes.size(),fastjet::PseudoJet(0,0,0,0));
-      
-      // find closest axis and assign to that
-      for (unsigned int i = 0; i < particles.size(); i++) {
-         
-         // start from unclustered beam measure
-         int minJ = -1;
-         double minDist = _function.beam_distance_squared(particles[i]);
-         
-         // which axis am I closest to?
-         for (unsigned int j = 0; j < seedAxes.size(); j++) {
-            double tempDist = _function.jet_distance_squared(particles[i],seedAxes[j]);
-            if (tempDist < minDist) {
-               minDist = tempDist;
-               minJ = j;
-            }
-         }
-         
-         // if not unclustered, then cluster
-         if (minJ != -1) newAxes[minJ] += particles[i];
+      // cluster each particle into its closest axis (-1 is the unclustered beam)
+      newAxes.assign(seedAxes.size(),fastjet::PseudoJet(0,0,0,0));
+      for (unsigned int j = 0; j < particles.size(); j++) {
+         if (assignment[j] != -1) newAxes[assignment[j]] += particles[j];
       }
       
-      // calculate tau on new axes
-      seedAxes = newAxes;
-      double tempTau = _function.tau(particles, newAxes);
+      // calculate tau on new axes (and the assignment for the next step)
+      seedAxes.swap(newAxes);
+      _function.result(particles, seedAxes, tau_components, &newAssignment);
+      double tempTau = tau_components.tau();
       
       // close enough to stop?
       if (fabs(tempTau - seedTau) < _accuracy) break;
+      // same particles, so the next axes would be the same
+      if (newAssignment == assignment) break;
       seedTau = tempTau;
+      assignment.swap(newAssignment);
    }
    
    return seedAxes;
 }
 
+std::vector<fastjet::PseudoJet> AxesFinderFromWTAClustering::getAxes(int n_jets, const std::vector <fastjet::PseudoJet> & inputs, const std::vector<fastjet::PseudoJet>& /*seedAxes*/) const {
+   ExclusiveWTAClustering clustering(_algorithm, _alpha);
+   clustering.run(inputs);
+   return clustering.exclusiveAxes(n_jets);
+}
+
+// Reclusters only if the inputs (or the algorithm) differ from those of the last call with this workspace
+void AxesFinderFromWTAClustering::getAxesInto(int n_jets, const std::vector <fastjet::PseudoJet> & inputs, const std::vector<fastjet::PseudoJet>& /*seedAxes*/,
+                                              std::vector<fastjet::PseudoJet>& outputAxes, AxesFinderWorkspace& workspace) const {
+   ExclusiveWTAClustering & clustering = workspace.wtaClustering();
+   if (clustering.algorithm() != _algorithm || clustering.alpha() != _alpha) {
+      clustering = ExclusiveWTAClustering(_algorithm, _alpha);
+      clustering.run(inputs);
+   } else if (!clustering.hasResultFor(inputs)) {
+      clustering.run(inputs);
+   }
+   clustering.exclusiveAxes(n_jets, outputAxes);
+}
+
+AxesFinderWorkspace::AxesFinderWorkspace()
+: _minimization(new kernels::MinimizationWorkspace()), _lastSteps(-1), _lastConverged(false), _lastEmptyAxis(false) {}
+
+AxesFinderWorkspace::AxesFinderWorkspace(const AxesFinderWorkspace&)
+: _minimization(new kernels::MinimizationWorkspace()), _lastSteps(-1), _lastConverged(false), _lastEmptyAxis(false) {}
+
+AxesFinderWorkspace::~AxesFinderWorkspace() {
+   delete _minimization;
+}
+
+void AxesFinderWorkspace::resizeBatch(unsigned int n) {
+   while (_batch.size() < n) _batch.push_back(SharedPtr<AxesFinderWorkspace>(new AxesFinderWorkspace()));
+}
+
+std::vector<fastjet::PseudoJet> AxesFinderFromWarmStart::getAxes(int n_jets, const std::vector <fastjet::PseudoJet> & inputJets, const std::vector<fastjet::PseudoJet>& warmAxes) const {
+   AxesFinderWorkspace workspace;
+   std::vector<fastjet::PseudoJet> outputAxes;
+   getAxesInto(n_jets, inputJets, warmAxes, outputAxes, workspace);
+   return outputAxes;
+}
+
+void AxesFinderFromWarmStart::minimize(int n_jets, const std::vector <fastjet::PseudoJet> & inputJets, const std::vector<fastjet::PseudoJet>& seedAxes,
+                                       std::vector<fastjet::PseudoJet>& outputAxes, AxesFinderWorkspace& workspace) const {
+   if (_minimizationFinder) _minimizationFinder->getAxesInto(n_jets, inputJets, seedAxes, outputAxes, workspace);
+   else outputAxes = seedAxes;
+}
+
+// Minimizes from whichever starting axes give the smaller tau, and checks a warm-start result
+// against the tau of the standard starting axes before keeping it
+void AxesFinderFromWarmStart::getAxesInto(int n_jets, const std::vector <fastjet::PseudoJet> & inputJets, const std::vector<fastjet::PseudoJet>& warmAxes,
+                                          std::vector<fastjet::PseudoJet>& outputAxes, AxesFinderWorkspace& workspace) const {
+   
+   // the standard starting axes are the reference for the warm start
+   std::vector<fastjet::PseudoJet> & standardSeed = workspace.standardSeedAxes();
+   _standardFinder->getAxesInto(n_jets, inputJets, std::vector<fastjet::PseudoJet>(), standardSeed, workspace);
+   
+   // start from the warm-start axes (the first n_jets, if there are more)
+   unsigned n_warm = std::min(warmAxes.size(), (size_t) n_jets);
+   std::vector<fastjet::PseudoJet> & warmSeed = workspace.warmSeedAxes();
+   warmSeed.assign(warmAxes.begin(), warmAxes.begin() + n_warm);
+   
+   // fill up with the standard axes that are not the closest one to some warm-start axis
+   if (n_warm > 0 && n_warm < (unsigned) n_jets) {
+      std::vector<bool> & taken = workspace.taken();
+      taken.assign(standardSeed.size(), false);
+      for (unsigned i = 0; i < n_warm; i++) {
+         int closest = -1;
+         double closestDistSq = std::numeric_limits<double>::max();
+         for (unsigned j = 0; j < standardSeed.size(); j++) {
+            if (taken[j]) continue;
+            double distSq = warmAxes[i].squared_distance(standardSeed[j]);
+            if (distSq < closestDistSq) {
+               closestDistSq = distSq;
+               closest = j;
+            }
+         }
+         if (closest >= 0) taken[closest] = true;
+      }
+      for (unsigned j = 0; j < standardSeed.size() && warmSeed.size() < (unsigned) n_jets; j++) {
+         if (!taken[j]) warmSeed.push_back(standardSeed[j]);
+      }
+   }
+   
+   // no warm start, or fewer standard axes than jets to fill it up (not enough particles)
+   if (warmSeed.size() != (unsigned) n_jets || standardSeed.size() != (unsigned) n_jets) {
+      minimize(n_jets, inputJets, standardSeed, outputAxes, workspace);
+      return;
+   }
+   workspace.stats().warm_starts++;
+   
+   // the minimization can only lower tau, so the tau of the standard starting axes bounds the
+   // standard result from above; warm-start axes that start above it are not used at all
+   TauComponents & tau_components = workspace.trialTauComponents();
+   _measureFunction->result(inputJets, standardSeed, tau_components, NULL, &workspace.tauGrid());
+   double standardSeedTau = tau_components.tau();
+   _measureFunction->result(inputJets, warmSeed, tau_components, NULL, &workspace.tauGrid());
+   double warmSeedTau = tau_components.tau();
+   if (!(warmSeedTau <= standardSeedTau)) {
+      workspace.stats().warm_rejected++;
+      minimize(n_jets, inputJets, standardSeed, outputAxes, workspace);
+      return;
+   }
+   
+   workspace.clearLastMinimization();
+   minimize(n_jets, inputJets, warmSeed, outputAxes, workspace);
+   _measureFunction->result(inputJets, outputAxes, tau_components, NULL, &workspace.tauGrid());
+   double warmTau = tau_components.tau();
+   
+   // keep it if it converged below the bound with every axis in use
+   // (the first one-pass minimization from the warm-start axes is the one recorded in this
+   // workspace, also when it is the first trial of a multi-pass minimization)
+   if (_minimizationFinder && workspace.lastSteps() >= 0
+       && workspace.lastConverged() && !workspace.lastEmptyAxis()
+       && warmTau <= standardSeedTau) return;
+   
+   // otherwise also minimize from the standard axes, and keep the smaller tau
+   workspace.stats().warm_fallbacks++;
+   std::vector<fastjet::PseudoJet> & standardAxes = workspace.standardAxes();
+   minimize(n_jets, inputJets, standardSeed, standardAxes, workspace);
+   if (standardAxes.size() != outputAxes.size()) return;
+   _measureFunction->result(inputJets, standardAxes, tau_components, NULL, &workspace.tauGrid());
+   double standardTau = tau_components.tau();
+   if (!(warmTau <= standardTau)) outputAxes.swap(standardAxes);
+}
+
 // Go from internal LightLikeAxis to PseudoJet
 fastjet::PseudoJet LightLikeAxis::ConvertToPseudoJet() {
     double px, py, pz, E;
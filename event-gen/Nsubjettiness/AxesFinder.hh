@@ -27,9 +27,12 @@
 #define __FASTJET_CONTRIB_AXESFINDER_HH__
 
 #include "WinnerTakeAllRecombiner.hh"
+#include "ExclusiveWTAClustering.hh"
 #include "MeasureFunction.hh"
+#include "ThreadPool.hh"
 
 #include "fastjet/PseudoJet.hh"
+#include "fastjet/SharedPtr.hh"
 #include "fastjet/ClusterSequence.hh"
 #include "fastjet/JetDefinition.hh"
 
@@ -41,6 +44,9 @@ FASTJET_BEGIN_NAMESPACE      // defined in fastjet/internal/base.hh
 
 namespace contrib{
 
+// Scratch storage for AxesFinder::getAxesInto. It is defined at the end of this file.
+class AxesFinderWorkspace;
+
 ///////
 //
 // Axes Finder Options
@@ -59,6 +65,30 @@ public:
    virtual std::vector<fastjet::PseudoJet> getAxes(int n_jets,
                                                    const std::vector<fastjet::PseudoJet>& inputs,
                                                    const std::vector<fastjet::PseudoJet>& seedAxes) const = 0;
+   
+   // Same as getAxes, but writes the axes into outputAxes and may use the scratch space in workspace,
+   // so that repeated calls with one workspace do not need new allocations.
+   // By default this just calls getAxes.
+   virtual void getAxesInto(int n_jets,
+                            const std::vector<fastjet::PseudoJet>& inputs,
+                            const std::vector<fastjet::PseudoJet>& seedAxes,
+                            std::vector<fastjet::PseudoJet>& outputAxes,
+                            AxesFinderWorkspace& /*workspace*/) const {
+      outputAxes = getAxes(n_jets, inputs, seedAxes);
+   }
+   
+   // Convergence settings for the axes finders that minimize N-jettiness: precision is the
+   // change between steps below which the minimization stops and halt the maximum number of
+   // steps (a negative value keeps the default).  With incremental, particles are only
+   // reassigned near the boundaries between axes and axes are frozen once they stop moving,
+   // which is faster but only converged to about precision.  Other finders ignore this.
+   virtual void setMinimizationParameters(double /*precision*/, int /*halt*/, bool /*incremental*/) {}
+   
+   // Runs the distance, assignment and accumulation steps of the one-pass minimization in
+   // single precision (twice the vector width).  The axes then agree with the double precision
+   // ones only to about float accuracy; tau itself is still evaluated in double.
+   virtual void setSinglePrecision(bool /*single_precision*/) {}
+   
    // convenient shorthand for squaring
    static inline double sq(double x) {return x*x;}
 
@@ -127,6 +157,34 @@ private:
 };
 
 
+//------------------------------------------------------------------------
+/// \class AxesFinderFromWTAClustering
+// This class finds the same axes as AxesFinderFromWTA_KT or AxesFinderFromWTA_CA, but with
+// ExclusiveWTAClustering instead of a ClusterSequence.  The clustering of the last inputs
+// is kept in the workspace, so that the axes for several N of the same jet (with one
+// workspace) come from a single clustering.  This is what the WTA axes definitions use.
+class AxesFinderFromWTAClustering : public AxesFinder {
+public:
+   // algorithm is fastjet::kt_algorithm or fastjet::cambridge_algorithm
+   AxesFinderFromWTAClustering(fastjet::JetAlgorithm algorithm, double alpha = 1.0)
+   : _algorithm(algorithm), _alpha(alpha) {}
+   
+   virtual std::vector<fastjet::PseudoJet> getAxes(int n_jets,
+                                                   const std::vector <fastjet::PseudoJet> & inputs,
+                                                   const std::vector<fastjet::PseudoJet>& seedAxes) const;
+   
+   virtual void getAxesInto(int n_jets,
+                            const std::vector <fastjet::PseudoJet> & inputs,
+                            const std::vector<fastjet::PseudoJet>& seedAxes,
+                            std::vector<fastjet::PseudoJet>& outputAxes,
+                            AxesFinderWorkspace& workspace) const;
+   
+private:
+   fastjet::JetAlgorithm _algorithm;
+   double _alpha;
+};
+
+
 //------------------------------------------------------------------------
 /// \class AxesFinderFromKT
 // This class finds axes by finding the exlusive jets after clustering according to a kT algorithm and a 
@@ -204,11 +262,68 @@ public:
       (void)(n_jets);  // adding this line to fix unused-parameter warning
       return currentAxes;
    }
+   
+   virtual void getAxesInto(int n_jets, const std::vector <fastjet::PseudoJet> & /*inputs*/, const std::vector<fastjet::PseudoJet>& currentAxes,
+                            std::vector<fastjet::PseudoJet>& outputAxes, AxesFinderWorkspace& /*workspace*/) const {
+      assert(currentAxes.size() == (unsigned int) n_jets);
+      (void)(n_jets);  // adding this line to fix unused-parameter warning
+      outputAxes = currentAxes;
+   }
+};
+
+//------------------------------------------------------------------------
+/// \class AxesFinderFromWarmStart
+// This class seeds the minimization with axes the user already has, typically the minimized
+// axes of a closely related calculation (the tau_2 axes when finding tau_3, or the axes of the
+// same jet before pixelization).  These are passed in place of manual axes.  If fewer than N
+// warm-start axes are given, the missing ones are the standard axes that are not the nearest
+// to any warm-start axis.  The minimization is run here (the definition has no finishing
+// finder).  Since it only lowers tau, the tau of the standard axes is an upper bound on the
+// standard result: warm-start axes with a larger tau are dropped and the minimization is run
+// from the standard axes only.  Otherwise it is run from the warm-start axes, and the result is
+// kept if it converged before its halt, every axis kept some particles and its tau is still
+// below the bound; if not, the minimization is also run from the standard axes and the axes
+// with the smaller N-jettiness are kept.  The bound does not catch a warm start that converges
+// to a local minimum above the standard one.  Without a minimization the two sets of axes are
+// always compared.  The steps and fallbacks are counted in the workspace (MinimizationStats).
+class AxesFinderFromWarmStart : public AxesFinder {
+
+public:
+   // takes ownership of the pointers; minimizationFinder may be NULL
+   AxesFinderFromWarmStart(AxesFinder* standardFinder, AxesFinder* minimizationFinder, MeasureFunction* measureFunction)
+   : _standardFinder(standardFinder), _minimizationFinder(minimizationFinder), _measureFunction(measureFunction) {}
+   
+   virtual std::vector<fastjet::PseudoJet> getAxes(int n_jets,
+                                                   const std::vector <fastjet::PseudoJet> & inputJets,
+                                                   const std::vector<fastjet::PseudoJet>& warmAxes) const;
+   
+   virtual void getAxesInto(int n_jets,
+                            const std::vector <fastjet::PseudoJet> & inputJets,
+                            const std::vector<fastjet::PseudoJet>& warmAxes,
+                            std::vector<fastjet::PseudoJet>& outputAxes,
+                            AxesFinderWorkspace& workspace) const;
+   
+private:
+   SharedPtr<AxesFinder> _standardFinder;        // gives the fallback starting axes
+   SharedPtr<AxesFinder> _minimizationFinder;    // run from either starting axes
+   SharedPtr<MeasureFunction> _measureFunction;  // decides between warm-start and fallback axes
+   
+   // runs the minimization (if any) from seedAxes
+   void minimize(int n_jets, const std::vector <fastjet::PseudoJet> & inputJets,
+                 const std::vector<fastjet::PseudoJet>& seedAxes,
+                 std::vector<fastjet::PseudoJet>& outputAxes,
+                 AxesFinderWorkspace& workspace) const;
 };
 
 //This is a helper class for the Minimum Axes Finders. It is defined later.
 class LightLikeAxis;                                          
 
+//Scratch storage for the vectorized minimization (defined in MinimizationKernels.hh)
+namespace kernels {
+   class MinimizationWorkspace;
+   struct ReassignmentState;
+}
+
 
 //------------------------------------------------------------------------
 /// \class AxesFinderFromOnePassMinimization
@@ -219,8 +334,10 @@ public:
 
    // From a startingFinder, try to minimize the unnormalized_measure
    AxesFinderFromOnePassMinimization(double beta, double Rcutoff)
-      : _precision(0.0001), //hard coded for now
-        _halt(1000), //hard coded for now
+      : _precision(0.0001), // default, see setMinimizationParameters
+        _halt(1000), // default, see setMinimizationParameters
+        _incremental(false),
+        _single_precision(false),
         _beta(beta),
         _Rcutoff(Rcutoff),
         _measureFunction(beta, Rcutoff)
@@ -230,20 +347,44 @@ public:
                                                    const std::vector <fastjet::PseudoJet> & inputJets,
                                                    const std::vector<fastjet::PseudoJet>& currentAxes) const;
    
+   virtual void getAxesInto(int n_jets,
+                            const std::vector <fastjet::PseudoJet> & inputJets,
+                            const std::vector<fastjet::PseudoJet>& currentAxes,
+                            std::vector<fastjet::PseudoJet>& outputAxes,
+                            AxesFinderWorkspace& workspace) const;
+   
+   virtual void setMinimizationParameters(double precision, int halt, bool incremental) {
+      if (precision >= 0) _precision = precision;
+      if (halt >= 0) _halt = halt;
+      _incremental = incremental;
+   }
+   
+   // (not combined with incremental, which stays in double precision)
+   virtual void setSinglePrecision(bool single_precision) {
+      _single_precision = single_precision;
+   }
+   
 private:
    double _precision;  // Desired precision in axes alignment
    int _halt;  // maximum number of steps per iteration
+   bool _incremental;  // reassign only near boundaries, freeze converged axes
+   bool _single_precision;  // float kernels for the minimization steps
    
    double _beta;
    double _Rcutoff;
    
    DefaultUnnormalizedMeasureFunction _measureFunction;
    
-   template <int N> std::vector<LightLikeAxis> UpdateAxesFast(const std::vector <LightLikeAxis> & old_axes,
-                                                              const std::vector <fastjet::PseudoJet> & inputJets) const;
+   // incremental is NULL for a full reassignment in every step
+   template <int N> void UpdateAxesFast(const std::vector <LightLikeAxis> & old_axes,
+                                        std::vector <LightLikeAxis> & new_axes,
+                                        kernels::MinimizationWorkspace & workspace,
+                                        kernels::ReassignmentState * incremental) const;
    
-   std::vector<LightLikeAxis> UpdateAxes(const std::vector <LightLikeAxis> & old_axes,
-                                         const std::vector <fastjet::PseudoJet> & inputJets) const;
+   void UpdateAxes(const std::vector <LightLikeAxis> & old_axes,
+                   std::vector <LightLikeAxis> & new_axes,
+                   kernels::MinimizationWorkspace & workspace,
+                   kernels::ReassignmentState * incremental = NULL) const;
 
 };
 
@@ -253,27 +394,61 @@ private:
 // This class finds finds axes by using Kmeans clustering to minimizaiton N-jettiness. Given a first set of 
 // starting axes, it updates n times to get as close to the global minimum as possible. This class calls OnePass many times,
 // added noise to the axes.
+// The trials run in batches that all start from the best axes found before the batch, and the trials of
+// a batch can run in parallel.  The noise comes from a counter-based generator (seed, trial number),
+// so for a given seed and batch size the axes are the same for any number of threads.
 class AxesFinderFromKmeansMinimization : public AxesFinder{
 
 public:
    AxesFinderFromKmeansMinimization(double beta, double Rcutoff, int n_iterations)
    :  _n_iterations(n_iterations),
       _noise_range(1.0), // hard coded for the time being
+      _batch_size(1),
+      _stop_window(0),
+      _seed(0),
       _measureFunction(beta, Rcutoff),
       _onePassFinder(beta, Rcutoff)
       {}
+   
+   // Run batch_size trials at a time on n_threads threads (n_threads counts the calling thread).
+   // The axes depend on batch_size, but not on n_threads; use batch_size >= n_threads.
+   void setParallelism(unsigned int n_threads, unsigned int batch_size);
+   
+   // Stop once the best tau has not improved for stop_window trials (0 runs all trials)
+   void setStopWindow(unsigned int stop_window) {_stop_window = stop_window;}
+   
+   // Seed for the noise added to the axes
+   void setSeed(unsigned long seed) {_seed = seed;}
+   
+   // passed on to the one-pass minimization of each trial
+   virtual void setMinimizationParameters(double precision, int halt, bool incremental) {
+      _onePassFinder.setMinimizationParameters(precision, halt, incremental);
+   }
+   
+   virtual void setSinglePrecision(bool single_precision) {
+      _onePassFinder.setSinglePrecision(single_precision);
+   }
 
    virtual std::vector<fastjet::PseudoJet> getAxes(int n_jets, const std::vector <fastjet::PseudoJet> & inputJets, const std::vector<fastjet::PseudoJet>& currentAxes) const;
    
+   virtual void getAxesInto(int n_jets, const std::vector <fastjet::PseudoJet> & inputJets, const std::vector<fastjet::PseudoJet>& currentAxes,
+                            std::vector<fastjet::PseudoJet>& outputAxes, AxesFinderWorkspace& workspace) const;
+   
 private:
    int _n_iterations;   // Number of iterations to run  (0 for no minimization, 1 for one-pass, >>1 for global minimum)
    double _noise_range; // noise range for random initialization
+   unsigned int _batch_size;   // trials started from the same best axes
+   unsigned int _stop_window;  // trials without improvement before stopping (0 for never)
+   unsigned long _seed;        // seed of the noise
    
    DefaultUnnormalizedMeasureFunction _measureFunction; //function to test whether minimum is reached
    
    AxesFinderFromOnePassMinimization _onePassFinder;  //one pass finder that is repeatedly called
    
-   PseudoJet jiggle(const PseudoJet& axis) const;
+   SharedPtr<ThreadPool> _threadPool;  // runs the trials of a batch (NULL for the calling thread only)
+   
+   // moves the axis by a random amount; the noise only depends on _seed, trial and k
+   PseudoJet jiggle(const PseudoJet& axis, unsigned int trial, unsigned int k) const;
 };
 
 //------------------------------------------------------------------------
@@ -294,6 +469,13 @@ public:
    }
 
    virtual std::vector<fastjet::PseudoJet> getAxes(int n_jets, const std::vector <fastjet::PseudoJet> & particles, const std::vector<fastjet::PseudoJet>& currentAxes) const;
+   
+   // precision is the change of tau between steps; the assignment is always reused
+   // from one step to the next, so incremental makes no difference here
+   virtual void setMinimizationParameters(double precision, int halt, bool /*incremental*/) {
+      if (precision >= 0) _accuracy = precision;
+      if (halt >= 0) _nAttempts = halt;
+   }
 
 private:
    double _nAttempts;
@@ -362,6 +544,121 @@ private:
    
 };
 
+//------------------------------------------------------------------------
+/// \struct MinimizationStats
+// Counts of the one-pass minimizations run with an AxesFinderWorkspace, to see how many update
+// steps a choice of starting axes costs.  The multi-pass trials after the first one run in the
+// batch workspaces and are counted there.
+struct MinimizationStats {
+   MinimizationStats() {clear();}
+   
+   void clear() {minimizations = steps = unconverged = warm_starts = warm_rejected = warm_fallbacks = 0;}
+   
+   MinimizationStats& operator+=(const MinimizationStats& other) {
+      minimizations += other.minimizations;
+      steps += other.steps;
+      unconverged += other.unconverged;
+      warm_starts += other.warm_starts;
+      warm_rejected += other.warm_rejected;
+      warm_fallbacks += other.warm_fallbacks;
+      return *this;
+   }
+   
+   double mean_steps() const {return minimizations > 0 ? (double) steps / minimizations : 0.0;}
+   
+   unsigned long minimizations;   // one-pass minimizations
+   unsigned long steps;           // update steps of all of them
+   unsigned long unconverged;     // stopped by the halt before reaching the precision
+   unsigned long warm_starts;     // AxesFinderFromWarmStart calls with a full set of warm-start axes
+   unsigned long warm_rejected;   // of those, the ones minimized from the standard axes only
+   unsigned long warm_fallbacks;  // the ones minimized from both
+};
+
+//------------------------------------------------------------------------
+/// \class AxesFinderWorkspace
+// Scratch storage for AxesFinder::getAxesInto.  The buffers keep their capacity from one call
+// to the next, so a workspace reused over many jets of similar size takes the allocations
+// out of the minimization.  A workspace should not be shared between threads.
+class AxesFinderWorkspace {
+
+public:
+   AxesFinderWorkspace();
+   ~AxesFinderWorkspace();
+   
+   // Only scratch space and counters live here, so a copy starts out empty.
+   // (This keeps classes holding a workspace, like Njettiness, copyable.)
+   AxesFinderWorkspace(const AxesFinderWorkspace&);
+   AxesFinderWorkspace& operator=(const AxesFinderWorkspace&) {return *this;}
+   
+   // particle arrays and per-particle scratch of the one-pass minimization
+   kernels::MinimizationWorkspace& minimization() {return *_minimization;}
+   
+   // axes before and after each one-pass update step
+   std::vector<LightLikeAxis>& oldAxes() {return _oldAxes;}
+   std::vector<LightLikeAxis>& newAxes() {return _newAxes;}
+   
+   // jiggled starting point, trial result and its tau for the multi-pass minimization
+   std::vector<fastjet::PseudoJet>& noiseAxes() {return _noiseAxes;}
+   std::vector<fastjet::PseudoJet>& trialAxes() {return _trialAxes;}
+   TauComponents& trialTauComponents() {return _trialTauComponents;}
+   // AxisGrid for the tau evaluations of the finders (MeasureFunction::result)
+   AxisGrid& tauGrid() {return _tauGrid;}
+   
+   // which standard axes are already matched to a warm-start axis
+   std::vector<bool>& taken() {return _taken;}
+   
+   // starting axes and standard result of AxesFinderFromWarmStart
+   std::vector<fastjet::PseudoJet>& warmSeedAxes() {return _warmSeedAxes;}
+   std::vector<fastjet::PseudoJet>& standardSeedAxes() {return _standardSeedAxes;}
+   std::vector<fastjet::PseudoJet>& standardAxes() {return _standardAxes;}
+   
+   // which axes own particles at the end of a one-pass minimization
+   std::vector<bool>& axisOwned() {return _axisOwned;}
+   
+   // counts of the minimizations run with this workspace
+   MinimizationStats& stats() {return _stats;}
+   const MinimizationStats& stats() const {return _stats;}
+   
+   // the last one-pass minimization: number of steps (-1 if there was none since
+   // clearLastMinimization), whether it reached the precision before the halt, and
+   // whether some axis was left without particles
+   void recordMinimization(int steps, bool converged, bool emptyAxis) {
+      _lastSteps = steps;
+      _lastConverged = converged;
+      _lastEmptyAxis = emptyAxis;
+      _stats.minimizations++;
+      _stats.steps += steps;
+      if (!converged) _stats.unconverged++;
+   }
+   void clearLastMinimization() {_lastSteps = -1;}
+   int lastSteps() const {return _lastSteps;}
+   bool lastConverged() const {return _lastConverged;}
+   bool lastEmptyAxis() const {return _lastEmptyAxis;}
+   
+   // the last WTA clustering of AxesFinderFromWTAClustering
+   ExclusiveWTAClustering& wtaClustering() {return _wtaClustering;}
+   
+   // one workspace per trial of a multi-pass batch; resizeBatch must be called before
+   // the trials start, since the workspaces are then used from several threads
+   void resizeBatch(unsigned int n);
+   AxesFinderWorkspace& batch(unsigned int i) {return *_batch[i];}
+   
+private:
+   kernels::MinimizationWorkspace* _minimization;
+   std::vector<LightLikeAxis> _oldAxes, _newAxes;
+   std::vector<fastjet::PseudoJet> _noiseAxes, _trialAxes;
+   TauComponents _trialTauComponents;
+   AxisGrid _tauGrid;
+   std::vector<bool> _taken;
+   std::vector<fastjet::PseudoJet> _warmSeedAxes, _standardSeedAxes, _standardAxes;
+   std::vector<bool> _axisOwned;
+   MinimizationStats _stats;
+   int _lastSteps;
+   bool _lastConverged, _lastEmptyAxis;
+   ExclusiveWTAClustering _wtaClustering;
+   std::vector<SharedPtr<AxesFinderWorkspace> > _batch;
+};
+
 } //namespace contrib
 
 FASTJET_END_NAMESPACE
@@ -0,0 +1,139 @@
+//  Nsubjettiness Package
+//  Questions/Comments?  jthaler@jthaler.net
+//
+//  Copyright (c) 2011-14
+//  Jesse Thaler, Ken Van Tilburg, Christopher K. Vermilion, and TJ Wilkason
+//
+//----------------------------------------------------------------------
+// This file is part of FastJet contrib.
+//
+// It is free software; you can redistribute it and/or modify it under
+// the terms of the GNU General Public License as published by the
+// Free Software Foundation; either version 2 of the License, or (at
+// your option) any later version.
+//
+// It is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+// License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this code. If not, see <http://www.gnu.org/licenses/>.
+//----------------------------------------------------------------------
+
+#include "AxisGrid.hh"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+FASTJET_BEGIN_NAMESPACE      // defined in fastjet/internal/base.hh
+
+namespace contrib{
+
+// Rapidities beyond this are not resolved by the grid (zero-pt particles sit at
+// rap = +-1e5 in fastjet); such particles land in the edge rows, which are then
+// left open-ended.
+static const double grid_max_rap = 20.0;
+
+// Relative slack on the cell edges and distance bounds, so that rounding in the
+// distances of the caller can never drop the nearest axis from a cell.
+static const double grid_slack = 1e-9;
+
+bool AxisGrid::reset(const double* axis_rap, const double* axis_phi, unsigned n_axes,
+                     double rap_min, double rap_max, double RcutoffSq, unsigned n_particles) {
+
+   // The callers fold |delta phi| once, min(d, 2pi - d), which is the periodic
+   // distance only for axes with phi in (-pi,3pi)
+   _axis_rap.resize(n_axes);
+   _axis_phi.resize(n_axes);
+   for (unsigned k = 0; k < n_axes; k++) {
+      if (!(axis_phi[k] > -M_PI && axis_phi[k] < 3.0*M_PI)) return false;
+      _axis_rap[k] = axis_rap[k];
+      _axis_phi[k] = std::fmod(axis_phi[k] + 2.0*M_PI, 2.0*M_PI);
+   }
+
+   bool open_below = false, open_above = false;
+   if (!(rap_min >= -grid_max_rap)) { rap_min = -grid_max_rap; open_below = true; }
+   if (!(rap_max <= grid_max_rap)) { rap_max = grid_max_rap; open_above = true; }
+   if (!(rap_max > rap_min)) rap_max = rap_min;
+   double rap_range = rap_max - rap_min;
+
+   // about four cells per axis (but not many more cells than particles), square in (rap,phi)
+   unsigned target = std::max(1u, std::min(4 * n_axes, n_particles / 8));
+   double side = std::sqrt(std::max(rap_range, 0.1) * 2.0 * M_PI / target);
+   _n_phi = std::max(1, (int) (2.0 * M_PI / side + 0.5));
+   _n_rap = std::max(1, (int) (rap_range / side + 0.5));
+   double rap_width = (rap_range > 0.0) ? rap_range / _n_rap : 1.0;
+   double phi_width = 2.0 * M_PI / _n_phi;
+   _rap_min = rap_min;
+   _inv_rap_width = 1.0 / rap_width;
+   _inv_phi_width = 1.0 / phi_width;
+
+   const double infinity = std::numeric_limits<double>::infinity();
+   double cutoff = RcutoffSq * (1.0 + grid_slack);
+   double rap_eps = grid_slack * (rap_width + std::fabs(rap_min) + std::fabs(rap_max));
+   double phi_half = 0.5 * phi_width + grid_slack * 2.0 * M_PI;
+
+   _min_dist.resize(n_axes);
+   _max_dist.resize(n_axes);
+   _offset.resize(n_cells() + 1);
+   _candidates.clear();
+   _offset[0] = 0;
+
+   for (unsigned i_rap = 0; i_rap < _n_rap; i_rap++) {
+      double y0 = (i_rap == 0 && open_below) ? -infinity : rap_min + i_rap * rap_width - rap_eps;
+      double y1 = (i_rap == _n_rap - 1 && open_above) ? infinity : rap_min + (i_rap + 1) * rap_width + rap_eps;
+
+      for (unsigned i_phi = 0; i_phi < _n_phi; i_phi++) {
+         double phi_center = (i_phi + 0.5) * phi_width;
+
+         // the closest any point of the cell can be to each axis, and the farthest
+         double bound = infinity;
+         for (unsigned k = 0; k < n_axes; k++) {
+            double dRap_min = std::max(0.0, std::max(y0 - _axis_rap[k], _axis_rap[k] - y1));
+            double dRap_max = std::max(_axis_rap[k] - y0, y1 - _axis_rap[k]);
+            double dPhi = std::fabs(_axis_phi[k] - phi_center);
+            if (dPhi > M_PI) dPhi = 2.0 * M_PI - dPhi;
+            double dPhi_min = std::max(0.0, dPhi - phi_half);
+            double dPhi_max = std::min(M_PI, dPhi + phi_half);
+            _min_dist[k] = dRap_min*dRap_min + dPhi_min*dPhi_min;
+            _max_dist[k] = dRap_max*dRap_max + dPhi_max*dPhi_max;
+            bound = std::min(bound, _max_dist[k]);
+         }
+         bound = std::min(bound * (1.0 + grid_slack), cutoff);
+
+         // an axis whose closest point is beyond every point of some other axis,
+         // or beyond Rcutoff, is never the one chosen in this cell
+         for (unsigned k = 0; k < n_axes; k++) {
+            if (_min_dist[k] <= bound) _candidates.push_back(k);
+         }
+         _offset[i_rap * _n_phi + i_phi + 1] = _candidates.size();
+      }
+   }
+   return true;
+}
+
+bool AxisGrid::reset(const std::vector<fastjet::PseudoJet>& particles,
+                     const std::vector<fastjet::PseudoJet>& axes, double RcutoffSq) {
+   double rap_min = std::numeric_limits<double>::max();
+   double rap_max = -std::numeric_limits<double>::max();
+   for (unsigned i = 0; i < particles.size(); i++) {
+      double rap = particles[i].rap();
+      if (rap < rap_min) rap_min = rap;
+      if (rap > rap_max) rap_max = rap;
+   }
+
+   // (the axes are copied to the scratch arrays, which reset() then updates in place)
+   _axis_rap.resize(axes.size());
+   _axis_phi.resize(axes.size());
+   for (unsigned k = 0; k < axes.size(); k++) {
+      _axis_rap[k] = axes[k].rap();
+      _axis_phi[k] = axes[k].phi();
+   }
+   return reset(_axis_rap.data(), _axis_phi.data(), axes.size(), rap_min, rap_max, RcutoffSq, particles.size());
+}
+
+} //namespace contrib
+
+FASTJET_END_NAMESPACE
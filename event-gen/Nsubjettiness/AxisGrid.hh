@@ -0,0 +1,112 @@
+//  Nsubjettiness Package
+//  Questions/Comments?  jthaler@jthaler.net
+//
+//  Copyright (c) 2011-14
+//  Jesse Thaler, Ken Van Tilburg, Christopher K. Vermilion, and TJ Wilkason
+//
+//----------------------------------------------------------------------
+// This file is part of FastJet contrib.
+//
+// It is free software; you can redistribute it and/or modify it under
+// the terms of the GNU General Public License as published by the
+// Free Software Foundation; either version 2 of the License, or (at
+// your option) any later version.
+//
+// It is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+// License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this code. If not, see <http://www.gnu.org/licenses/>.
+//----------------------------------------------------------------------
+
+#ifndef __FASTJET_CONTRIB_AXISGRID_HH__
+#define __FASTJET_CONTRIB_AXISGRID_HH__
+
+#include "fastjet/PseudoJet.hh"
+
+#include <vector>
+
+FASTJET_BEGIN_NAMESPACE      // defined in fastjet/internal/base.hh
+
+namespace contrib{
+
+//------------------------------------------------------------------------
+/// \class AxisGrid
+// Spatial index over the axes for the nearest-axis search in the (rap,phi)
+// distance, used when there are many particles and many axes (e.g. Njettiness
+// on a whole event).  The (rap,phi) plane is split into cells (periodic in phi),
+// and each cell lists the axes that can be the nearest one for some point in
+// it: an axis is dropped from a cell if it is farther than Rcutoff from the
+// whole cell, or if some other axis is always closer.  A particle then only
+// has to be compared with the few axes of its cell, and the beam is chosen
+// directly for cells that have none.
+//
+// The candidates of a cell are kept in increasing axis index, so that a search
+// over them with the usual strict "<" (ties to the lowest index, and to the
+// beam in MeasureFunction) gives the same axis as a search over all axes.
+// This is an internal helper for MeasureFunction and the axes minimization.
+class AxisGrid {
+
+public:
+   AxisGrid() : _n_rap(0), _n_phi(0) {}
+
+   // Whether the grid is expected to be faster than comparing with every axis.
+   // Building it costs about (number of cells) x (number of axes), so it only
+   // pays off for many axes and many particles.
+   static bool worthwhile(unsigned n_particles, unsigned n_axes, unsigned min_axes = 4) {
+      return n_axes >= min_axes && n_particles >= 32 * n_axes;
+   }
+
+   // Builds the grid for n_axes axes at (axis_rap,axis_phi), for particles with
+   // rapidities in [rap_min,rap_max] and phi in [0,2pi).  Axes farther than
+   // sqrt(RcutoffSq) from a cell are not listed in it.  Returns false (and the
+   // grid must not be used) if an axis phi is too far outside [0,2pi) for the
+   // distance of the caller to be the periodic one.
+   bool reset(const double* axis_rap, const double* axis_phi, unsigned n_axes,
+              double rap_min, double rap_max, double RcutoffSq, unsigned n_particles);
+
+   // Same as above, taking the axes and the rapidity range of the particles from PseudoJets
+   bool reset(const std::vector<fastjet::PseudoJet>& particles,
+              const std::vector<fastjet::PseudoJet>& axes, double RcutoffSq);
+
+   // cell containing (rap,phi); rapidities outside the grid go to the edge cells
+   unsigned cell(double rap, double phi) const {
+      double t_rap = (rap - _rap_min) * _inv_rap_width;
+      unsigned i_rap = 0;
+      if (t_rap >= _n_rap - 1) i_rap = _n_rap - 1;
+      else if (t_rap > 0) i_rap = (unsigned) t_rap;
+      double t_phi = phi * _inv_phi_width;
+      unsigned i_phi = 0;
+      if (t_phi >= _n_phi - 1) i_phi = _n_phi - 1;
+      else if (t_phi > 0) i_phi = (unsigned) t_phi;
+      return i_rap * _n_phi + i_phi;
+   }
+
+   // candidate axes of a cell, in increasing index
+   const int* begin(unsigned cell) const {return _candidates.data() + _offset[cell];}
+   const int* end(unsigned cell) const {return _candidates.data() + _offset[cell + 1];}
+
+   unsigned n_cells() const {return _n_rap * _n_phi;}
+
+   // average number of candidates per cell (for diagnostics)
+   double mean_candidates() const {
+      return n_cells() ? double(_candidates.size()) / n_cells() : 0.0;
+   }
+
+private:
+   unsigned _n_rap, _n_phi;
+   double _rap_min, _inv_rap_width, _inv_phi_width;
+   std::vector<unsigned> _offset;    // candidates of cell c are [_offset[c],_offset[c+1])
+   std::vector<int> _candidates;
+
+   // scratch space for reset(), kept to avoid reallocating
+   std::vector<double> _axis_rap, _axis_phi, _min_dist, _max_dist;
+};
+
+} //namespace contrib
+
+FASTJET_END_NAMESPACE
+
+#endif  // __FASTJET_CONTRIB_AXISGRID_HH__
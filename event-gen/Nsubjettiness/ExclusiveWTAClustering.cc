@@ -0,0 +1,304 @@
+//  Nsubjettiness Package
+//  Questions/Comments?  jthaler@jthaler.net
+//
+//  Copyright (c) 2011-14
+//  Jesse Thaler, Ken Van Tilburg, Christopher K. Vermilion, and TJ Wilkason
+//
+//----------------------------------------------------------------------
+// This file is part of FastJet contrib.
+//
+// It is free software; you can redistribute it and/or modify it under
+// the terms of the GNU General Public License as published by the
+// Free Software Foundation; either version 2 of the License, or (at
+// your option) any later version.
+//
+// It is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+// License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this code. If not, see <http://www.gnu.org/licenses/>.
+//----------------------------------------------------------------------
+
+#include "ExclusiveWTAClustering.hh"
+
+#include "fastjet/Error.hh"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+FASTJET_BEGIN_NAMESPACE      // defined in fastjet/internal/base.hh
+
+namespace contrib{
+
+// Below this many particles a single tile (i.e. comparing with every jet) is faster
+static const unsigned wta_min_tiled = 16;
+
+ExclusiveWTAClustering::ExclusiveWTAClustering(fastjet::JetAlgorithm algorithm, double alpha)
+: _algorithm(algorithm), _alpha(alpha), _n(0), _n_rap(1), _n_phi(1),
+  _rap_min(0.0), _rap_width(1.0), _phi_width(2.0*M_PI), _stamp(0) {
+   if (algorithm != fastjet::kt_algorithm && algorithm != fastjet::cambridge_algorithm) {
+      throw Error("ExclusiveWTAClustering only supports kt_algorithm and cambridge_algorithm");
+   }
+}
+
+bool ExclusiveWTAClustering::hasResultFor(const std::vector<fastjet::PseudoJet>& particles) const {
+   if (particles.size() != _n) return false;
+   for (unsigned i = 0; i < _n; i++) {
+      if (particles[i].px() != _px[i] || particles[i].py() != _py[i]
+          || particles[i].pz() != _pz[i] || particles[i].E() != _E[i]) return false;
+   }
+   return true;
+}
+
+void ExclusiveWTAClustering::run(const std::vector<fastjet::PseudoJet>& particles) {
+   _n = particles.size();
+   _px.resize(_n);
+   _py.resize(_n);
+   _pz.resize(_n);
+   _E.resize(_n);
+
+   unsigned n_hist = (_n > 0) ? 2 * _n - 1 : 0;
+   _hist_pt.resize(n_hist);
+   _hist_rap.resize(n_hist);
+   _hist_phi.resize(n_hist);
+   _parent1.resize(_n > 0 ? _n - 1 : 0);
+   _parent2.resize(_n > 0 ? _n - 1 : 0);
+
+   _pt.resize(_n);
+   _rap.resize(_n);
+   _phi.resize(_n);
+   _kt2.resize(_n);
+   _hist.resize(_n);
+   _nn.resize(_n);
+   _nn_dist.resize(_n);
+   _dij.resize(_n);
+   _active.resize(_n);
+
+   for (unsigned i = 0; i < _n; i++) {
+      const fastjet::PseudoJet& p = particles[i];
+      _px[i] = p.px();
+      _py[i] = p.py();
+      _pz[i] = p.pz();
+      _E[i] = p.E();
+      _pt[i] = _hist_pt[i] = p.perp();
+      _rap[i] = _hist_rap[i] = p.rap();
+      _phi[i] = _hist_phi[i] = p.phi();
+      _kt2[i] = p.perp2();
+      _hist[i] = i;
+      _active[i] = i;
+   }
+   if (_n == 0) return;
+
+   setup_tiles();
+   for (unsigned i = 0; i < _n; i++) {
+      find_nn(i);
+      _dij[i] = dij(i);
+   }
+
+   unsigned n_active = _n;
+   for (unsigned k = 0; k + 1 < _n; k++) {
+
+      // the pair with the smallest distance: a jet and its nearest neighbour
+      unsigned pos_a = 0;
+      double dij_min = _dij[_active[0]];
+      for (unsigned m = 1; m < n_active; m++) {
+         if (_dij[_active[m]] < dij_min) {
+            dij_min = _dij[_active[m]];
+            pos_a = m;
+         }
+      }
+      int a = _active[pos_a];
+      int b = _nn[a];
+
+      // winner-take-all recombination, as in WinnerTakeAllRecombiner::recombine(a, b)
+      bool a_wins;
+      double new_pt;
+      if (_alpha == 1.0) {
+         a_wins = (_pt[a] >= _pt[b]);
+         new_pt = _pt[a] + _pt[b];
+      } else {
+         double a_metric = _pt[a]*std::pow(std::cosh(_rap[a]), 1.0-_alpha);
+         double b_metric = _pt[b]*std::pow(std::cosh(_rap[b]), 1.0-_alpha);
+         a_wins = (a_metric >= b_metric);
+         if (a_wins) new_pt = _pt[a] + _pt[b]*std::pow(std::cosh(_rap[b])/std::cosh(_rap[a]), 1.0-_alpha);
+         else new_pt = _pt[b] + _pt[a]*std::pow(std::cosh(_rap[a])/std::cosh(_rap[b]), 1.0-_alpha);
+      }
+      int winner = a_wins ? a : b;
+      int loser = a_wins ? b : a;
+
+      unsigned h = _n + k;
+      _parent1[k] = std::min(_hist[a], _hist[b]);
+      _parent2[k] = std::max(_hist[a], _hist[b]);
+      _hist_pt[h] = new_pt;
+      _hist_rap[h] = _rap[winner];
+      _hist_phi[h] = _phi[winner];
+
+      _pt[winner] = new_pt;
+      _kt2[winner] = new_pt * new_pt;
+      _hist[winner] = h;
+
+      // the loser is no longer a jet
+      remove_from_tile(loser);
+      for (unsigned m = 0; m < n_active; m++) {
+         if (_active[m] == loser) {
+            _active[m] = _active[--n_active];
+            break;
+         }
+      }
+
+      // the new jet sits where the winner was, so only the neighbours of the loser
+      // need a new search; the distances to the winner changed with its pt
+      for (unsigned m = 0; m < n_active; m++) {
+         int c = _active[m];
+         if (_nn[c] == loser) {
+            find_nn(c);
+            _dij[c] = dij(c);
+         } else if (_nn[c] == winner || c == winner) {
+            _dij[c] = dij(c);
+         }
+      }
+   }
+}
+
+void ExclusiveWTAClustering::exclusiveAxes(unsigned n, std::vector<fastjet::PseudoJet>& axes) const {
+   if (n > _n) {
+      throw Error("ExclusiveWTAClustering: more exclusive jets requested than there were particles");
+   }
+   axes.clear();
+   if (n == 0) return;
+
+   // the same walk over the history as ClusterSequence::exclusive_jets, where the
+   // last step is the merge of the final jet with the beam
+   int stop_point = 2 * _n - n;
+   for (unsigned k = _n - n; k + 1 < _n; k++) {
+      int parents[2] = {_parent1[k], _parent2[k]};
+      for (unsigned j = 0; j < 2; j++) {
+         if (parents[j] < stop_point) {
+            axes.push_back(fastjet::PtYPhiM(_hist_pt[parents[j]], _hist_rap[parents[j]], _hist_phi[parents[j]]));
+         }
+      }
+   }
+   int root = 2 * _n - 2;
+   if (root < stop_point) {
+      axes.push_back(fastjet::PtYPhiM(_hist_pt[root], _hist_rap[root], _hist_phi[root]));
+   }
+}
+
+double ExclusiveWTAClustering::dij(int slot) const {
+   int nn = _nn[slot];
+   if (nn < 0) return std::numeric_limits<double>::max();
+   if (_algorithm == fastjet::cambridge_algorithm) return _nn_dist[slot];
+   return std::min(_kt2[slot], _kt2[nn]) * _nn_dist[slot];
+}
+
+// About two particles per tile, square in (rap,phi)
+void ExclusiveWTAClustering::setup_tiles() {
+   double rap_max = _rap[0];
+   _rap_min = _rap[0];
+   for (unsigned i = 1; i < _n; i++) {
+      _rap_min = std::min(_rap_min, _rap[i]);
+      rap_max = std::max(rap_max, _rap[i]);
+   }
+   double rap_range = rap_max - _rap_min;
+
+   _n_rap = 1;
+   _n_phi = 1;
+   if (_n >= wta_min_tiled) {
+      unsigned target = _n / 2;
+      double side = std::sqrt(std::max(rap_range, 0.1) * 2.0 * M_PI / target);
+      _n_phi = std::max(1, std::min((int) target, (int) (2.0 * M_PI / side)));
+      _n_rap = std::max(1, std::min((int) target, (int) (rap_range / side)));
+   }
+   _rap_width = (rap_range > 0.0) ? rap_range / _n_rap : 1.0;
+   _phi_width = 2.0 * M_PI / _n_phi;
+
+   unsigned n_tiles = _n_rap * _n_phi;
+   _tile_head.assign(n_tiles, -1);
+   _tile_stamp.assign(n_tiles, 0);
+   _stamp = 0;
+   _tile_of.resize(_n);
+   _next.resize(_n);
+   _prev.resize(_n);
+
+   for (unsigned i = 0; i < _n; i++) {
+      unsigned i_rap = std::min(_n_rap - 1, (unsigned) std::max(0.0, (_rap[i] - _rap_min) / _rap_width));
+      unsigned i_phi = std::min(_n_phi - 1, (unsigned) std::max(0.0, _phi[i] / _phi_width));
+      int tile = i_rap * _n_phi + i_phi;
+      _tile_of[i] = tile;
+      _prev[i] = -1;
+      _next[i] = _tile_head[tile];
+      if (_next[i] >= 0) _prev[_next[i]] = i;
+      _tile_head[tile] = i;
+   }
+}
+
+void ExclusiveWTAClustering::remove_from_tile(int slot) {
+   if (_prev[slot] >= 0) _next[_prev[slot]] = _next[slot];
+   else _tile_head[_tile_of[slot]] = _next[slot];
+   if (_next[slot] >= 0) _prev[_next[slot]] = _prev[slot];
+}
+
+// Nearest neighbour of slot in (rap,phi), searching rings of tiles around its own
+// until the best distance found is below anything the next ring could hold
+void ExclusiveWTAClustering::find_nn(int slot) {
+   if (++_stamp == 0) {
+      std::fill(_tile_stamp.begin(), _tile_stamp.end(), 0);
+      _stamp = 1;
+   }
+
+   const double rap = _rap[slot], phi = _phi[slot];
+   const int row = _tile_of[slot] / _n_phi;
+   const int col = _tile_of[slot] % _n_phi;
+   const int n_rap = _n_rap, n_phi = _n_phi;
+
+   int nn = -1;
+   double best = std::numeric_limits<double>::max();
+
+   for (int r = 0; ; r++) {
+      bool all_phi = (2 * r + 1 >= n_phi);
+      for (int i_rap = std::max(0, row - r); i_rap <= std::min(n_rap - 1, row + r); i_rap++) {
+         bool edge_row = (i_rap == row - r || i_rap == row + r);
+         int n_cols = edge_row ? (all_phi ? n_phi : 2 * r + 1) : 2;
+         for (int m = 0; m < n_cols; m++) {
+            int i_phi;
+            if (edge_row) i_phi = all_phi ? m : col - r + m;
+            else i_phi = (m == 0) ? col - r : col + r;
+            i_phi = ((i_phi % n_phi) + n_phi) % n_phi;
+
+            int tile = i_rap * n_phi + i_phi;
+            if (_tile_stamp[tile] == _stamp) continue;
+            _tile_stamp[tile] = _stamp;
+
+            for (int t = _tile_head[tile]; t >= 0; t = _next[t]) {
+               if (t == slot) continue;
+               double dphi = std::fabs(phi - _phi[t]);
+               if (dphi > M_PI) dphi = 2.0 * M_PI - dphi;
+               double drap = rap - _rap[t];
+               double dist = dphi*dphi + drap*drap;
+               if (dist < best) {
+                  best = dist;
+                  nn = t;
+               }
+            }
+         }
+      }
+
+      // anything outside the rings searched so far is at least this far away
+      bool all_rap = (row - r <= 0 && row + r >= n_rap - 1);
+      if (all_rap && all_phi) break;
+      double bound = std::numeric_limits<double>::max();
+      if (!all_rap) bound = r * _rap_width;
+      if (!all_phi) bound = std::min(bound, r * _phi_width);
+      if (best < bound * bound) break;
+   }
+
+   _nn[slot] = nn;
+   _nn_dist[slot] = best;
+}
+
+} //namespace contrib
+
+FASTJET_END_NAMESPACE
@@ -0,0 +1,116 @@
+//  Nsubjettiness Package
+//  Questions/Comments?  jthaler@jthaler.net
+//
+//  Copyright (c) 2011-14
+//  Jesse Thaler, Ken Van Tilburg, Christopher K. Vermilion, and TJ Wilkason
+//
+//----------------------------------------------------------------------
+// This file is part of FastJet contrib.
+//
+// It is free software; you can redistribute it and/or modify it under
+// the terms of the GNU General Public License as published by the
+// Free Software Foundation; either version 2 of the License, or (at
+// your option) any later version.
+//
+// It is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+// License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this code. If not, see <http://www.gnu.org/licenses/>.
+//----------------------------------------------------------------------
+
+#ifndef __FASTJET_CONTRIB_EXCLUSIVEWTACLUSTERING_HH__
+#define __FASTJET_CONTRIB_EXCLUSIVEWTACLUSTERING_HH__
+
+#include "fastjet/PseudoJet.hh"
+#include "fastjet/JetDefinition.hh"
+
+#include <vector>
+
+FASTJET_BEGIN_NAMESPACE      // defined in fastjet/internal/base.hh
+
+namespace contrib{
+
+//------------------------------------------------------------------------
+/// \class ExclusiveWTAClustering
+// Exclusive kT or CA clustering with winner-take-all recombination, as used
+// for the WTA axes.  It replaces a ClusterSequence with max_allowable_R and a
+// WinnerTakeAllRecombiner, and gives the same exclusive jets (up to rounding,
+// and the choice between pairs at exactly the same distance).
+//
+// The clustering works on (pt, rap, phi) only.  A winner-take-all merge
+// leaves the new jet exactly where the harder of the two was, so it keeps
+// that jet's place in the (rap,phi) tiles, distances to it do not change,
+// and only the jets whose nearest neighbour was the softer one need a new
+// nearest-neighbour search (over the tiles, outwards from their own).  With
+// R = max_allowable_R the beam distance never wins, so the particles are
+// clustered all the way down to one jet, and the merge history then gives
+// the exclusive jets for every n from the same run.
+class ExclusiveWTAClustering {
+
+public:
+   // algorithm is fastjet::kt_algorithm or fastjet::cambridge_algorithm,
+   // alpha the exponent of WinnerTakeAllRecombiner
+   ExclusiveWTAClustering(fastjet::JetAlgorithm algorithm = fastjet::kt_algorithm, double alpha = 1.0);
+
+   // clusters the particles down to one jet, keeping the merge history
+   void run(const std::vector<fastjet::PseudoJet>& particles);
+
+   // whether the last run() was for these particles
+   bool hasResultFor(const std::vector<fastjet::PseudoJet>& particles) const;
+
+   unsigned n_particles() const {return _n;}
+
+   // the n exclusive jets of the last run() (massless, at the position of their
+   // hardest particle), in the order of ClusterSequence::exclusive_jets(n)
+   void exclusiveAxes(unsigned n, std::vector<fastjet::PseudoJet>& axes) const;
+   std::vector<fastjet::PseudoJet> exclusiveAxes(unsigned n) const {
+      std::vector<fastjet::PseudoJet> axes;
+      exclusiveAxes(n, axes);
+      return axes;
+   }
+
+   fastjet::JetAlgorithm algorithm() const {return _algorithm;}
+   double alpha() const {return _alpha;}
+
+private:
+   fastjet::JetAlgorithm _algorithm;
+   double _alpha;
+   unsigned _n;
+
+   // inputs of the last run, to recognize them in hasResultFor
+   std::vector<double> _px, _py, _pz, _E;
+
+   // history: entries [0,n) are the particles, n+k the jet made by merge k;
+   // parents are stored as in ClusterSequence (smaller index first)
+   std::vector<double> _hist_pt, _hist_rap, _hist_phi;
+   std::vector<int> _parent1, _parent2;
+
+   // current jets, by slot (a merged jet takes the slot of the harder one)
+   std::vector<double> _pt, _rap, _phi, _kt2;
+   std::vector<int> _hist;         // history index of the jet in each slot
+   std::vector<int> _nn;           // nearest neighbour slot
+   std::vector<double> _nn_dist;   // squared (rap,phi) distance to it
+   std::vector<double> _dij;       // clustering distance to it
+   std::vector<int> _active;       // slots that are still jets
+
+   // tiles in (rap,phi), as doubly linked lists of slots
+   unsigned _n_rap, _n_phi;
+   double _rap_min, _rap_width, _phi_width;
+   std::vector<int> _tile_head, _tile_of, _next, _prev;
+   std::vector<unsigned> _tile_stamp;
+   unsigned _stamp;
+
+   void setup_tiles();
+   void remove_from_tile(int slot);
+   void find_nn(int slot);
+   double dij(int slot) const;
+};
+
+} //namespace contrib
+
+FASTJET_END_NAMESPACE
+
+#endif  // __FASTJET_CONTRIB_EXCLUSIVEWTACLUSTERING_HH__
@@ -36,43 +36,177 @@ namespace contrib{
 ///////
 
 // Return all of the necessary TauComponents for specific input particles and axes
-TauComponents MeasureFunction::result(const std::vector<fastjet::PseudoJet>& particles, const std::vector<fastjet::PseudoJet>& axes) const {
+TauComponents MeasureFunction::result(const std::vector<fastjet::PseudoJet>& particles,
+                                      const std::vector<fastjet::PseudoJet>& axes,
+                                      std::vector<int> * assignment) const {
+   TauComponents tau_components;
+   result(particles,axes,tau_components,assignment);
+   return tau_components;
+}
+
+// Each particle is assigned and its numerator/denominator added in the same pass,
+// so no partition jets are made (and no constituents copied) just to get tau.
+// The pieces are accumulated directly in the storage of tau_components.
+void MeasureFunction::result(const std::vector<fastjet::PseudoJet>& particles,
+                             const std::vector<fastjet::PseudoJet>& axes,
+                             TauComponents & tau_components,
+                             std::vector<int> * assignment,
+                             AxisGrid * gridStorage) const {
+   
+   std::vector<double>& jetPieces = tau_components._jet_pieces_numerator;
+   jetPieces.assign(axes.size(), 0.0);
+   double beamPiece = 0.0;
+   
+   double tauDen = 0.0;
+   if (!_has_denominator) tauDen = 1.0;  // if no denominator, then 1.0 for no normalization factor
+   
+   if (assignment) assignment->resize(particles.size());
+   
+   AxisGrid localGrid;
+   AxisGrid & grid = gridStorage ? *gridStorage : localGrid;
+   bool use_grid = setup_grid(particles,axes,grid);
+   
+   for (unsigned i = 0; i < particles.size(); i++) {
+      double minRsq;
+      int j_min = use_grid ? closest_axis(particles[i],axes,grid,minRsq) : closest_axis(particles[i],axes,minRsq);
+      
+      if (j_min == -1) {
+         assert(_has_beam);  // this should never happen.
+         beamPiece += beam_numerator(particles[i]); //numerator beam piece
+      } else {
+         jetPieces[j_min] += jet_numerator_from_distance_squared(particles[i],axes[j_min],minRsq); //numerator jet piece
+      }
+      if (_has_denominator) tauDen += denominator(particles[i]); // denominator
+      
+      if (assignment) (*assignment)[i] = j_min;
+   }
+   
+   tau_components._beam_piece_numerator = beamPiece;
+   tau_components._denominator = tauDen;
+   tau_components._has_denominator = _has_denominator;
+   tau_components._has_beam = _has_beam;
+   tau_components.setDerivedValues();
+}
+
+// Same loop as result(), with the numerators and denominators of all measures added for each particle
+void MeasureFunction::results(const std::vector<fastjet::PseudoJet>& particles,
+                              const std::vector<fastjet::PseudoJet>& axes,
+                              const std::vector<const MeasureFunction*>& measures,
+                              std::vector<TauComponents> & tau_components,
+                              AxisGrid * gridStorage) const {
+   
+   tau_components.resize(measures.size());
+   for (unsigned m = 0; m < measures.size(); m++) {
+      TauComponents & components = tau_components[m];
+      components._jet_pieces_numerator.assign(axes.size(), 0.0);
+      components._beam_piece_numerator = 0.0;
+      components._denominator = measures[m]->_has_denominator ? 0.0 : 1.0;
+      components._has_denominator = measures[m]->_has_denominator;
+      components._has_beam = measures[m]->_has_beam;
+   }
+   
+   AxisGrid localGrid;
+   AxisGrid & grid = gridStorage ? *gridStorage : localGrid;
+   bool use_grid = setup_grid(particles,axes,grid);
    
-   // first find partition
-   // this sets jetPartitionStorage and beamPartitionStorage
-   PseudoJet beamPartitionStorage;
-   std::vector<fastjet::PseudoJet> jetPartitionStorage = get_partition(particles,axes,&beamPartitionStorage);
+   for (unsigned i = 0; i < particles.size(); i++) {
+      double minRsq;
+      int j_min = use_grid ? closest_axis(particles[i],axes,grid,minRsq) : closest_axis(particles[i],axes,minRsq);
+      
+      for (unsigned m = 0; m < measures.size(); m++) {
+         TauComponents & components = tau_components[m];
+         if (j_min == -1) {
+            assert(measures[m]->_has_beam);
+            components._beam_piece_numerator += measures[m]->beam_numerator(particles[i]);
+         } else {
+            components._jet_pieces_numerator[j_min] += measures[m]->jet_numerator_from_distance_squared(particles[i],axes[j_min],minRsq);
+         }
+         if (components._has_denominator) components._denominator += measures[m]->denominator(particles[i]);
+      }
+   }
    
-   // then return result calculated from partition
-   return result_from_partition(jetPartitionStorage,axes,&beamPartitionStorage);
+   for (unsigned m = 0; m < measures.size(); m++) tau_components[m].setDerivedValues();
+}
+
+// find minimum distance; start with beam (-1) for reference
+int MeasureFunction::closest_axis(const fastjet::PseudoJet& particle,
+                                  const std::vector<fastjet::PseudoJet>& axes,
+                                  double & minRsq) const {
+   int j_min = -1;
+   if (_has_beam) minRsq = beam_distance_squared(particle);
+   else minRsq = std::numeric_limits<double>::max(); // make it large value
+   
+   // check to see which axis the particle is closest to
+   for (unsigned j = 0; j < axes.size(); j++) {
+      double tempRsq = jet_distance_squared(particle,axes[j]); // delta R distance
+      if (tempRsq < minRsq) {
+         minRsq = tempRsq;
+         j_min = j;
+      }
+   }
+   return j_min;
+}
+
+// same search, over the candidates of the particle's cell only (in increasing index,
+// so that ties are resolved as above)
+int MeasureFunction::closest_axis(const fastjet::PseudoJet& particle,
+                                  const std::vector<fastjet::PseudoJet>& axes,
+                                  const AxisGrid& grid,
+                                  double & minRsq) const {
+   int j_min = -1;
+   if (_has_beam) minRsq = beam_distance_squared(particle);
+   else minRsq = std::numeric_limits<double>::max(); // make it large value
+   
+   unsigned cell = grid.cell(particle.rap(),particle.phi());
+   for (const int* j = grid.begin(cell); j != grid.end(cell); ++j) {
+      double tempRsq = jet_distance_squared(particle,axes[*j]); // delta R distance
+      if (tempRsq < minRsq) {
+         minRsq = tempRsq;
+         j_min = *j;
+      }
+   }
+   return j_min;
+}
+
+bool MeasureFunction::setup_grid(const std::vector<fastjet::PseudoJet>& particles,
+                                 const std::vector<fastjet::PseudoJet>& axes,
+                                 AxisGrid& grid) const {
+   double beamRsq;
+   if (!AxisGrid::worthwhile(particles.size(),axes.size())) return false;
+   if (!has_rap_phi_distance(beamRsq)) return false;
+   if (!_has_beam) beamRsq = std::numeric_limits<double>::infinity();
+   return grid.reset(particles,axes,beamRsq);
 }
 
 std::vector<fastjet::PseudoJet> MeasureFunction::get_partition(const std::vector<fastjet::PseudoJet>& particles,
                                                                const std::vector<fastjet::PseudoJet>& axes,
                                                                PseudoJet * beamPartitionStorage) const {
    
-   std::vector<std::vector<PseudoJet> > jetPartition(axes.size());
-   std::vector<PseudoJet> beamPartition;
-   
    // Figures out the partiting of the input particles into the various jet pieces
    // Based on which axis the parition is closest to
+   std::vector<int> assignment(particles.size());
+   AxisGrid grid;
+   bool use_grid = setup_grid(particles,axes,grid);
    for (unsigned i = 0; i < particles.size(); i++) {
-      
-      // find minimum distance; start with beam (-1) for reference
-      int j_min = -1;
       double minRsq;
-      if (_has_beam) minRsq = beam_distance_squared(particles[i]);
-      else minRsq = std::numeric_limits<double>::max(); // make it large value
-      
-      // check to see which axis the particle is closest to
-      for (unsigned j = 0; j < axes.size(); j++) {
-         double tempRsq = jet_distance_squared(particles[i],axes[j]); // delta R distance
-         if (tempRsq < minRsq) {
-            minRsq = tempRsq;
-            j_min = j;
-         }
-      }
-      
+      assignment[i] = use_grid ? closest_axis(particles[i],axes,grid,minRsq) : closest_axis(particles[i],axes,minRsq);
+   }
+   
+   return get_partition_from_assignment(particles,assignment,axes.size(),beamPartitionStorage);
+}
+
+// builds the partition jets from the axis index of each particle (-1 for beam)
+std::vector<fastjet::PseudoJet> MeasureFunction::get_partition_from_assignment(const std::vector<fastjet::PseudoJet>& particles,
+                                                                               const std::vector<int>& assignment,
+                                                                               unsigned n_axes,
+                                                                               PseudoJet * beamPartitionStorage) const {
+   assert(assignment.size() == particles.size());
+   
+   std::vector<std::vector<PseudoJet> > jetPartition(n_axes);
+   std::vector<PseudoJet> beamPartition;
+   
+   for (unsigned i = 0; i < particles.size(); i++) {
+      int j_min = assignment[i];
       if (j_min == -1) {
          if (_has_beam) beamPartition.push_back(particles[i]);
          else assert(_has_beam);  // this should never happen.
@@ -87,8 +221,8 @@ std::vector<fastjet::PseudoJet> MeasureFunction::get_partition(const std::vector
    }
 
    // Store jet partitions
-   std::vector<PseudoJet> jetPartitionStorage(axes.size(),PseudoJet(0,0,0,0));
-   for (unsigned j = 0; j < axes.size(); j++) {
+   std::vector<PseudoJet> jetPartitionStorage(n_axes,PseudoJet(0,0,0,0));
+   for (unsigned j = 0; j < n_axes; j++) {
       jetPartitionStorage[j] = join(jetPartition[j]);
    }
    
@@ -103,22 +237,11 @@ std::vector<std::list<int> > MeasureFunction::get_partition_list(const std::vect
    
    // Figures out the partiting of the input particles into the various jet pieces
    // Based on which axis the parition is closest to
+   AxisGrid grid;
+   bool use_grid = setup_grid(particles,axes,grid);
    for (unsigned i = 0; i < particles.size(); i++) {
-      
-      // find minimum distance; start with beam (-1) for reference
-      int j_min = -1;
       double minRsq;
-      if (_has_beam) minRsq = beam_distance_squared(particles[i]);
-      else minRsq = std::numeric_limits<double>::max(); // make it large value
-      
-      // check to see which axis the particle is closest to
-      for (unsigned j = 0; j < axes.size(); j++) {
-         double tempRsq = jet_distance_squared(particles[i],axes[j]); // delta R distance
-         if (tempRsq < minRsq) {
-            minRsq = tempRsq;
-            j_min = j;
-         }
-      }
+      int j_min = use_grid ? closest_axis(particles[i],axes,grid,minRsq) : closest_axis(particles[i],axes,minRsq);
       
       if (j_min == -1) {
          assert(_has_beam); // consistency check
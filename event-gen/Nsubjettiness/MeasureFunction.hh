@@ -26,6 +26,7 @@
 #define __FASTJET_CONTRIB_MEASUREFUNCTION_HH__
 
 #include "fastjet/PseudoJet.hh"
+#include "AxisGrid.hh"
 #include <cmath>
 #include <vector>
 #include <list>
@@ -71,24 +72,26 @@ public:
    _denominator(denominator),
    _has_denominator(has_denominator),
    _has_beam(has_beam) {
-      
-      if (!_has_denominator) assert(_denominator == 1.0); //make sure no effect from _denominator if _has_denominator is false
-      if (!_has_beam) assert (_beam_piece_numerator == 0.0); //make sure no effect from _beam_piece_numerator if _has_beam is false
-      
-      _numerator = _beam_piece_numerator;
-      _jet_pieces.resize(_jet_pieces_numerator.size(),0.0);
-      for (unsigned j = 0; j < _jet_pieces_numerator.size(); j++) {
-         _jet_pieces[j] = _jet_pieces_numerator[j]/_denominator;
-         _numerator += _jet_pieces_numerator[j];
-      }
-      
-      _beam_piece = _beam_piece_numerator/_denominator;
-      _tau = _numerator/_denominator;
+      setDerivedValues();
    }
    
+   // Back to the state of the empty constructor, keeping the allocated storage
+   // (n_pieces zero jet pieces instead of one, if given)
+   void clear(unsigned n_pieces = 1) {
+      _jet_pieces_numerator.assign(n_pieces, 0.0);
+      _beam_piece_numerator = 0.0;
+      _denominator = 0;
+      _numerator = 0;
+      _jet_pieces.assign(n_pieces, 0.0);
+      _beam_piece = 0.0;
+      _tau = 0;
+      _has_denominator = false;
+      _has_beam = false;
+   }
    
    // return values
-   std::vector<double> jet_pieces_numerator() const { return _jet_pieces_numerator; }
+   // (the vectors are returned by reference, copy them if they need to outlive the next calculation)
+   const std::vector<double>& jet_pieces_numerator() const { return _jet_pieces_numerator; }
    double beam_piece_numerator() const { return _beam_piece_numerator; }
    double denominator() const { return _denominator; }
    double numerator() const { return _numerator; }
@@ -96,12 +99,32 @@ public:
    bool has_denominator() const { return _has_denominator; }
    bool has_beam() const { return _has_beam; }
    
-   std::vector<double> jet_pieces() const { return _jet_pieces; }
+   const std::vector<double>& jet_pieces() const { return _jet_pieces; }
    double beam_piece() const { return _beam_piece; }
    double tau() const { return _tau; }
 
 private:
    
+   // MeasureFunction fills the numerator pieces in place (see MeasureFunction::result)
+   friend class MeasureFunction;
+   
+   // calculates the normalized pieces, numerator and tau from the input values
+   void setDerivedValues() {
+      
+      if (!_has_denominator) assert(_denominator == 1.0); //make sure no effect from _denominator if _has_denominator is false
+      if (!_has_beam) assert (_beam_piece_numerator == 0.0); //make sure no effect from _beam_piece_numerator if _has_beam is false
+      
+      _numerator = _beam_piece_numerator;
+      _jet_pieces.resize(_jet_pieces_numerator.size(),0.0);
+      for (unsigned j = 0; j < _jet_pieces_numerator.size(); j++) {
+         _jet_pieces[j] = _jet_pieces_numerator[j]/_denominator;
+         _numerator += _jet_pieces_numerator[j];
+      }
+      
+      _beam_piece = _beam_piece_numerator/_denominator;
+      _tau = _numerator/_denominator;
+   }
+   
    // these values are input in the constructor
    std::vector<double> _jet_pieces_numerator;
    double _beam_piece_numerator;
@@ -143,16 +166,39 @@ public:
    virtual double jet_numerator(const fastjet::PseudoJet& particle, const fastjet::PseudoJet& axis) const  = 0;
    virtual double beam_numerator(const fastjet::PseudoJet& particle) const = 0;
    
+   // Same as jet_numerator, for when jet_distance_squared is already known
+   // By default the distance is just recomputed, but measures can override this to reuse it
+   virtual double jet_numerator_from_distance_squared(const fastjet::PseudoJet& particle, const fastjet::PseudoJet& axis, double /*distance_squared*/) const {
+      return jet_numerator(particle,axis);
+   }
+   
    // a possible normalization factor
    virtual double denominator(const fastjet::PseudoJet& particle) const = 0;
    
+   // Measures whose jet distance is the plain (rap,phi) one, PseudoJet::squared_distance,
+   // and whose beam distance is the same for every particle return true and that beam distance.
+   // For many particles and axes, the closest axis is then looked up in an AxisGrid.
+   virtual bool has_rap_phi_distance(double & /*beam_distance_squared*/) const {return false;}
+   
    //------
    // The functions below call the above functions and are not virtual
    //------
    
    // Return all of the necessary TauComponents for specific input particles and axes
-   // Also have optional pointers to get out information about partitioning
-   TauComponents result(const std::vector<fastjet::PseudoJet>& particles, const std::vector<fastjet::PseudoJet>& axes) const;
+   // This is done in a single pass, adding each particle to the piece of its closest axis (or the beam)
+   // without building the partition jets.  The optional assignment pointer gets the index of the
+   // axis of each particle (-1 for the beam), from which get_partition_from_assignment can make the jets later.
+   TauComponents result(const std::vector<fastjet::PseudoJet>& particles, const std::vector<fastjet::PseudoJet>& axes, std::vector<int> * assignment = NULL) const;
+
+   // Same as above, but refills an existing TauComponents (and assignment) without allocating new storage.
+   // If grid is given, it is the AxisGrid reused for the closest-axis search (otherwise a local one is built).
+   void result(const std::vector<fastjet::PseudoJet>& particles, const std::vector<fastjet::PseudoJet>& axes, TauComponents & tau_components, std::vector<int> * assignment = NULL, AxisGrid * grid = NULL) const;
+
+   // TauComponents for each of several measures with the same axes, in a single pass.  The partition
+   // (and the distance of each particle to its axis) is found once, with this measure, and every
+   // measure adds the particle to that piece.  This is only the tau of each measure if they all
+   // have the same distances as this one, as the default measures that differ only in beta do.
+   void results(const std::vector<fastjet::PseudoJet>& particles, const std::vector<fastjet::PseudoJet>& axes, const std::vector<const MeasureFunction*>& measures, std::vector<TauComponents> & tau_components, AxisGrid * grid = NULL) const;
 
    // Just getting tau value if that is all that is needed
    double tau(const std::vector<fastjet::PseudoJet>& particles, const std::vector<fastjet::PseudoJet>& axes) const {
@@ -162,6 +208,9 @@ public:
    // Create the partitioning and stores internally
    std::vector<fastjet::PseudoJet> get_partition(const std::vector<fastjet::PseudoJet>& particles, const std::vector<fastjet::PseudoJet>& axes, PseudoJet * beamPartitionStorage = NULL) const;
 
+   // Same as get_partition, but reusing an assignment found by result()
+   std::vector<fastjet::PseudoJet> get_partition_from_assignment(const std::vector<fastjet::PseudoJet>& particles, const std::vector<int>& assignment, unsigned n_axes, PseudoJet * beamPartitionStorage = NULL) const;
+
    // Essentially same as get_partition, but in the form needed for the jet algorithm
    std::vector<std::list<int> > get_partition_list(const std::vector<fastjet::PseudoJet>& particles, const std::vector<fastjet::PseudoJet>& axes) const;
 
@@ -182,6 +231,17 @@ protected:
    // This constructor allows _has_denominator to be set by derived classes
    MeasureFunction(bool has_denominator = true, bool has_beam = true) : _has_denominator(has_denominator), _has_beam(has_beam) {}
    
+private:
+   // index of the axis closest to the particle, or -1 if the beam is closer
+   // minRsq is set to the corresponding squared distance
+   int closest_axis(const fastjet::PseudoJet& particle, const std::vector<fastjet::PseudoJet>& axes, double & minRsq) const;
+   
+   // same as above, only comparing with the candidate axes of the particle's cell in grid
+   int closest_axis(const fastjet::PseudoJet& particle, const std::vector<fastjet::PseudoJet>& axes, const AxisGrid& grid, double & minRsq) const;
+   
+   // sets up grid for the particles and axes if that is worthwhile and the measure allows it
+   bool setup_grid(const std::vector<fastjet::PseudoJet>& particles, const std::vector<fastjet::PseudoJet>& axes, AxisGrid& grid) const;
+   
 };
 
 
@@ -204,10 +264,19 @@ public:
       return sq(_Rcutoff);
    }
 
+   virtual bool has_rap_phi_distance(double & beam_distance_squared) const {
+      beam_distance_squared = sq(_Rcutoff);
+      return true;
+   }
+
    virtual double jet_numerator(const fastjet::PseudoJet& particle, const fastjet::PseudoJet& axis) const{
       return particle.perp() * std::pow(jet_distance_squared(particle,axis),_beta/2.0);
    }
 
+   virtual double jet_numerator_from_distance_squared(const fastjet::PseudoJet& particle, const fastjet::PseudoJet& /*axis*/, double distance_squared) const{
+      return particle.perp() * std::pow(distance_squared,_beta/2.0);
+   }
+
    virtual double beam_numerator(const fastjet::PseudoJet& particle) const {
       return particle.perp() * std::pow(_Rcutoff,_beta);
    }
@@ -267,6 +336,11 @@ public:
       return particle.pt() * weight * std::pow(jet_distance_squared(particle,axis),_jet_beta/2.0);
    }
 
+   virtual double jet_numerator_from_distance_squared(const fastjet::PseudoJet& particle, const fastjet::PseudoJet& axis, double distance_squared) const {
+      double weight = (_beam_beta == 1.0) ? 1.0 : std::pow(lightFrom(axis).pt(),_beam_beta - 1.0);
+      return particle.pt() * weight * std::pow(distance_squared,_jet_beta/2.0);
+   }
+
    virtual double beam_numerator(const fastjet::PseudoJet& particle) const {
       double weight = (_beam_beta == 1.0) ? 1.0 : std::pow(particle.pt()/particle.e(),_beam_beta - 1.0);
       return particle.pt() * weight * std::pow(_Rcutoff,_jet_beta);
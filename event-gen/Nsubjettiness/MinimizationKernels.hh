@@ -0,0 +1,675 @@
+//  Nsubjettiness Package
+//  Questions/Comments?  jthaler@jthaler.net
+//
+//  Copyright (c) 2011-14
+//  Jesse Thaler, Ken Van Tilburg, Christopher K. Vermilion, and TJ Wilkason
+//
+//----------------------------------------------------------------------
+// This file is part of FastJet contrib.
+//
+// It is free software; you can redistribute it and/or modify it under
+// the terms of the GNU General Public License as published by the
+// Free Software Foundation; either version 2 of the License, or (at
+// your option) any later version.
+//
+// It is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+// License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this code. If not, see <http://www.gnu.org/licenses/>.
+//----------------------------------------------------------------------
+
+#ifndef __FASTJET_CONTRIB_MINIMIZATIONKERNELS_HH__
+#define __FASTJET_CONTRIB_MINIMIZATIONKERNELS_HH__
+
+#include "fastjet/PseudoJet.hh"
+#include "AxisGrid.hh"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+// The vector width is chosen at compile time: AVX (4 doubles) if the compiler
+// targets it (e.g. -mavx2 or -march=native), otherwise SSE2 (2 doubles), which
+// every x86-64 compiler provides.  Define NSUBJETTINESS_NO_SIMD to force the
+// scalar path, e.g. to cross-check results.
+#if !defined(NSUBJETTINESS_NO_SIMD) && defined(__AVX__)
+#include <immintrin.h>
+#define NSUBJETTINESS_SIMD_AVX
+#elif !defined(NSUBJETTINESS_NO_SIMD) && defined(__SSE2__)
+#include <emmintrin.h>
+#define NSUBJETTINESS_SIMD_SSE2
+#endif
+
+FASTJET_BEGIN_NAMESPACE      // defined in fastjet/internal/base.hh
+
+namespace contrib{
+
+///////
+//
+// Vectorized kernels for the axes minimization.
+// These are internal helpers for AxesFinder.cc and are not part of the interface.
+//
+///////
+
+namespace kernels {
+
+//------------------------------------------------------------------------
+// Thin wrappers around the vector registers, so that each kernel is written
+// once and instantiated for the native width and for the scalar remainder,
+// in double precision or (with twice the lanes) in single precision.
+
+struct ScalarDouble {
+   typedef double value;
+   typedef double type;
+   typedef bool mask;
+   static const int width = 1;
+   static type load(const double* x) {return *x;}
+   static void store(double* x, type a) {*x = a;}
+   static type set1(double a) {return a;}
+   static type add(type a, type b) {return a + b;}
+   static type sub(type a, type b) {return a - b;}
+   static type mul(type a, type b) {return a * b;}
+   static type div(type a, type b) {return a / b;}
+   static type sqrt(type a) {return std::sqrt(a);}
+   static type min(type a, type b) {return (b < a) ? b : a;}
+   static type abs(type a) {return std::fabs(a);}
+   static mask lt(type a, type b) {return a < b;}
+   static mask gt(type a, type b) {return a > b;}
+   static mask eq(type a, type b) {return a == b;}
+   static type select(mask m, type if_true, type if_false) {return m ? if_true : if_false;}
+   static type masked(mask m, type a) {return m ? a : 0.0;}
+   static double hsum(type a) {return a;}
+};
+
+#ifdef NSUBJETTINESS_SIMD_AVX
+struct AvxDouble {
+   typedef double value;
+   typedef __m256d type;
+   typedef __m256d mask;
+   static const int width = 4;
+   static type load(const double* x) {return _mm256_loadu_pd(x);}
+   static void store(double* x, type a) {_mm256_storeu_pd(x, a);}
+   static type set1(double a) {return _mm256_set1_pd(a);}
+   static type add(type a, type b) {return _mm256_add_pd(a, b);}
+   static type sub(type a, type b) {return _mm256_sub_pd(a, b);}
+   static type mul(type a, type b) {return _mm256_mul_pd(a, b);}
+   static type div(type a, type b) {return _mm256_div_pd(a, b);}
+   static type sqrt(type a) {return _mm256_sqrt_pd(a);}
+   static type min(type a, type b) {return _mm256_min_pd(a, b);}
+   static type abs(type a) {return _mm256_andnot_pd(_mm256_set1_pd(-0.0), a);}
+   static mask lt(type a, type b) {return _mm256_cmp_pd(a, b, _CMP_LT_OQ);}
+   static mask gt(type a, type b) {return _mm256_cmp_pd(a, b, _CMP_GT_OQ);}
+   static mask eq(type a, type b) {return _mm256_cmp_pd(a, b, _CMP_EQ_OQ);}
+   static type select(mask m, type if_true, type if_false) {return _mm256_blendv_pd(if_false, if_true, m);}
+   static type masked(mask m, type a) {return _mm256_and_pd(m, a);}
+   static double hsum(type a) {
+      double x[4];
+      _mm256_storeu_pd(x, a);
+      return (x[0] + x[1]) + (x[2] + x[3]);
+   }
+};
+typedef AvxDouble NativeDouble;
+#elif defined(NSUBJETTINESS_SIMD_SSE2)
+struct Sse2Double {
+   typedef double value;
+   typedef __m128d type;
+   typedef __m128d mask;
+   static const int width = 2;
+   static type load(const double* x) {return _mm_loadu_pd(x);}
+   static void store(double* x, type a) {_mm_storeu_pd(x, a);}
+   static type set1(double a) {return _mm_set1_pd(a);}
+   static type add(type a, type b) {return _mm_add_pd(a, b);}
+   static type sub(type a, type b) {return _mm_sub_pd(a, b);}
+   static type mul(type a, type b) {return _mm_mul_pd(a, b);}
+   static type div(type a, type b) {return _mm_div_pd(a, b);}
+   static type sqrt(type a) {return _mm_sqrt_pd(a);}
+   static type min(type a, type b) {return _mm_min_pd(a, b);}
+   static type abs(type a) {return _mm_andnot_pd(_mm_set1_pd(-0.0), a);}
+   static mask lt(type a, type b) {return _mm_cmplt_pd(a, b);}
+   static mask gt(type a, type b) {return _mm_cmpgt_pd(a, b);}
+   static mask eq(type a, type b) {return _mm_cmpeq_pd(a, b);}
+   // SSE2 has no blendv, so fall back on bitwise selection
+   static type select(mask m, type if_true, type if_false) {
+      return _mm_or_pd(_mm_and_pd(m, if_true), _mm_andnot_pd(m, if_false));
+   }
+   static type masked(mask m, type a) {return _mm_and_pd(m, a);}
+   static double hsum(type a) {
+      double x[2];
+      _mm_storeu_pd(x, a);
+      return x[0] + x[1];
+   }
+};
+typedef Sse2Double NativeDouble;
+#else
+typedef ScalarDouble NativeDouble;
+#endif
+
+struct ScalarFloat {
+   typedef float value;
+   typedef float type;
+   typedef bool mask;
+   static const int width = 1;
+   static type load(const float* x) {return *x;}
+   static void store(float* x, type a) {*x = a;}
+   static type set1(float a) {return a;}
+   static type add(type a, type b) {return a + b;}
+   static type sub(type a, type b) {return a - b;}
+   static type mul(type a, type b) {return a * b;}
+   static type div(type a, type b) {return a / b;}
+   static type sqrt(type a) {return std::sqrt(a);}
+   static type min(type a, type b) {return (b < a) ? b : a;}
+   static type abs(type a) {return std::fabs(a);}
+   static mask lt(type a, type b) {return a < b;}
+   static mask gt(type a, type b) {return a > b;}
+   static mask eq(type a, type b) {return a == b;}
+   static type select(mask m, type if_true, type if_false) {return m ? if_true : if_false;}
+   static type masked(mask m, type a) {return m ? a : 0.0f;}
+   static double hsum(type a) {return a;}
+};
+
+#ifdef NSUBJETTINESS_SIMD_AVX
+struct AvxFloat {
+   typedef float value;
+   typedef __m256 type;
+   typedef __m256 mask;
+   static const int width = 8;
+   static type load(const float* x) {return _mm256_loadu_ps(x);}
+   static void store(float* x, type a) {_mm256_storeu_ps(x, a);}
+   static type set1(float a) {return _mm256_set1_ps(a);}
+   static type add(type a, type b) {return _mm256_add_ps(a, b);}
+   static type sub(type a, type b) {return _mm256_sub_ps(a, b);}
+   static type mul(type a, type b) {return _mm256_mul_ps(a, b);}
+   static type div(type a, type b) {return _mm256_div_ps(a, b);}
+   static type sqrt(type a) {return _mm256_sqrt_ps(a);}
+   static type min(type a, type b) {return _mm256_min_ps(a, b);}
+   static type abs(type a) {return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a);}
+   static mask lt(type a, type b) {return _mm256_cmp_ps(a, b, _CMP_LT_OQ);}
+   static mask gt(type a, type b) {return _mm256_cmp_ps(a, b, _CMP_GT_OQ);}
+   static mask eq(type a, type b) {return _mm256_cmp_ps(a, b, _CMP_EQ_OQ);}
+   static type select(mask m, type if_true, type if_false) {return _mm256_blendv_ps(if_false, if_true, m);}
+   static type masked(mask m, type a) {return _mm256_and_ps(m, a);}
+   // lanes are added in double
+   static double hsum(type a) {
+      float x[8];
+      _mm256_storeu_ps(x, a);
+      return ((double(x[0]) + x[1]) + (double(x[2]) + x[3])) + ((double(x[4]) + x[5]) + (double(x[6]) + x[7]));
+   }
+};
+typedef AvxFloat NativeFloat;
+#elif defined(NSUBJETTINESS_SIMD_SSE2)
+struct Sse2Float {
+   typedef float value;
+   typedef __m128 type;
+   typedef __m128 mask;
+   static const int width = 4;
+   static type load(const float* x) {return _mm_loadu_ps(x);}
+   static void store(float* x, type a) {_mm_storeu_ps(x, a);}
+   static type set1(float a) {return _mm_set1_ps(a);}
+   static type add(type a, type b) {return _mm_add_ps(a, b);}
+   static type sub(type a, type b) {return _mm_sub_ps(a, b);}
+   static type mul(type a, type b) {return _mm_mul_ps(a, b);}
+   static type div(type a, type b) {return _mm_div_ps(a, b);}
+   static type sqrt(type a) {return _mm_sqrt_ps(a);}
+   static type min(type a, type b) {return _mm_min_ps(a, b);}
+   static type abs(type a) {return _mm_andnot_ps(_mm_set1_ps(-0.0f), a);}
+   static mask lt(type a, type b) {return _mm_cmplt_ps(a, b);}
+   static mask gt(type a, type b) {return _mm_cmpgt_ps(a, b);}
+   static mask eq(type a, type b) {return _mm_cmpeq_ps(a, b);}
+   static type select(mask m, type if_true, type if_false) {
+      return _mm_or_ps(_mm_and_ps(m, if_true), _mm_andnot_ps(m, if_false));
+   }
+   static type masked(mask m, type a) {return _mm_and_ps(m, a);}
+   // lanes are added in double
+   static double hsum(type a) {
+      float x[4];
+      _mm_storeu_ps(x, a);
+      return (double(x[0]) + x[1]) + (double(x[2]) + x[3]);
+   }
+};
+typedef Sse2Float NativeFloat;
+#else
+typedef ScalarFloat NativeFloat;
+#endif
+
+// native and scalar wrappers for each precision
+template <class T> struct Vectors;
+template <> struct Vectors<double> {typedef NativeDouble native; typedef ScalarDouble scalar;};
+template <> struct Vectors<float> {typedef NativeFloat native; typedef ScalarFloat scalar;};
+
+//------------------------------------------------------------------------
+/// \class BasicParticleArrays
+// Structure-of-arrays copy of the particle kinematics used by the minimization.
+// It is filled once per getAxes() call, so that rap() and phi() are not
+// recomputed on every iteration and the loops below can be vectorized.
+// ParticleArrays holds doubles; ParticleArraysFloat the single precision copy.
+template <class T>
+class BasicParticleArrays {
+
+public:
+   BasicParticleArrays() {}
+
+   void reset(const std::vector<fastjet::PseudoJet>& particles) {
+      unsigned n = particles.size();
+      _rap.resize(n); _phi.resize(n); _pt.resize(n);
+      _px.resize(n); _py.resize(n); _pz.resize(n);
+      _rap_min = std::numeric_limits<double>::max();
+      _rap_max = -std::numeric_limits<double>::max();
+      for (unsigned i = 0; i < n; i++) {
+         double rap = particles[i].rap();
+         _rap[i] = rap;
+         _rap_min = std::min(_rap_min, rap);
+         _rap_max = std::max(_rap_max, rap);
+         _phi[i] = particles[i].phi();
+         _pt[i] = particles[i].perp();
+         _px[i] = particles[i].px();
+         _py[i] = particles[i].py();
+         _pz[i] = particles[i].pz();
+      }
+   }
+
+   unsigned size() const {return _rap.size();}
+
+   const T* rap() const {return _rap.data();}
+   const T* phi() const {return _phi.data();}
+   const T* pt() const {return _pt.data();}
+   const T* px() const {return _px.data();}
+   const T* py() const {return _py.data();}
+   const T* pz() const {return _pz.data();}
+
+   // rapidity range of the particles
+   double rap_min() const {return _rap_min;}
+   double rap_max() const {return _rap_max;}
+
+private:
+   std::vector<T> _rap, _phi, _pt, _px, _py, _pz;
+   double _rap_min, _rap_max;
+};
+
+typedef BasicParticleArrays<double> ParticleArrays;
+typedef BasicParticleArrays<float> ParticleArraysFloat;
+
+//------------------------------------------------------------------------
+/// \class MinimizationWorkspace
+// The particle arrays together with the per-particle scratch arrays of the
+// one-pass minimization, sized once per getAxes() call and reused by every
+// iteration.
+class MinimizationWorkspace {
+
+public:
+   MinimizationWorkspace() {}
+
+   // with single_precision, the float arrays are filled as well
+   void reset(const std::vector<fastjet::PseudoJet>& particles, bool single_precision = false) {
+      _particles.reset(particles);
+      _assignment.resize(particles.size());
+      _distSq.resize(particles.size());
+      _weight.resize(particles.size());
+      _margin.resize(particles.size());
+      if (single_precision) {
+         _particlesFloat.reset(particles);
+         _distSqFloat.resize(particles.size());
+         _weightFloat.resize(particles.size());
+      }
+   }
+
+   const ParticleArrays& particles() const {return _particles;}
+   unsigned size() const {return _particles.size();}
+
+   int* assignment() {return _assignment.data();}
+   double* distSq() {return _distSq.data();}
+   double* weight() {return _weight.data();}
+   double* margin() {return _margin.data();}
+   
+   // single precision copies (only after reset with single_precision)
+   const ParticleArraysFloat& particlesFloat() const {return _particlesFloat;}
+   float* distSqFloat() {return _distSqFloat.data();}
+   float* weightFloat() {return _weightFloat.data();}
+   
+   // index over the axes, rebuilt by each assignment step that uses it
+   AxisGrid& grid() {return _grid;}
+
+private:
+   ParticleArrays _particles;
+   AxisGrid _grid;
+   std::vector<int> _assignment;   // index of the nearest axis (-1 if beyond Rcutoff)
+   std::vector<double> _distSq;    // squared distance to that axis
+   std::vector<double> _weight;    // weight in the axis update
+   std::vector<double> _margin;    // distance to the nearest boundary (incremental mode only)
+   ParticleArraysFloat _particlesFloat;
+   std::vector<float> _distSqFloat, _weightFloat;
+};
+
+//------------------------------------------------------------------------
+// What the incremental reassignment keeps between iterations of the one-pass
+// minimization (for at most max_axes axes, the limit of UpdateAxes)
+struct ReassignmentState {
+   static const int max_axes = 20;
+   bool first;                 // no assignment yet, do all particles
+   double move[max_axes];      // how far each axis moved in the last step
+   bool changed[max_axes];     // set for axes that gained or lost particles
+   bool frozen[max_axes];      // axes that are no longer updated
+   unsigned n_changed;         // particles that changed axis
+};
+
+//------------------------------------------------------------------------
+// Per-axis sums collected in the update step of the one-pass minimization
+struct AxisSums {
+   double rap, phi, weight, px, py, pz;
+   void clear() {rap = phi = weight = px = py = pz = 0.0;}
+};
+
+// |phi1 - phi2| folded into [0,pi], written without a branch:
+// for d > pi the second argument 2pi - d is the smaller one, otherwise d is,
+// so this is bit-for-bit the same as LightLikeAxis::DistanceSq.
+template <class V>
+inline typename V::type abs_delta_phi(typename V::type phi1, typename V::type phi2) {
+   typename V::type d = V::abs(V::sub(phi1, phi2));
+   return V::min(d, V::sub(V::set1((typename V::value) (2.0*M_PI)), d));
+}
+
+// Assign particles [begin,end) to their nearest axis, storing the axis index
+// (-1 if beyond Rcutoff) and the squared distance to that axis.
+// Ties go to the lowest axis index, as in the scalar loop.
+template <class V, int N>
+inline void assign_range(const BasicParticleArrays<typename V::value>& particles, unsigned begin, unsigned end,
+                         const typename V::value* axis_rap, const typename V::value* axis_phi,
+                         typename V::value RcutoffSq, int* assignment, typename V::value* distSq) {
+   typedef typename V::value T;
+   const T* rap = particles.rap();
+   const T* phi = particles.phi();
+   const typename V::type no_axis = V::set1(-1.0);
+   const typename V::type cutoff = V::set1(RcutoffSq);
+   T index[V::width];
+
+   for (unsigned i = begin; i + V::width <= end; i += V::width) {
+      typename V::type p_rap = V::load(rap + i);
+      typename V::type p_phi = V::load(phi + i);
+      typename V::type best = V::set1(std::numeric_limits<T>::max());
+      typename V::type best_k = no_axis;
+      for (int k = 0; k < N; k++) {
+         typename V::type dRap = V::sub(V::set1(axis_rap[k]), p_rap);
+         typename V::type dPhi = abs_delta_phi<V>(V::set1(axis_phi[k]), p_phi);
+         typename V::type thisDist = V::add(V::mul(dRap, dRap), V::mul(dPhi, dPhi));
+         typename V::mask closer = V::lt(thisDist, best);
+         best = V::select(closer, thisDist, best);
+         best_k = V::select(closer, V::set1((T) k), best_k);
+      }
+      best_k = V::select(V::gt(best, cutoff), no_axis, best_k);
+      V::store(distSq + i, best);
+      V::store(index, best_k);
+      for (int l = 0; l < V::width; l++) assignment[i + l] = (int) index[l];
+   }
+}
+
+template <int N, class T>
+inline void assign_to_axes(const BasicParticleArrays<T>& particles,
+                           const T* axis_rap, const T* axis_phi, T RcutoffSq,
+                           int* assignment, T* distSq) {
+   typedef typename Vectors<T>::native VN;
+   typedef typename Vectors<T>::scalar VS;
+   unsigned n = particles.size();
+   unsigned n_vec = n - n % VN::width;
+   assign_range<VN, N>(particles, 0, n_vec, axis_rap, axis_phi, RcutoffSq, assignment, distSq);
+   assign_range<VS, N>(particles, n_vec, n, axis_rap, axis_phi, RcutoffSq, assignment, distSq);
+}
+
+// Same as assign_to_axes, with each particle only compared to the candidate axes of
+// its cell in grid (built for these axes and RcutoffSq).  The candidates are in
+// increasing index, so ties go to the lowest index as above; particles with no
+// candidate go to the beam.  Only the distances of assigned particles are the
+// same as from assign_to_axes, the others are just beyond Rcutoff.
+inline void assign_with_grid(const ParticleArrays& particles, const AxisGrid& grid,
+                             const double* axis_rap, const double* axis_phi, double RcutoffSq,
+                             int* assignment, double* distSq) {
+   const double* rap = particles.rap();
+   const double* phi = particles.phi();
+   unsigned n = particles.size();
+   for (unsigned i = 0; i < n; i++) {
+      unsigned cell = grid.cell(rap[i], phi[i]);
+      double best = std::numeric_limits<double>::max();
+      int best_k = -1;
+      for (const int* k = grid.begin(cell); k != grid.end(cell); ++k) {
+         double dRap = axis_rap[*k] - rap[i];
+         double dPhi = abs_delta_phi<ScalarDouble>(axis_phi[*k], phi[i]);
+         double thisDist = dRap*dRap + dPhi*dPhi;
+         if (thisDist < best) {
+            best = thisDist;
+            best_k = *k;
+         }
+      }
+      assignment[i] = (best > RcutoffSq) ? -1 : best_k;
+      distSq[i] = best;
+   }
+}
+
+// Assign one particle from scratch, and find its margin: how much farther the
+// nearest boundary is than its axis (another axis, or Rcutoff).  Ties and the
+// Rcutoff test are resolved exactly as in assign_range.
+template <int N>
+inline int assign_particle(double p_rap, double p_phi,
+                           const double* axis_rap, const double* axis_phi,
+                           double Rcutoff, double RcutoffSq,
+                           double & distSq, double & margin) {
+   double best = std::numeric_limits<double>::max();
+   double second = std::numeric_limits<double>::max();
+   int best_k = -1;
+   for (int k = 0; k < N; k++) {
+      double dRap = axis_rap[k] - p_rap;
+      double dPhi = abs_delta_phi<ScalarDouble>(axis_phi[k], p_phi);
+      double thisDist = dRap*dRap + dPhi*dPhi;
+      if (thisDist < best) {
+         second = best;
+         best = thisDist;
+         best_k = k;
+      } else if (thisDist < second) {
+         second = thisDist;
+      }
+   }
+   distSq = best;
+   if (best > RcutoffSq) {
+      margin = std::sqrt(best) - Rcutoff;
+      return -1;
+   }
+   margin = std::min(std::sqrt(second), Rcutoff) - std::sqrt(best);
+   return best_k;
+}
+
+// Incremental version of assign_to_axes.  When the axes move by state.move[k], the
+// margin of a particle on axis a shrinks by at most move[a] + max(move) (the rap-phi
+// distance obeys the triangle inequality), so only the particles whose margin runs out
+// are reassigned; the others keep their axis and only need the distance to it, and only
+// if it moved.  The assignment is the same as from assign_to_axes.
+template <int N>
+inline void reassign_incremental(const ParticleArrays& particles,
+                                 const double* axis_rap, const double* axis_phi,
+                                 double Rcutoff, ReassignmentState & state,
+                                 int* assignment, double* distSq, double* margin) {
+   // margins this small are not trusted, to stay clear of rounding
+   const double tolerance = 1e-10;
+   const double* rap = particles.rap();
+   const double* phi = particles.phi();
+   unsigned n = particles.size();
+   double RcutoffSq = Rcutoff * Rcutoff;
+   
+   double max_move = 0.0;
+   for (int k = 0; k < N; k++) {
+      max_move = std::max(max_move, state.move[k]);
+      state.changed[k] = false;
+   }
+   state.n_changed = 0;
+   
+   for (unsigned i = 0; i < n; i++) {
+      int old_k = state.first ? -2 : assignment[i];
+      if (!state.first) {
+         margin[i] -= (old_k >= 0 ? state.move[old_k] : 0.0) + max_move;
+         if (margin[i] > tolerance) {
+            if (old_k >= 0 && state.move[old_k] != 0.0) {
+               double dRap = axis_rap[old_k] - rap[i];
+               double dPhi = abs_delta_phi<ScalarDouble>(axis_phi[old_k], phi[i]);
+               distSq[i] = dRap*dRap + dPhi*dPhi;
+            }
+            continue;
+         }
+      }
+      int new_k = assign_particle<N>(rap[i], phi[i], axis_rap, axis_phi, Rcutoff, RcutoffSq, distSq[i], margin[i]);
+      assignment[i] = new_k;
+      if (!state.first && new_k != old_k) {
+         if (old_k >= 0) state.changed[old_k] = true;
+         if (new_k >= 0) state.changed[new_k] = true;
+         state.n_changed++;
+      }
+   }
+   state.first = false;
+}
+
+// Weight of each particle in the axis update, (DR^2 + precision^2)^(beta/2 - 1),
+// with the pow() call avoided for the common beta values.
+template <class V>
+inline void update_weights_range(const typename V::value* distSq, unsigned begin, unsigned end,
+                                 double beta, double precisionSq, typename V::value* weight) {
+   const typename V::type one = V::set1(1.0);
+   const typename V::type precision = V::set1(precisionSq);
+   for (unsigned i = begin; i + V::width <= end; i += V::width) {
+      typename V::type d = V::add(precision, V::load(distSq + i));
+      if (beta == 1.0) V::store(weight + i, V::div(one, V::sqrt(d)));
+      else if (beta == 0.0) V::store(weight + i, V::div(one, d));
+      else V::store(weight + i, one);
+   }
+}
+
+template <class T>
+inline void update_weights(const T* distSq, unsigned n, double beta, double precisionSq, T* weight) {
+   typedef typename Vectors<T>::native VN;
+   typedef typename Vectors<T>::scalar VS;
+   if (beta == 1.0 || beta == 2.0 || beta == 0.0) {
+      unsigned n_vec = n - n % VN::width;
+      update_weights_range<VN>(distSq, 0, n_vec, beta, precisionSq, weight);
+      update_weights_range<VS>(distSq, n_vec, n, beta, precisionSq, weight);
+   } else {
+      for (unsigned i = 0; i < n; i++) {
+         weight[i] = std::pow(precisionSq + distSq[i], (0.5*beta-1.0));
+      }
+   }
+}
+
+// Accumulate the weighted rapidity/phi sums and the momentum sums for every axis.
+// Particles assigned to no axis (-1) never match and drop out of all sums.
+// Phi is shifted by 2pi where needed so that each axis averages over a
+// contiguous range around its old position.
+template <class V, int N>
+inline void accumulate_range(const BasicParticleArrays<typename V::value>& particles, unsigned begin, unsigned end,
+                             const int* assignment, const typename V::value* weight,
+                             const typename V::value* axis_phi, AxisSums* sums) {
+   typedef typename V::value T;
+   const T* rap = particles.rap();
+   const T* phi = particles.phi();
+   const T* pt = particles.pt();
+   const T* px = particles.px();
+   const T* py = particles.py();
+   const T* pz = particles.pz();
+   const typename V::type zero = V::set1(0.0);
+   const typename V::type pi = V::set1(M_PI);
+   const typename V::type minus_pi = V::set1(-M_PI);
+   const typename V::type twopi = V::set1(2.0*M_PI);
+   const typename V::type minus_twopi = V::set1(-2.0*M_PI);
+
+   typename V::type s_rap[N], s_phi[N], s_weight[N], s_px[N], s_py[N], s_pz[N];
+   for (int k = 0; k < N; k++) {
+      s_rap[k] = s_phi[k] = s_weight[k] = s_px[k] = s_py[k] = s_pz[k] = zero;
+   }
+
+   T index[V::width];
+   for (unsigned i = begin; i + V::width <= end; i += V::width) {
+      for (int l = 0; l < V::width; l++) index[l] = assignment[i + l];
+      typename V::type p_k = V::load(index);
+      typename V::type p_phi = V::load(phi + i);
+      typename V::type wpt = V::mul(V::load(pt + i), V::load(weight + i));
+      typename V::type wpt_rap = V::mul(wpt, V::load(rap + i));
+      typename V::type p_px = V::load(px + i);
+      typename V::type p_py = V::load(py + i);
+      typename V::type p_pz = V::load(pz + i);
+      for (int k = 0; k < N; k++) {
+         typename V::mask mine = V::eq(p_k, V::set1((T) k));
+         typename V::type distPhi = V::sub(p_phi, V::set1(axis_phi[k]));
+         typename V::type shift = V::select(V::gt(distPhi, pi), minus_twopi,
+                                            V::select(V::lt(distPhi, minus_pi), twopi, zero));
+         s_rap[k] = V::add(s_rap[k], V::masked(mine, wpt_rap));
+         s_phi[k] = V::add(s_phi[k], V::masked(mine, V::mul(wpt, V::add(shift, p_phi))));
+         s_weight[k] = V::add(s_weight[k], V::masked(mine, wpt));
+         s_px[k] = V::add(s_px[k], V::masked(mine, p_px));
+         s_py[k] = V::add(s_py[k], V::masked(mine, p_py));
+         s_pz[k] = V::add(s_pz[k], V::masked(mine, p_pz));
+      }
+   }
+
+   for (int k = 0; k < N; k++) {
+      sums[k].rap += V::hsum(s_rap[k]);
+      sums[k].phi += V::hsum(s_phi[k]);
+      sums[k].weight += V::hsum(s_weight[k]);
+      sums[k].px += V::hsum(s_px[k]);
+      sums[k].py += V::hsum(s_py[k]);
+      sums[k].pz += V::hsum(s_pz[k]);
+   }
+}
+
+// Sums for the incremental mode: one pass that only visits the particles of axes
+// that are not frozen (frozen axes get empty sums), computing their weights on the way.
+template <int N>
+inline void accumulate_incremental(const ParticleArrays& particles, const int* assignment,
+                                   const double* distSq, double beta, double precisionSq,
+                                   const ReassignmentState & state, const double* axis_phi,
+                                   AxisSums* sums) {
+   const double* rap = particles.rap();
+   const double* phi = particles.phi();
+   const double* pt = particles.pt();
+   const double* px = particles.px();
+   const double* py = particles.py();
+   const double* pz = particles.pz();
+   unsigned n = particles.size();
+   for (int k = 0; k < N; k++) sums[k].clear();
+   
+   for (unsigned i = 0; i < n; i++) {
+      int k = assignment[i];
+      if (k < 0 || state.frozen[k]) continue;
+      double d = distSq[i] + precisionSq;
+      double weight;
+      if (beta == 1.0) weight = 1.0 / std::sqrt(d);
+      else if (beta == 2.0) weight = 1.0;
+      else if (beta == 0.0) weight = 1.0 / d;
+      else weight = std::pow(d, 0.5*beta - 1.0);
+      
+      double wpt = pt[i] * weight;
+      double distPhi = phi[i] - axis_phi[k];
+      double shift = (distPhi > M_PI) ? -2.0*M_PI : ((distPhi < -M_PI) ? 2.0*M_PI : 0.0);
+      sums[k].rap += wpt * rap[i];
+      sums[k].phi += wpt * (shift + phi[i]);
+      sums[k].weight += wpt;
+      sums[k].px += px[i];
+      sums[k].py += py[i];
+      sums[k].pz += pz[i];
+   }
+}
+
+template <int N, class T>
+inline void accumulate_axes(const BasicParticleArrays<T>& particles, const int* assignment, const T* weight,
+                            const T* axis_phi, AxisSums* sums) {
+   typedef typename Vectors<T>::native VN;
+   typedef typename Vectors<T>::scalar VS;
+   unsigned n = particles.size();
+   unsigned n_vec = n - n % VN::width;
+   for (int k = 0; k < N; k++) sums[k].clear();
+   accumulate_range<VN, N>(particles, 0, n_vec, assignment, weight, axis_phi, sums);
+   accumulate_range<VS, N>(particles, n_vec, n, assignment, weight, axis_phi, sums);
+}
+
+} // namespace kernels
+
+} //namespace contrib
+
+FASTJET_END_NAMESPACE
+
+#endif  // __FASTJET_CONTRIB_MINIMIZATIONKERNELS_HH__
@@ -29,6 +29,49 @@ FASTJET_BEGIN_NAMESPACE      // defined in fastjet/internal/base.hh
 namespace contrib {
 
 
+///////
+//
+// NjettinessWorkspace
+//
+///////
+
+const std::vector<fastjet::PseudoJet>& NjettinessWorkspace::setParticles(const fastjet::PseudoJet& jet) {
+   _particles.clear();
+   addConstituents(jet);
+   return _particles;
+}
+
+// Appends the constituents of jet as PseudoJet::constituents() lists them: for a ClusterSequence
+// jet, the original particles under it in the history (first parent first); for a composite jet,
+// those of each piece in turn (a piece without constituents is one itself).
+void NjettinessWorkspace::addConstituents(const fastjet::PseudoJet& jet) {
+   if (jet.has_valid_cluster_sequence()) {
+      const fastjet::ClusterSequence * cs = jet.validated_cs();
+      const std::vector<fastjet::ClusterSequence::history_element> & history = cs->history();
+      const std::vector<fastjet::PseudoJet> & csJets = cs->jets();
+      _historyStack.assign(1, jet.cluster_hist_index());
+      while (!_historyStack.empty()) {
+         int i = _historyStack.back();
+         _historyStack.pop_back();
+         if (history[i].parent1 == fastjet::ClusterSequence::InexistentParent) {
+            _particles.push_back(csJets[history[i].jetp_index]);
+         } else {
+            if (history[i].parent2 != fastjet::ClusterSequence::BeamJet) _historyStack.push_back(history[i].parent2);
+            _historyStack.push_back(history[i].parent1);
+         }
+      }
+   } else if (jet.has_pieces()) {
+      std::vector<fastjet::PseudoJet> pieces = jet.pieces();
+      for (unsigned i = 0; i < pieces.size(); i++) {
+         if (pieces[i].has_constituents()) addConstituents(pieces[i]);
+         else _particles.push_back(pieces[i]);
+      }
+   } else {
+      std::vector<fastjet::PseudoJet> constituents = jet.constituents();
+      _particles.insert(_particles.end(), constituents.begin(), constituents.end());
+   }
+}
+
 ///////
 //
 // Main Njettiness Class
@@ -36,12 +79,12 @@ namespace contrib {
 ///////
 
 Njettiness::Njettiness(const AxesDefinition & axes_def, const MeasureDefinition & measure_def)
-: _axes_def(axes_def.create()), _measure_def(measure_def.create()) {
+: _axes_def(axes_def.create()), _measure_def(measure_def.create()), _hasCurrentJets(false) {
    setMeasureFunctionAndAxesFinder();  // call helper function to do the hard work
 }
 
 Njettiness::Njettiness(AxesMode axes_mode, const MeasureDefinition & measure_def)
-: _axes_def(createAxesDef(axes_mode)), _measure_def(measure_def.create()) {
+: _axes_def(createAxesDef(axes_mode)), _measure_def(measure_def.create()), _hasCurrentJets(false) {
    setMeasureFunctionAndAxesFinder();  // call helper function to do the hard work
 }
    
@@ -184,24 +227,81 @@ TauComponents Njettiness::getTauComponents(unsigned n_jets, const std::vector<fa
       _seedAxes = _currentAxes;
       _currentJets = _currentAxes;
       _currentBeam = PseudoJet(0.0,0.0,0.0,0.0);
+      _hasCurrentJets = true;
    } else {
 
-      _seedAxes = _startingAxesFinder->getAxes(n_jets,inputJets,_currentAxes); //sets starting point for minimization
-      if (_finishingAxesFinder) {
-         _currentAxes = _finishingAxesFinder->getAxes(n_jets,inputJets,_seedAxes);
-      } else {
-         _currentAxes = _seedAxes;
-      }
-      
-      // Find partition and store information
-      // (jet information in _currentJets, beam in _currentBeam)
-      _currentJets = _measureFunction->get_partition(inputJets,_currentAxes,&_currentBeam);
+      findAxes(n_jets, inputJets, _currentAxes, _seedAxes, _currentAxes, _axesFinderWorkspace);
       
       // Find tau value and store information
-      _current_tau_components = _measureFunction->result_from_partition(_currentJets, _currentAxes,&_currentBeam);  // sets current Tau Values
+      // The partition itself is only kept as the axis index of each particle;
+      // _currentJets and _currentBeam are built from it if they are asked for
+      _current_tau_components = _measureFunction->result(inputJets, _currentAxes, &_currentAssignment);  // sets current Tau Values
+      _currentInputs.assign(inputJets.begin(), inputJets.end());  // keeps its capacity
+      _hasCurrentJets = false;
    }
    return _current_tau_components;
 }
+
+// Same as above, but everything is kept in the caller's workspace instead of in this object.
+// With a reused workspace, the vectors only grow when a jet has more particles than any before it.
+const TauComponents& Njettiness::getTauComponents(unsigned n_jets, const std::vector<fastjet::PseudoJet> & inputJets, NjettinessWorkspace & workspace) const {
+   if (inputJets.size() <= n_jets) {  //if not enough particles, return zero
+      workspace._axes.assign(inputJets.begin(), inputJets.end());
+      workspace._axes.resize(n_jets,fastjet::PseudoJet(0.0,0.0,0.0,0.0));
+      workspace._seedAxes = workspace._axes;
+      workspace._assignment.resize(inputJets.size());
+      for (unsigned i = 0; i < inputJets.size(); i++) workspace._assignment[i] = i; // each particle is its own axis
+      workspace._tau_components.clear(n_jets);
+   } else {
+      // manual axes still come from setAxes()
+      findAxes(n_jets, inputJets, _currentAxes, workspace._seedAxes, workspace._axes, workspace._axesFinderWorkspace);
+      _measureFunction->result(inputJets, workspace._axes, workspace._tau_components, &workspace._assignment, &workspace._grid);
+   }
+   return workspace._tau_components;
+}
+
+// Axes of the calculation above, with the same treatment of too few particles
+const std::vector<fastjet::PseudoJet>& Njettiness::getAxes(unsigned n_jets, const std::vector<fastjet::PseudoJet> & inputJets, NjettinessWorkspace & workspace) const {
+   if (inputJets.size() <= n_jets) {
+      workspace._axes.assign(inputJets.begin(), inputJets.end());
+      workspace._axes.resize(n_jets,fastjet::PseudoJet(0.0,0.0,0.0,0.0));
+      workspace._seedAxes = workspace._axes;
+   } else {
+      findAxes(n_jets, inputJets, _currentAxes, workspace._seedAxes, workspace._axes, workspace._axesFinderWorkspace);
+   }
+   return workspace._axes;
+}
+
+// Jet (and beam) partition for the workspace result.
+// inputJets must be the particles that were given to getTauComponents.
+std::vector<fastjet::PseudoJet> Njettiness::getJets(const std::vector<fastjet::PseudoJet> & inputJets, const NjettinessWorkspace & workspace, fastjet::PseudoJet * beam) const {
+   if (inputJets.size() <= workspace._axes.size()) {  // each particle is its own jet
+      if (beam) *beam = PseudoJet(0.0,0.0,0.0,0.0);
+      return workspace._axes;
+   }
+   return _measureFunction->get_partition_from_assignment(inputJets, workspace._assignment, workspace._axes.size(), beam);
+}
+
+// Runs the starting axes finder and, if there is one, the minimization after it
+void Njettiness::findAxes(unsigned n_jets, const std::vector<fastjet::PseudoJet> & inputJets,
+                          const std::vector<fastjet::PseudoJet> & manualAxes,
+                          std::vector<fastjet::PseudoJet> & seedAxes,
+                          std::vector<fastjet::PseudoJet> & axes,
+                          AxesFinderWorkspace & workspace) const {
+   _startingAxesFinder->getAxesInto(n_jets,inputJets,manualAxes,seedAxes,workspace); //sets starting point for minimization
+   if (_finishingAxesFinder) {
+      _finishingAxesFinder->getAxesInto(n_jets,inputJets,seedAxes,axes,workspace);
+   } else {
+      axes = seedAxes;
+   }
+}
+
+// Find partition and store information
+// (jet information in _currentJets, beam in _currentBeam)
+void Njettiness::setCurrentJets() const {
+   _currentJets = _measureFunction->get_partition_from_assignment(_currentInputs, _currentAssignment, _currentAxes.size(), &_currentBeam);
+   _hasCurrentJets = true;
+}
    
    
 // Partition a list of particles according to which N-jettiness axis they are closest to.
@@ -48,6 +48,46 @@ namespace contrib {
 //
 ///////
 
+//------------------------------------------------------------------------
+/// \class NjettinessWorkspace
+// Results and scratch space for Njettiness::getTauComponents(n_jets, inputJets, workspace).
+// Keeping one workspace per loop (or per thread) and passing it to every call means the
+// calculation stops allocating once the buffers have grown to the largest jet seen
+// (axes finders that run FastJet clustering still allocate inside FastJet).
+class NjettinessWorkspace {
+public:
+   NjettinessWorkspace() {}
+   
+   // Refills particles() with the constituents of jet, in the order of jet.constituents().
+   // The history of a ClusterSequence jet is read directly, so only a composite jet (e.g. from
+   // join or a groomer) allocates, for the list of its pieces.
+   const std::vector<fastjet::PseudoJet>& setParticles(const fastjet::PseudoJet& jet);
+   const std::vector<fastjet::PseudoJet>& particles() const {return _particles;}
+   
+   // results of the last getTauComponents call with this workspace
+   const TauComponents& tauComponents() const {return _tau_components;}
+   const std::vector<fastjet::PseudoJet>& axes() const {return _axes;}
+   const std::vector<fastjet::PseudoJet>& seedAxes() const {return _seedAxes;}
+   // axis index of each input particle (-1 for the beam)
+   const std::vector<int>& assignment() const {return _assignment;}
+   // counts of the minimizations of all calls with this workspace
+   const MinimizationStats& minimizationStats() const {return _axesFinderWorkspace.stats();}
+   
+private:
+   friend class Njettiness;
+   
+   TauComponents _tau_components;
+   std::vector<fastjet::PseudoJet> _axes;
+   std::vector<fastjet::PseudoJet> _seedAxes;
+   std::vector<int> _assignment;
+   AxisGrid _grid;
+   AxesFinderWorkspace _axesFinderWorkspace;
+   
+   std::vector<fastjet::PseudoJet> _particles;
+   std::vector<int> _historyStack;  // cluster history indices still to be unfolded
+   void addConstituents(const fastjet::PseudoJet& jet);
+};
+
 //------------------------------------------------------------------------
 /// \class Njettiness
 // Njettiness uses AxesFinder and MeasureFunction together in order to find tau_N for the event. The user specifies
@@ -108,7 +148,7 @@ public:
               double para1 = std::numeric_limits<double>::quiet_NaN(),
               double para2 = std::numeric_limits<double>::quiet_NaN(),
               double para3 = std::numeric_limits<double>::quiet_NaN())
-   : _axes_def(createAxesDef(axes_mode)), _measure_def(createMeasureDef(measure_mode, num_para, para1, para2, para3)) {
+   : _axes_def(createAxesDef(axes_mode)), _measure_def(createMeasureDef(measure_mode, num_para, para1, para2, para3)), _hasCurrentJets(false) {
       setMeasureFunctionAndAxesFinder();  // call helper function to do the hard work
    }
 
@@ -127,6 +167,29 @@ public:
    double getTau(unsigned n_jets, const std::vector<fastjet::PseudoJet> & inputJets) const {
       return getTauComponents(n_jets, inputJets).tau();
    }
+   
+   // Same calculation, but the results and all scratch space are kept in workspace.
+   // This object is not changed (currentAxes() etc. keep their values), and the
+   // returned reference stays valid until the workspace is used again.
+   const TauComponents& getTauComponents(unsigned n_jets, const std::vector<fastjet::PseudoJet> & inputJets,
+                                         NjettinessWorkspace & workspace) const;
+   
+   double getTau(unsigned n_jets, const std::vector<fastjet::PseudoJet> & inputJets,
+                 NjettinessWorkspace & workspace) const {
+      return getTauComponents(n_jets, inputJets, workspace).tau();
+   }
+   
+   // Only finds the axes that getTauComponents(n_jets, inputJets, workspace) would use, without
+   // evaluating tau (e.g. to evaluate them with several measures, as NsubjettinessMultiBeta does).
+   // The returned reference is workspace.axes().
+   const std::vector<fastjet::PseudoJet>& getAxes(unsigned n_jets, const std::vector<fastjet::PseudoJet> & inputJets,
+                                                  NjettinessWorkspace & workspace) const;
+   
+   // Jet partition (and, if beam is given, beam partition) for the result in workspace.
+   // inputJets must be the same particles that were passed to getTauComponents.
+   std::vector<fastjet::PseudoJet> getJets(const std::vector<fastjet::PseudoJet> & inputJets,
+                                           const NjettinessWorkspace & workspace,
+                                           fastjet::PseudoJet * beam = NULL) const;
 
    // Return all relevant information about tau components
    TauComponents currentTauComponents() const {return _current_tau_components;}
@@ -135,9 +198,20 @@ public:
    // Return seedAxes used if onepass minimization (otherwise, same as currentAxes)
    std::vector<fastjet::PseudoJet> seedAxes() const { return _seedAxes;}
    // Return jet partition found by getTauComponents.
-   std::vector<fastjet::PseudoJet> currentJets() const {return _currentJets;}
+   // (The partition jets are only built the first time they are asked for.)
+   std::vector<fastjet::PseudoJet> currentJets() const {
+      if (!_hasCurrentJets) setCurrentJets();
+      return _currentJets;
+   }
    // Return beam partition found by getTauComponents.
-   fastjet::PseudoJet currentBeam() const {return _currentBeam;}
+   fastjet::PseudoJet currentBeam() const {
+      if (!_hasCurrentJets) setCurrentJets();
+      return _currentBeam;
+   }
+   
+   // counts of the minimizations of all getTauComponents(n_jets, inputJets) calls
+   // (the workspace versions count in their workspace)
+   const MinimizationStats& minimizationStats() const {return _axesFinderWorkspace.stats();}
    
    // partition inputs by Voronoi (each vector stores indices corresponding to inputJets)
    std::vector<std::list<int> > getPartitionList(const std::vector<fastjet::PseudoJet> & inputJets) const;
@@ -164,6 +238,24 @@ private:
    mutable std::vector<fastjet::PseudoJet> _currentJets; //partitioning information
    mutable fastjet::PseudoJet _currentBeam; //return beam, if requested
    
+   // What is needed to build _currentJets and _currentBeam on request
+   mutable bool _hasCurrentJets; // false until the partition for the current axes is built
+   mutable std::vector<fastjet::PseudoJet> _currentInputs; // particles passed to getTauComponents
+   mutable std::vector<int> _currentAssignment; // axis of each particle (-1 for beam)
+   
+   // builds _currentJets and _currentBeam from _currentAssignment
+   void setCurrentJets() const;
+   
+   // scratch space reused by getTauComponents(n_jets, inputJets)
+   mutable AxesFinderWorkspace _axesFinderWorkspace;
+   
+   // runs the starting and finishing axes finders
+   void findAxes(unsigned n_jets, const std::vector<fastjet::PseudoJet> & inputJets,
+                 const std::vector<fastjet::PseudoJet> & manualAxes,
+                 std::vector<fastjet::PseudoJet> & seedAxes,
+                 std::vector<fastjet::PseudoJet> & axes,
+                 AxesFinderWorkspace & workspace) const;
+   
    // created separate function to set MeasureFunction and AxesFinder in order to keep constructor cleaner.
    void setMeasureFunctionAndAxesFinder();
    
@@ -65,7 +65,9 @@ class OnePass_AntiKT_Axes;   // (R0)
 class OnePass_WTA_KT_Axes;
 class OnePass_WTA_CA_Axes;
 class OnePass_Manual_Axes;
-class MultiPass_Axes;
+class MultiPass_Axes;         // (Npass, nThreads, batchSize, stopWindow, seed)
+class WarmStart_Axes;                  // (standard AxesDefinition)
+class OnePass_WarmStart_WTA_KT_Axes;
 
 // Below are just technical implementations of the variable axes and measures.
   
@@ -299,6 +301,8 @@ private:
 class AxesDefinition {
    
 public:
+   AxesDefinition() : _precision(-1.0), _halt(-1), _incremental(false), _single_precision(false) {}
+   
    // description of axes (and any parameters)
    virtual std::string short_description() const = 0;
    virtual std::string description() const = 0;
@@ -316,8 +320,41 @@ public:
    virtual AxesFinder* createFinishingAxesFinder(const MeasureDefinition &) const {
       return NULL;  //By default, nothing.
    };
+   
+   // Convergence of the minimization step (OnePass_* and MultiPass_Axes), to trade accuracy
+   // for speed: precision is the average axis movement per step below which the minimization
+   // stops (the change of tau for the geometric measures), halt the maximum number of steps.
+   // Negative values keep the defaults (1e-4 and 1000).  With incremental, only particles near
+   // the boundaries between axes are reassigned and axes that have stopped moving are frozen.
+   void setMinimizationParameters(double precision, int halt = -1, bool incremental = false) {
+      _precision = precision;
+      _halt = halt;
+      _incremental = incremental;
+   }
+   
+   // Runs the minimization steps in single precision (see AxesFinder::setSinglePrecision).
+   // validateSinglePrecision in NsubjettinessBatch.hh checks how much this changes tau on a sample.
+   void setSinglePrecision(bool single_precision = true) {
+      _single_precision = single_precision;
+   }
 
    virtual ~AxesDefinition() {};
+   
+protected:
+   // applies the settings above to a minimizing axes finder
+   AxesFinder* configureMinimization(AxesFinder* finder) const {
+      if (finder) {
+         finder->setMinimizationParameters(_precision, _halt, _incremental);
+         finder->setSinglePrecision(_single_precision);
+      }
+      return finder;
+   }
+   
+private:
+   double _precision;
+   int _halt;
+   bool _incremental;
+   bool _single_precision;
 };
 
 // kt axes
@@ -431,7 +468,7 @@ public:
    virtual bool supportsManualAxes() const {return false;}
 
    virtual AxesFinder* createStartingAxesFinder(const MeasureDefinition &) const {
-      return (new AxesFinderFromWTA_KT());
+      return (new AxesFinderFromWTAClustering(fastjet::kt_algorithm));
    }
 
    
@@ -459,7 +496,7 @@ public:
    virtual bool supportsManualAxes() const {return false;}
 
    virtual AxesFinder* createStartingAxesFinder(const MeasureDefinition &) const {
-      return (new AxesFinderFromWTA_CA());
+      return (new AxesFinderFromWTAClustering(fastjet::cambridge_algorithm));
    }
    
 };
@@ -489,7 +526,7 @@ public:
       return (new AxesFinderFromKT());
    }
    virtual AxesFinder* createFinishingAxesFinder(const MeasureDefinition & measure_def) const {
-      return measure_def.createOnePassAxesFinder();
+      return configureMinimization(measure_def.createOnePassAxesFinder());
    }
 
 };
@@ -519,7 +556,7 @@ public:
       return (new AxesFinderFromCA());
    }
    virtual AxesFinder* createFinishingAxesFinder(const MeasureDefinition & measure_def) const {
-      return measure_def.createOnePassAxesFinder();
+      return configureMinimization(measure_def.createOnePassAxesFinder());
    }
 };
 
@@ -552,7 +589,7 @@ public:
       return (new AxesFinderFromAntiKT(_R0));
    }
    virtual AxesFinder* createFinishingAxesFinder(const MeasureDefinition & measure_def) const {
-      return measure_def.createOnePassAxesFinder();
+      return configureMinimization(measure_def.createOnePassAxesFinder());
    }
 
 private:
@@ -581,10 +618,10 @@ public:
    virtual bool supportsManualAxes() const {return false;}
 
    virtual AxesFinder* createStartingAxesFinder(const MeasureDefinition & ) const {
-      return (new AxesFinderFromWTA_KT());
+      return (new AxesFinderFromWTAClustering(fastjet::kt_algorithm));
    }
    virtual AxesFinder* createFinishingAxesFinder(const MeasureDefinition & measure_def) const {
-      return measure_def.createOnePassAxesFinder();
+      return configureMinimization(measure_def.createOnePassAxesFinder());
    }
 };
 
@@ -613,10 +650,10 @@ public:
 
    
    virtual AxesFinder* createStartingAxesFinder(const MeasureDefinition & ) const {
-      return (new AxesFinderFromWTA_CA());
+      return (new AxesFinderFromWTAClustering(fastjet::cambridge_algorithm));
    }
    virtual AxesFinder* createFinishingAxesFinder(const MeasureDefinition & measure_def) const {
-      return measure_def.createOnePassAxesFinder();
+      return configureMinimization(measure_def.createOnePassAxesFinder());
    }
 
    
@@ -673,17 +710,25 @@ public:
       return (new AxesFinderFromUserInput());
    }
    virtual AxesFinder* createFinishingAxesFinder(const MeasureDefinition & measure_def) const {
-      return measure_def.createOnePassAxesFinder();
+      return configureMinimization(measure_def.createOnePassAxesFinder());
    }
 
    
 };
    
 // multi-pass minimization from kT starting point
+// The trials can be run in parallel: batchSize trials start from the same best axes, and are shared
+// out over nThreads threads.  For a given seed and batchSize, the axes do not depend on nThreads.
+// With stopWindow > 0, the search stops once stopWindow trials in a row did not improve tau.
 class MultiPass_Axes : public AxesDefinition {
 
 public:
-   MultiPass_Axes(unsigned int Npass) : _Npass(Npass) {}
+   MultiPass_Axes(unsigned int Npass,
+                  unsigned int nThreads = 1,
+                  unsigned int batchSize = 1,
+                  unsigned int stopWindow = 0,
+                  unsigned long seed = 0)
+   : _Npass(Npass), _nThreads(nThreads), _batchSize(batchSize), _stopWindow(stopWindow), _seed(seed) {}
 
    virtual std::string short_description() const {
       return "MultiPass";
@@ -692,7 +737,8 @@ public:
    virtual std::string description() const {
       std::stringstream stream;
       stream << std::fixed << std::setprecision(2)
-      << "Multi-Pass Axes (Npass = " << _Npass << ")";
+      << "Multi-Pass Axes (Npass = " << _Npass << ", batch = " << _batchSize
+      << ", stop window = " << _stopWindow << ", seed = " << _seed << ")";
       return stream.str();
    };
    
@@ -704,12 +750,80 @@ public:
    virtual AxesFinder* createStartingAxesFinder(const MeasureDefinition & ) const {
       return (new AxesFinderFromKT());
    }
-   virtual AxesFinder* createFnishingAxesFinder(const MeasureDefinition & measure_def) const {
-      return measure_def.createMultiPassAxesFinder(_Npass);
+   virtual AxesFinder* createFinishingAxesFinder(const MeasureDefinition & measure_def) const {
+      AxesFinder* finder = configureMinimization(measure_def.createMultiPassAxesFinder(_Npass));
+      AxesFinderFromKmeansMinimization* kmeans = dynamic_cast<AxesFinderFromKmeansMinimization*>(finder);
+      if (kmeans) {
+         kmeans->setParallelism(_nThreads, _batchSize);
+         kmeans->setStopWindow(_stopWindow);
+         kmeans->setSeed(_seed);
+      }
+      return finder;
    }
    
 private:
    unsigned int _Npass;
+   unsigned int _nThreads;
+   unsigned int _batchSize;
+   unsigned int _stopWindow;
+   unsigned long _seed;
+   
+};
+
+// Warm-started axes: the axes given with setAxes() (or, if none are set, the axes from the
+// previous calculation) replace the starting axes of another AxesDefinition.  Useful when
+// the axes of a related calculation are already known, e.g. tau_2 axes to start tau_3, or
+// the axes of a pixelized jet to start the unpixelized one.  The minimization is run from the
+// warm-start axes if their tau is below that of the standard axes, and from the standard axes
+// otherwise; a warm-start result above that tau, unconverged, or with an axis without particles
+// is checked against the standard result (see AxesFinderFromWarmStart).  This saves steps, but
+// the warm start can end in a different local minimum than the standard axes, with a larger
+// tau: compare Njettiness::minimizationStats() and the taus with and without the warm start.
+class WarmStart_Axes : public AxesDefinition {
+
+public:
+   WarmStart_Axes(const AxesDefinition & standard_axes_def)
+   : _standard_axes_def(standard_axes_def.create()) {}
+
+   virtual std::string short_description() const {
+      return "WarmStart " + _standard_axes_def->short_description();
+   };
+   
+   virtual std::string description() const {
+      std::stringstream stream;
+      stream << std::fixed << std::setprecision(2)
+      << "Warm-Started " << _standard_axes_def->description();
+      return stream.str();
+   };
+   
+   virtual WarmStart_Axes* create() const {return new WarmStart_Axes(*this);}
+
+   virtual bool givesRandomizedResults() const {return _standard_axes_def->givesRandomizedResults();}
+   virtual bool supportsManualAxes() const {return true;}
+
+   // the starting finder runs the minimization itself (with the minimization parameters of
+   // this definition, not of the standard one), since it may need it twice
+   virtual AxesFinder* createStartingAxesFinder(const MeasureDefinition & measure_def) const {
+      return (new AxesFinderFromWarmStart(_standard_axes_def->createStartingAxesFinder(measure_def),
+                                          configureMinimization(_standard_axes_def->createFinishingAxesFinder(measure_def)),
+                                          measure_def.createMeasureFunction()));
+   }
+   virtual AxesFinder* createFinishingAxesFinder(const MeasureDefinition & /*measure_def*/) const {
+      return NULL;
+   }
+   
+private:
+   SharedPtr<const AxesDefinition> _standard_axes_def;
+   
+};
+
+// Onepass minimization from warm-start axes, falling back to winner-take-all kt axes
+class OnePass_WarmStart_WTA_KT_Axes : public WarmStart_Axes {
+
+public:
+   OnePass_WarmStart_WTA_KT_Axes() : WarmStart_Axes(OnePass_WTA_KT_Axes()) {}
+   
+   virtual OnePass_WarmStart_WTA_KT_Axes* create() const {return new OnePass_WarmStart_WTA_KT_Axes(*this);}
    
 };
    
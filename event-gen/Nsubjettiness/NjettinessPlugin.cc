@@ -33,9 +33,27 @@ namespace contrib{
 std::string NjettinessPlugin::description() const {return "N-jettiness jet finder";}
 
 
+// Finds the jets directly: each jet is the four-momentum sum of the particles
+// assigned to its axis, accumulated in one pass over the assignment.
+void NjettinessJetFinder::find(const std::vector<fastjet::PseudoJet> & particles, NjettinessJets & result) const
+{
+   _njettinessFinder.getTauComponents(_N, particles, result._workspace);
+   
+   const std::vector<int>& labels = result._workspace.assignment();
+   result._jets.assign(result._workspace.axes().size(), PseudoJet(0.0,0.0,0.0,0.0));
+   result._beam = PseudoJet(0.0,0.0,0.0,0.0);
+   for (unsigned i = 0; i < particles.size(); i++) {
+      if (labels[i] == -1) result._beam += particles[i];
+      else result._jets[labels[i]] += particles[i];
+   }
+}
+
+
 // Clusters the particles according to the Njettiness jet algorithm
 // Apologies for the complication with this code, but we need to make
-// a fake jet clustering tree.  The partitioning is done by getPartitionList
+// a fake jet clustering tree.  The particles of each jet are merged one by one,
+// from the highest index down, and the result is recombined with the beam.
+// (NjettinessJetFinder gives the same jets without any of this.)
 void NjettinessPlugin::run_clustering(ClusterSequence& cs) const
 {
    std::vector<fastjet::PseudoJet> particles = cs.jets();
@@ -46,39 +64,49 @@ void NjettinessPlugin::run_clustering(ClusterSequence& cs) const
       particles[i].set_structure_shared_ptr(SharedPtr<PseudoJetStructureBase>());
    }
    
+   NjettinessWorkspace workspace;
+   const TauComponents& tau_components = _njettinessFinder.getTauComponents(_N, particles, workspace);
+   const std::vector<int>& assignment = workspace.assignment();
+   unsigned n_axes = workspace.axes().size();
    
-   _njettinessFinder.getTau(_N, particles);
-
-   std::vector<std::list<int> > partition = _njettinessFinder.getPartitionList(particles);
+   // particles of each axis, in increasing index (counting sort on the assignment)
+   std::vector<unsigned> start(n_axes + 1, 0);
+   for (unsigned i = 0; i < assignment.size(); i++) {
+      if (assignment[i] >= 0) start[assignment[i] + 1]++;
+   }
+   for (unsigned j = 0; j < n_axes; j++) start[j + 1] += start[j];
+   std::vector<int> members(start[n_axes]);
+   std::vector<unsigned> next(start.begin(), start.end() - 1);
+   for (unsigned i = 0; i < assignment.size(); i++) {
+      if (assignment[i] >= 0) members[next[assignment[i]]++] = i;
+   }
 
    std::vector<fastjet::PseudoJet> jet_indices_for_extras;
+   std::vector<int> labels_for_extras;
 
    // output clusterings for each jet
-   for (size_t i0 = 0; i0 < partition.size(); ++i0) {
-      size_t i = partition.size() - 1 - i0; // reversed order of reading to match axes order
-      std::list<int>& indices = partition[i];
-      if (indices.size() == 0) continue;
-      while (indices.size() > 1) {
-         int merge_i = indices.back(); indices.pop_back();
-         int merge_j = indices.back(); indices.pop_back();
+   for (unsigned i0 = 0; i0 < n_axes; ++i0) {
+      unsigned i = n_axes - 1 - i0; // reversed order of reading to match axes order
+      if (start[i] == start[i + 1]) continue;
+      int finalJet = members[start[i + 1] - 1];
+      for (unsigned k = start[i + 1] - 1; k > start[i]; k--) {
          int newIndex;
          double fakeDij = -1.0;
-      
-         cs.plugin_record_ij_recombination(merge_i, merge_j, fakeDij, newIndex);
-
-         indices.push_back(newIndex);
+         cs.plugin_record_ij_recombination(finalJet, members[k - 1], fakeDij, newIndex);
+         finalJet = newIndex;
       }
       double fakeDib = -1.0;
       
-      int finalJet = indices.back();
       cs.plugin_record_iB_recombination(finalJet, fakeDib);
       jet_indices_for_extras.push_back(cs.jets()[finalJet]);  // Get the four vector for the final jets to compare later.
+      labels_for_extras.push_back(i);
    }
 
    //HACK:  Re-reverse order of reading to match CS order
    reverse(jet_indices_for_extras.begin(),jet_indices_for_extras.end());
+   reverse(labels_for_extras.begin(),labels_for_extras.end());
 
-   NjettinessExtras * extras = new NjettinessExtras(_njettinessFinder.currentTauComponents(),jet_indices_for_extras,_njettinessFinder.currentAxes());
+   NjettinessExtras * extras = new NjettinessExtras(tau_components,jet_indices_for_extras,workspace.axes(),labels_for_extras);
    cs.plugin_associate_extras(std::auto_ptr<ClusterSequence::Extras>(extras));
    
 }
@@ -49,7 +49,17 @@ namespace contrib {
 class NjettinessExtras : public ClusterSequence::Extras {
    
    public:
-      NjettinessExtras(TauComponents tau_components, std::vector<fastjet::PseudoJet> jets, std::vector<fastjet::PseudoJet> axes) : _tau_components(tau_components), _jets(jets), _axes(axes) {}
+      // jets[i] belongs to axes[i]
+      NjettinessExtras(TauComponents tau_components, std::vector<fastjet::PseudoJet> jets, std::vector<fastjet::PseudoJet> axes) : _tau_components(tau_components), _jets(jets), _axes(axes) {
+         std::vector<int> labels(_jets.size());
+         for (unsigned i = 0; i < labels.size(); i++) labels[i] = i;
+         setLabels(labels);
+      }
+      
+      // jets[i] belongs to axes[labels[i]] (axes without particles have no jet)
+      NjettinessExtras(TauComponents tau_components, std::vector<fastjet::PseudoJet> jets, std::vector<fastjet::PseudoJet> axes, const std::vector<int> & labels) : _tau_components(tau_components), _jets(jets), _axes(axes) {
+         setLabels(labels);
+      }
       
       double totalTau() const {return _tau_components.tau();}
       std::vector<double> subTaus() const {return _tau_components.jet_pieces();}
@@ -61,8 +71,9 @@ class NjettinessExtras : public ClusterSequence::Extras {
       }
       
       double subTau(const fastjet::PseudoJet& jet) const {
-         if (labelOf(jet) == -1) return std::numeric_limits<double>::quiet_NaN(); // nonsense
-         return _tau_components.jet_pieces()[labelOf(jet)];
+         int label = labelOf(jet);
+         if (label == -1) return std::numeric_limits<double>::quiet_NaN(); // nonsense
+         return _tau_components.jet_pieces()[label];
       }
       
       double beamTau() const {
@@ -82,16 +93,22 @@ private:
    TauComponents _tau_components;
    std::vector<fastjet::PseudoJet> _jets;
    std::vector<fastjet::PseudoJet> _axes;
+   std::vector<int> _labelOfHistory; // axis index of each cluster_hist_index (-1 if not a jet)
    
-   int labelOf(const fastjet::PseudoJet& jet) const {
-      int thisJet = -1;
-      for (unsigned int i = 0; i < _jets.size(); i++) {
-         if (_jets[i].cluster_hist_index() == jet.cluster_hist_index()) {
-            thisJet = i;
-            break;
-         }
+   void setLabels(const std::vector<int> & labels) {
+      for (unsigned i = 0; i < _jets.size(); i++) {
+         int hist = _jets[i].cluster_hist_index();
+         if (hist < 0) continue;
+         if (hist >= (int) _labelOfHistory.size()) _labelOfHistory.resize(hist + 1, -1);
+         _labelOfHistory[hist] = labels[i];
       }
-      return thisJet;
+   }
+   
+   // O(1) lookup of the axis of a jet by its position in the clustering history
+   int labelOf(const fastjet::PseudoJet& jet) const {
+      int hist = jet.cluster_hist_index();
+      if (hist < 0 || hist >= (int) _labelOfHistory.size()) return -1;
+      return _labelOfHistory[hist];
    }
 };
 
@@ -134,6 +151,80 @@ inline const NjettinessExtras * njettiness_extras(const fastjet::ClusterSequence
  *
  */
 
+//------------------------------------------------------------------------
+/// \class NjettinessJets
+// The result of NjettinessJetFinder: the jets, their axes and sub-taus, and the
+// jet of each input particle.  All vectors are in axis order.  The jets are the
+// plain four-momentum sums of their particles, without constituents or a
+// ClusterSequence (use labels() to find the particles of a jet).  Reusing one
+// NjettinessJets for many events avoids allocating once it has grown.
+class NjettinessJets {
+
+public:
+   NjettinessJets() {}
+   
+   // one jet per axis (a zero four-vector if no particle is closest to that axis)
+   const std::vector<fastjet::PseudoJet>& jets() const {return _jets;}
+   const std::vector<fastjet::PseudoJet>& axes() const {return _workspace.axes();}
+   
+   // sum of the particles closer to the beam than to any axis
+   const fastjet::PseudoJet& beam() const {return _beam;}
+   
+   // axis index of each input particle (-1 for the beam)
+   const std::vector<int>& labels() const {return _workspace.assignment();}
+   
+   const TauComponents& tauComponents() const {return _workspace.tauComponents();}
+   double totalTau() const {return tauComponents().tau();}
+   const std::vector<double>& subTaus() const {return tauComponents().jet_pieces();}
+   double beamTau() const {return tauComponents().beam_piece();}
+   
+private:
+   friend class NjettinessJetFinder;
+   
+   NjettinessWorkspace _workspace;
+   std::vector<fastjet::PseudoJet> _jets;
+   fastjet::PseudoJet _beam;
+};
+
+//------------------------------------------------------------------------
+/// \class NjettinessJetFinder
+// The N-jettiness jet algorithm (see NjettinessPlugin below) without a
+// ClusterSequence: the N jets, axes and sub-taus are returned directly, with
+// no clustering history to record.  This is the faster choice when only the
+// jets and their taus are needed; NjettinessPlugin gives the same jets
+// through the usual FastJet interface.
+class NjettinessJetFinder {
+public:
+
+   // Same arguments as NjettinessPlugin
+   NjettinessJetFinder(int N,
+                       const AxesDefinition & axes_def,
+                       const MeasureDefinition & measure_def)
+   : _njettinessFinder(axes_def, measure_def), _N(N) {}
+   
+   // Finds the jets of particles, with the results and scratch space in result
+   void find(const std::vector<fastjet::PseudoJet> & particles, NjettinessJets & result) const;
+   
+   // Same, returning a new result
+   NjettinessJets find(const std::vector<fastjet::PseudoJet> & particles) const {
+      NjettinessJets result;
+      find(particles, result);
+      return result;
+   }
+   
+   // To set axes for manual use
+   void setAxes(const std::vector<fastjet::PseudoJet> & myAxes) {
+      _njettinessFinder.setAxes(myAxes);
+   }
+   
+   int N() const {return _N;}
+   
+private:
+   
+   Njettiness _njettinessFinder;
+   int _N;
+};
+
 class NjettinessPlugin : public JetDefinition::Plugin {
 public:
 
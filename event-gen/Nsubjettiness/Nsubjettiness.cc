@@ -39,6 +39,15 @@ TauComponents Nsubjettiness::component_result(const PseudoJet& jet) const {
    return _njettinessFinder.getTauComponents(_N, particles);
 }
 
+// the constituents go into the workspace too, so nothing is allocated once it has grown
+double Nsubjettiness::result(const PseudoJet& jet, NjettinessWorkspace& workspace) const {
+   return _njettinessFinder.getTau(_N, workspace.setParticles(jet), workspace);
+}
+
+const TauComponents& Nsubjettiness::component_result(const PseudoJet& jet, NjettinessWorkspace& workspace) const {
+   return _njettinessFinder.getTauComponents(_N, workspace.setParticles(jet), workspace);
+}
+
 //ratio result uses Nsubjettiness result to find the ratio tau_N/tau_M, where N and M are specified by user
 double NsubjettinessRatio::result(const PseudoJet& jet) const {
    double numerator = _nsub_numerator.result(jet);
@@ -46,6 +55,56 @@ double NsubjettinessRatio::result(const PseudoJet& jet) const {
    return numerator/denominator;
 }
 
+// the axes are found with the measure of the first beta
+static double first_beta(const std::vector<double>& betas) {
+   if (betas.empty()) throw Error("NsubjettinessMultiBeta needs at least one value of beta");
+   return betas[0];
+}
+
+NsubjettinessMultiBeta::NsubjettinessMultiBeta(int N, const AxesDefinition& axes_def, const std::vector<double>& betas, double R0)
+: _betas(betas), _njettinessFinder(axes_def, NormalizedMeasure(first_beta(betas), R0)), _N(N) {
+   setMeasureFunctions(true, R0);
+}
+
+NsubjettinessMultiBeta::NsubjettinessMultiBeta(int N, const AxesDefinition& axes_def, const std::vector<double>& betas)
+: _betas(betas), _njettinessFinder(axes_def, UnnormalizedMeasure(first_beta(betas))), _N(N) {
+   setMeasureFunctions(false, std::numeric_limits<double>::quiet_NaN());
+}
+
+void NsubjettinessMultiBeta::setMeasureFunctions(bool normalized, double R0) {
+   for (unsigned i = 0; i < _betas.size(); i++) {
+      if (normalized) _measureFunctions.push_back(SharedPtr<MeasureFunction>(NormalizedMeasure(_betas[i], R0).createMeasureFunction()));
+      else _measureFunctions.push_back(SharedPtr<MeasureFunction>(UnnormalizedMeasure(_betas[i]).createMeasureFunction()));
+      _measures.push_back(_measureFunctions.back().get());
+   }
+}
+
+std::vector<double> NsubjettinessMultiBeta::result(const PseudoJet& jet) const {
+   std::vector<TauComponents> tau_components = component_result(jet);
+   std::vector<double> taus(tau_components.size());
+   for (unsigned i = 0; i < tau_components.size(); i++) taus[i] = tau_components[i].tau();
+   return taus;
+}
+
+// (with too few particles, every tau is zero, as in Njettiness)
+std::vector<TauComponents> NsubjettinessMultiBeta::component_result(const PseudoJet& jet) const {
+   std::vector<fastjet::PseudoJet> particles = jet.constituents();
+   const std::vector<fastjet::PseudoJet>& axes = _njettinessFinder.getAxes(_N, particles, _workspace);
+   if (particles.size() <= (unsigned) _N) {
+      std::vector<TauComponents> tau_components(_betas.size());
+      for (unsigned i = 0; i < tau_components.size(); i++) tau_components[i].clear(_N);
+      return tau_components;
+   }
+   return component_result(particles, axes);
+}
+
+std::vector<TauComponents> NsubjettinessMultiBeta::component_result(const std::vector<fastjet::PseudoJet>& particles,
+                                                                    const std::vector<fastjet::PseudoJet>& axes) const {
+   std::vector<TauComponents> tau_components;
+   _measures[0]->results(particles, axes, _measures, tau_components);
+   return tau_components;
+}
+
 } // namespace contrib
 
 FASTJET_END_NAMESPACE
@@ -127,6 +127,13 @@ public:
    /// returns components of tau_N, so that user can find individual tau values.
    TauComponents component_result(const PseudoJet& jet) const;
    
+   /// same as result(), but with the axes, tau components and scratch space kept in workspace
+   /// (currentAxes() etc. are then not updated)
+   double result(const PseudoJet& jet, NjettinessWorkspace& workspace) const;
+   
+   /// same as component_result(), with the results in workspace
+   const TauComponents& component_result(const PseudoJet& jet, NjettinessWorkspace& workspace) const;
+   
    /// returns current axes found by result() calculation
    std::vector<fastjet::PseudoJet> currentAxes() const {
       return _njettinessFinder.currentAxes();
@@ -226,6 +233,64 @@ private:
 
 };
 
+//------------------------------------------------------------------------
+/// \class NsubjettinessMultiBeta
+// NsubjettinessMultiBeta gives tau_N for several values of the angular exponent
+// beta at once, with the same axes.  For the default measures, which particles
+// go to which axis depends only on the distance and not on beta, so the axes
+// are found once (with the measure of the first beta, which only matters for
+// minimized axes) and a single pass over the particles finds each particle's
+// axis and distance and adds it to tau_N for every beta.  With axes that do not
+// depend on the measure (e.g. WTA_KT_Axes), each value is the same as that of
+// an Nsubjettiness with that beta.
+class NsubjettinessMultiBeta : public FunctionOfPseudoJet<std::vector<double> > {
+public:
+
+   // tau_N with NormalizedMeasure(beta,R0) for each beta in betas
+   NsubjettinessMultiBeta(int N,
+                          const AxesDefinition& axes_def,
+                          const std::vector<double>& betas,
+                          double R0);
+
+   // tau_N with UnnormalizedMeasure(beta) for each beta in betas
+   NsubjettinessMultiBeta(int N,
+                          const AxesDefinition& axes_def,
+                          const std::vector<double>& betas);
+
+   /// returns tau_N for each beta, measured on the constituents of this jet
+   std::vector<double> result(const PseudoJet& jet) const;
+
+   /// returns the components of tau_N for each beta
+   std::vector<TauComponents> component_result(const PseudoJet& jet) const;
+
+   /// components of tau_N for each beta, with the given axes (no axes are found)
+   std::vector<TauComponents> component_result(const std::vector<fastjet::PseudoJet>& particles,
+                                               const std::vector<fastjet::PseudoJet>& axes) const;
+
+   const std::vector<double>& betas() const {return _betas;}
+
+   /// returns the axes found by the last result() calculation
+   std::vector<fastjet::PseudoJet> currentAxes() const {return _workspace.axes();}
+
+   // To set axes for manual use
+   void setAxes(const std::vector<fastjet::PseudoJet> & myAxes) {
+      _njettinessFinder.setAxes(myAxes);
+   }
+
+private:
+
+   // fills _measureFunctions and _measures, one per beta
+   void setMeasureFunctions(bool normalized, double R0);
+
+   std::vector<double> _betas;
+   Njettiness _njettinessFinder;  // only used to find the axes
+   std::vector<SharedPtr<MeasureFunction> > _measureFunctions;
+   std::vector<const MeasureFunction*> _measures;  // same as above, as MeasureFunction::results takes them
+   int _N;
+
+   mutable NjettinessWorkspace _workspace;
+};
+
 } // namespace contrib
 
 FASTJET_END_NAMESPACE
@@ -0,0 +1,141 @@
+//  Nsubjettiness Package
+//  Questions/Comments?  jthaler@jthaler.net
+//
+//  Copyright (c) 2011-14
+//  Jesse Thaler, Ken Van Tilburg, Christopher K. Vermilion, and TJ Wilkason
+//
+//----------------------------------------------------------------------
+// This file is part of FastJet contrib.
+//
+// It is free software; you can redistribute it and/or modify it under
+// the terms of the GNU General Public License as published by the
+// Free Software Foundation; either version 2 of the License, or (at
+// your option) any later version.
+//
+// It is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+// License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this code. If not, see <http://www.gnu.org/licenses/>.
+//----------------------------------------------------------------------
+
+
+#include "NsubjettinessBatch.hh"
+
+#include <algorithm>
+#include <cmath>
+
+FASTJET_BEGIN_NAMESPACE      // defined in fastjet/internal/base.hh
+
+namespace contrib {
+
+// Jets handed to a thread at a time (small enough to balance the load,
+// large enough that the pool overhead does not matter)
+static const unsigned batch_jets_per_task = 16;
+
+NsubjettinessBatch::NsubjettinessBatch(const std::vector<unsigned> & Ns,
+                                       const AxesDefinition & axes_def,
+                                       const MeasureDefinition & measure_def,
+                                       unsigned n_threads,
+                                       bool store_axes)
+: _njettinessFinder(axes_def, measure_def), _Ns(Ns), _storeAxes(store_axes) {
+   if (n_threads > 1) _threadPool.reset(new ThreadPool(n_threads));
+   _workspaces.resize(this->n_threads());
+}
+
+void NsubjettinessBatch::prepare(unsigned n_jets, NsubjettinessTable & table) const {
+   table._n_jets = n_jets;
+   table._Ns = _Ns;
+   table._taus.resize(n_jets * _Ns.size());
+   table._axes_per_jet = 0;
+   table._axes_offset.resize(_Ns.size());
+   for (unsigned i = 0; i < _Ns.size(); i++) {
+      table._axes_offset[i] = table._axes_per_jet;
+      table._axes_per_jet += _Ns[i];
+   }
+   if (!_storeAxes) table._axes_per_jet = 0;
+   table._axes.resize(n_jets * table._axes_per_jet);
+}
+
+void NsubjettinessBatch::evaluateJet(unsigned jet, const std::vector<fastjet::PseudoJet> & particles,
+                                     NjettinessWorkspace & workspace, NsubjettinessTable & table) const {
+   double * taus = &table._taus[jet * _Ns.size()];
+   for (unsigned i = 0; i < _Ns.size(); i++) {
+      taus[i] = _njettinessFinder.getTau(_Ns[i], particles, workspace);
+      if (_storeAxes) {
+         std::copy(workspace.axes().begin(), workspace.axes().end(),
+                   table._axes.begin() + jet * table._axes_per_jet + table._axes_offset[i]);
+      }
+   }
+}
+
+void NsubjettinessBatch::evaluate(const fastjet::PseudoJet * jets, unsigned n_jets, NsubjettinessTable & table) const {
+   prepare(n_jets, table);
+   
+   unsigned n_tasks = (n_jets + batch_jets_per_task - 1) / batch_jets_per_task;
+   ThreadPool::Task task = [&](unsigned int t, unsigned int thread) {
+      unsigned end = std::min(n_jets, (t + 1) * batch_jets_per_task);
+      for (unsigned jet = t * batch_jets_per_task; jet < end; jet++) {
+         NjettinessWorkspace & workspace = _workspaces[thread];
+         evaluateJet(jet, workspace.setParticles(jets[jet]), workspace, table);
+      }
+   };
+   if (_threadPool) _threadPool->parallel_for(n_tasks, task);
+   else for (unsigned t = 0; t < n_tasks; t++) task(t, 0);
+}
+
+void NsubjettinessBatch::evaluate(const std::vector<std::vector<fastjet::PseudoJet> > & jet_particles, NsubjettinessTable & table) const {
+   unsigned n_jets = jet_particles.size();
+   prepare(n_jets, table);
+   
+   unsigned n_tasks = (n_jets + batch_jets_per_task - 1) / batch_jets_per_task;
+   ThreadPool::Task task = [&](unsigned int t, unsigned int thread) {
+      unsigned end = std::min(n_jets, (t + 1) * batch_jets_per_task);
+      for (unsigned jet = t * batch_jets_per_task; jet < end; jet++) {
+         evaluateJet(jet, jet_particles[jet], _workspaces[thread], table);
+      }
+   };
+   if (_threadPool) _threadPool->parallel_for(n_tasks, task);
+   else for (unsigned t = 0; t < n_tasks; t++) task(t, 0);
+}
+
+SinglePrecisionReport validateSinglePrecision(const std::vector<unsigned> & Ns,
+                                              const AxesDefinition & axes_def,
+                                              const MeasureDefinition & measure_def,
+                                              const std::vector<std::vector<fastjet::PseudoJet> > & sample,
+                                              unsigned n_threads) {
+   SharedPtr<AxesDefinition> double_def(axes_def.create());
+   double_def->setSinglePrecision(false);
+   SharedPtr<AxesDefinition> float_def(axes_def.create());
+   float_def->setSinglePrecision(true);
+   
+   NsubjettinessTable double_table, float_table;
+   NsubjettinessBatch(Ns, *double_def, measure_def, n_threads).evaluate(sample, double_table);
+   NsubjettinessBatch(Ns, *float_def, measure_def, n_threads).evaluate(sample, float_table);
+   
+   SinglePrecisionReport report;
+   report.n_taus = double_table.taus().size();
+   report.max_abs_deviation = 0.0;
+   report.max_rel_deviation = 0.0;
+   report.worst_jet = 0;
+   report.worst_N = Ns.empty() ? 0 : Ns[0];
+   for (unsigned jet = 0; jet < double_table.n_jets(); jet++) {
+      for (unsigned i = 0; i < Ns.size(); i++) {
+         double tau = double_table.tau(jet, i);
+         double deviation = std::fabs(float_table.tau(jet, i) - tau);
+         report.max_abs_deviation = std::max(report.max_abs_deviation, deviation);
+         if (tau > 0 && deviation / tau > report.max_rel_deviation) {
+            report.max_rel_deviation = deviation / tau;
+            report.worst_jet = jet;
+            report.worst_N = Ns[i];
+         }
+      }
+   }
+   return report;
+}
+
+} // namespace contrib
+
+FASTJET_END_NAMESPACE
@@ -0,0 +1,156 @@
+//  Nsubjettiness Package
+//  Questions/Comments?  jthaler@jthaler.net
+//
+//  Copyright (c) 2011-14
+//  Jesse Thaler, Ken Van Tilburg, Christopher K. Vermilion, and TJ Wilkason
+//
+//----------------------------------------------------------------------
+// This file is part of FastJet contrib.
+//
+// It is free software; you can redistribute it and/or modify it under
+// the terms of the GNU General Public License as published by the
+// Free Software Foundation; either version 2 of the License, or (at
+// your option) any later version.
+//
+// It is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+// License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this code. If not, see <http://www.gnu.org/licenses/>.
+//----------------------------------------------------------------------
+
+#ifndef __FASTJET_CONTRIB_NSUBJETTINESSBATCH_HH__
+#define __FASTJET_CONTRIB_NSUBJETTINESSBATCH_HH__
+
+#include <fastjet/internal/base.hh>
+
+#include "Njettiness.hh"
+#include "ThreadPool.hh"
+
+#include "fastjet/PseudoJet.hh"
+#include "fastjet/SharedPtr.hh"
+#include <vector>
+
+FASTJET_BEGIN_NAMESPACE      // defined in fastjet/internal/base.hh
+
+namespace contrib {
+
+//------------------------------------------------------------------------
+/// \class NsubjettinessTable
+// Results of NsubjettinessBatch: tau_N for every jet and every requested N,
+// stored row by row (one row per jet, in the order of the Ns), and optionally
+// the axes.  Reusing a table for the next batch keeps its storage.
+class NsubjettinessTable {
+
+public:
+   NsubjettinessTable() : _n_jets(0), _axes_per_jet(0) {}
+   
+   unsigned n_jets() const {return _n_jets;}
+   const std::vector<unsigned>& Ns() const {return _Ns;}
+   
+   // tau_{Ns()[i]} of jet
+   double tau(unsigned jet, unsigned i) const {return _taus[jet * _Ns.size() + i];}
+   
+   // the Ns().size() taus of jet
+   const double* row(unsigned jet) const {return &_taus[jet * _Ns.size()];}
+   
+   // all taus, n_jets() rows of Ns().size() values
+   const std::vector<double>& taus() const {return _taus;}
+   
+   // axes used for tau_{Ns()[i]} of jet (Ns()[i] of them), if the batch stores axes
+   bool has_axes() const {return _axes_per_jet > 0;}
+   const fastjet::PseudoJet* axes(unsigned jet, unsigned i) const {
+      return &_axes[jet * _axes_per_jet + _axes_offset[i]];
+   }
+   
+private:
+   friend class NsubjettinessBatch;
+   
+   unsigned _n_jets;
+   std::vector<unsigned> _Ns;
+   std::vector<double> _taus;
+   unsigned _axes_per_jet;                 // sum of the Ns (0 if no axes are stored)
+   std::vector<unsigned> _axes_offset;     // where the axes for each N start in a jet
+   std::vector<fastjet::PseudoJet> _axes;
+};
+
+//------------------------------------------------------------------------
+/// \class NsubjettinessBatch
+// Evaluates tau_N for many jets and several N at once, e.g. to re-analyze stored
+// jets.  The constituents of each jet are taken once for all the Ns, and the jets
+// are spread over a ThreadPool (with n_threads = 1 everything runs in the calling
+// thread), each thread reusing its own NjettinessWorkspace, so that the cost per
+// jet does not depend on the batch size and the work scales with the threads.
+// The results do not depend on the number of threads.
+//
+// The axes definition must find its axes by itself: manual axes (set with
+// setAxes() in Nsubjettiness) are not available here.  One batch object runs one
+// evaluate() at a time; use one object per calling thread otherwise.
+class NsubjettinessBatch {
+
+public:
+   NsubjettinessBatch(const std::vector<unsigned> & Ns,
+                      const AxesDefinition & axes_def,
+                      const MeasureDefinition & measure_def,
+                      unsigned n_threads = 1,
+                      bool store_axes = false);
+   
+   // tau_N of the constituents of each jet, as Nsubjettiness::result(jet) would give
+   void evaluate(const fastjet::PseudoJet * jets, unsigned n_jets, NsubjettinessTable & table) const;
+   
+   void evaluate(const std::vector<fastjet::PseudoJet> & jets, NsubjettinessTable & table) const {
+      evaluate(jets.data(), jets.size(), table);
+   }
+   
+   // Same, for jets given directly as their particles (e.g. read back from a file)
+   void evaluate(const std::vector<std::vector<fastjet::PseudoJet> > & jet_particles, NsubjettinessTable & table) const;
+   
+   const std::vector<unsigned>& Ns() const {return _Ns;}
+   unsigned n_threads() const {return _threadPool ? _threadPool->n_threads() : 1;}
+   
+private:
+   
+   Njettiness _njettinessFinder;
+   std::vector<unsigned> _Ns;
+   bool _storeAxes;
+   SharedPtr<ThreadPool> _threadPool;
+   
+   // per-thread scratch space
+   mutable std::vector<NjettinessWorkspace> _workspaces;
+   
+   // sizes the table for n_jets jets
+   void prepare(unsigned n_jets, NsubjettinessTable & table) const;
+   
+   // fills the row of one jet from its particles
+   void evaluateJet(unsigned jet, const std::vector<fastjet::PseudoJet> & particles,
+                    NjettinessWorkspace & workspace, NsubjettinessTable & table) const;
+};
+
+//------------------------------------------------------------------------
+/// \class SinglePrecisionReport
+// How far the taus from the single precision minimization (AxesDefinition::setSinglePrecision)
+// are from the double precision ones, as found by validateSinglePrecision.
+struct SinglePrecisionReport {
+   unsigned n_taus;               // number of taus compared
+   double max_abs_deviation;      // largest |tau_float - tau_double|
+   double max_rel_deviation;      // largest |tau_float - tau_double| / tau_double (for tau_double > 0)
+   unsigned worst_jet;            // jet and N of the largest relative deviation
+   unsigned worst_N;
+};
+
+// Evaluates tau_N on the sample (each entry the particles of one jet) for each of Ns,
+// once with the minimization in double and once in single precision, and reports the
+// largest deviation.  The axes_def settings are used apart from the precision.
+SinglePrecisionReport validateSinglePrecision(const std::vector<unsigned> & Ns,
+                                              const AxesDefinition & axes_def,
+                                              const MeasureDefinition & measure_def,
+                                              const std::vector<std::vector<fastjet::PseudoJet> > & sample,
+                                              unsigned n_threads = 1);
+
+} // namespace contrib
+
+FASTJET_END_NAMESPACE
+
+#endif  // __FASTJET_CONTRIB_NSUBJETTINESSBATCH_HH__
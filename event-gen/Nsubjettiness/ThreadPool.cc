@@ -0,0 +1,112 @@
+//  Nsubjettiness Package
+//  Questions/Comments?  jthaler@jthaler.net
+//
+//  Copyright (c) 2011-14
+//  Jesse Thaler, Ken Van Tilburg, Christopher K. Vermilion, and TJ Wilkason
+//
+//----------------------------------------------------------------------
+// This file is part of FastJet contrib.
+//
+// It is free software; you can redistribute it and/or modify it under
+// the terms of the GNU General Public License as published by the
+// Free Software Foundation; either version 2 of the License, or (at
+// your option) any later version.
+//
+// It is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+// License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this code. If not, see <http://www.gnu.org/licenses/>.
+//----------------------------------------------------------------------
+
+#include "ThreadPool.hh"
+
+FASTJET_BEGIN_NAMESPACE      // defined in fastjet/internal/base.hh
+
+namespace contrib {
+
+ThreadPool::ThreadPool(unsigned int n_threads)
+: _task(NULL), _n(0), _next(0), _generation(0), _busy(0), _stop(false) {
+   for (unsigned int thread = 1; thread < n_threads; thread++) {
+      _workers.push_back(std::thread(&ThreadPool::work, this, thread));
+   }
+}
+
+ThreadPool::~ThreadPool() {
+   {
+      std::lock_guard<std::mutex> lock(_mutex);
+      _stop = true;
+   }
+   _start.notify_all();
+   for (unsigned int i = 0; i < _workers.size(); i++) _workers[i].join();
+}
+
+void ThreadPool::parallel_for(unsigned int n, const Task & task) {
+   if (n == 0) return;
+   
+   // nothing to share
+   if (_workers.empty() || n == 1) {
+      for (unsigned int i = 0; i < n; i++) task(i, 0);
+      return;
+   }
+   
+   std::lock_guard<std::mutex> loopLock(_loopMutex);
+   {
+      std::lock_guard<std::mutex> lock(_mutex);
+      _task = &task;
+      _n = n;
+      _next = 0;
+      _busy = _workers.size();
+      _error = std::exception_ptr();
+      _generation++;
+   }
+   _start.notify_all();
+   
+   runTasks(0);
+   
+   std::exception_ptr error;
+   {
+      std::unique_lock<std::mutex> lock(_mutex);
+      while (_busy > 0) _done.wait(lock);
+      _task = NULL;
+      error = _error;
+   }
+   if (error) std::rethrow_exception(error);
+}
+
+// worker thread: wait for a loop, take part in it, repeat
+void ThreadPool::work(unsigned int thread) {
+   unsigned int seen = 0;
+   while (true) {
+      {
+         std::unique_lock<std::mutex> lock(_mutex);
+         while (!_stop && _generation == seen) _start.wait(lock);
+         if (_stop) return;
+         seen = _generation;
+      }
+      
+      runTasks(thread);
+      
+      {
+         std::lock_guard<std::mutex> lock(_mutex);
+         if (--_busy == 0) _done.notify_one();
+      }
+   }
+}
+
+// take indices until there are none left
+void ThreadPool::runTasks(unsigned int thread) {
+   try {
+      for (unsigned int i = _next++; i < _n; i = _next++) (*_task)(i, thread);
+   } catch (...) {
+      std::lock_guard<std::mutex> lock(_mutex);
+      if (!_error) _error = std::current_exception();
+      _next = _n;  // hand out no more work
+   }
+}
+
+} // namespace contrib
+
+FASTJET_END_NAMESPACE
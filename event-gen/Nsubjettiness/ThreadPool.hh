@@ -0,0 +1,92 @@
+//  Nsubjettiness Package
+//  Questions/Comments?  jthaler@jthaler.net
+//
+//  Copyright (c) 2011-14
+//  Jesse Thaler, Ken Van Tilburg, Christopher K. Vermilion, and TJ Wilkason
+//
+//----------------------------------------------------------------------
+// This file is part of FastJet contrib.
+//
+// It is free software; you can redistribute it and/or modify it under
+// the terms of the GNU General Public License as published by the
+// Free Software Foundation; either version 2 of the License, or (at
+// your option) any later version.
+//
+// It is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+// License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this code. If not, see <http://www.gnu.org/licenses/>.
+//----------------------------------------------------------------------
+
+#ifndef __FASTJET_CONTRIB_THREADPOOL_HH__
+#define __FASTJET_CONTRIB_THREADPOOL_HH__
+
+#include "fastjet/internal/base.hh"
+
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <atomic>
+
+FASTJET_BEGIN_NAMESPACE      // defined in fastjet/internal/base.hh
+
+namespace contrib {
+
+//------------------------------------------------------------------------
+/// \class ThreadPool
+// A fixed set of worker threads for running the iterations of a loop in parallel.
+// parallel_for(n, task) calls task(i, thread) once for each i in [0,n) and returns when
+// all calls have finished.  The calling thread takes part as thread 0, and thread is always
+// smaller than n_threads(), so it can be used to pick per-thread scratch space.  Which thread
+// runs which i is not fixed: for results that do not depend on the number of threads, each
+// call should only write to storage belonging to its i.
+// Only one loop runs at a time; a second caller waits for the first loop to finish, so a task
+// must not call parallel_for on the pool it is running in.
+class ThreadPool {
+
+public:
+   typedef std::function<void(unsigned int, unsigned int)> Task;
+
+   // n_threads counts the calling thread, so ThreadPool(1) starts no workers
+   explicit ThreadPool(unsigned int n_threads = 1);
+   ~ThreadPool();
+
+   unsigned int n_threads() const {return _workers.size() + 1;}
+
+   // runs task(i, thread) for i = 0 ... n-1; an exception thrown by a task is rethrown here
+   void parallel_for(unsigned int n, const Task & task);
+
+private:
+   // not copyable
+   ThreadPool(const ThreadPool&);
+   ThreadPool& operator=(const ThreadPool&);
+
+   void work(unsigned int thread);
+   void runTasks(unsigned int thread);
+
+   std::vector<std::thread> _workers;
+
+   std::mutex _loopMutex;             // held by the caller for the whole loop
+   std::mutex _mutex;                 // protects the loop state below
+   std::condition_variable _start;    // a new loop (or _stop) for the workers
+   std::condition_variable _done;     // all workers have left the loop
+   const Task * _task;
+   unsigned int _n;
+   std::atomic<unsigned int> _next;   // next index to hand out
+   unsigned int _generation;          // counts the loops, so workers see each one once
+   unsigned int _busy;                // workers still in the current loop
+   std::exception_ptr _error;         // first exception thrown by a task
+   bool _stop;
+};
+
+} // namespace contrib
+
+FASTJET_END_NAMESPACE
+
+#endif  // __FASTJET_CONTRIB_THREADPOOL_HH__
@@ -0,0 +1,233 @@
+//  Nsubjettiness Package
+//  Questions/Comments?  jthaler@jthaler.net
+//
+//  Copyright (c) 2011-14
+//  Jesse Thaler, Ken Van Tilburg, Christopher K. Vermilion, and TJ Wilkason
+//
+// Run this example with
+//     ./example_simd_check
+//
+// It checks the vectorized kernels of MinimizationKernels.hh against a plain
+// loop, on a fixed sample of jets made here (so it needs no input; the event
+// given by "make check" is ignored).  For each jet and N = 1..5 the particles
+// are assigned to the WTA kT axes with the double and single precision
+// kernels, and compared to the plain double precision loop:
+//
+//   double:  the distance of each particle to its axis within 1e-12, the
+//            same axis unless another one is as close within 1e-12, and
+//            tau_N (beta = 1) within a relative 1e-12
+//   float:   the same with 1e-5 (so particles near a boundary may change axis)
+//
+// tau_N of Njettiness with WTA kT axes must match the plain loop to a relative
+// 1e-10.  The one-pass minimized tau_N are printed to 6 digits.
+//
+// The output does not depend on the kernels in use, so the program built with
+// -DNSUBJETTINESS_NO_SIMD ("make check_nosimd") must give the same output
+// (example_simd_check.ref), which compares the minimization of the two builds.
+//----------------------------------------------------------------------
+// This file is part of FastJet contrib.
+//
+// It is free software; you can redistribute it and/or modify it under
+// the terms of the GNU General Public License as published by the
+// Free Software Foundation; either version 2 of the License, or (at
+// your option) any later version.
+//
+// It is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+// License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this code. If not, see <http://www.gnu.org/licenses/>.
+//----------------------------------------------------------------------
+
+
+#include <iomanip>
+#include <iostream>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+#include "fastjet/PseudoJet.hh"
+#include "Njettiness.hh" // In external code, this should be fastjet/contrib/Njettiness.hh
+#include "MinimizationKernels.hh"
+
+using namespace std;
+using namespace fastjet;
+using namespace fastjet::contrib;
+
+// forward declaration to make things clearer
+void make_jets(vector<vector<PseudoJet> > &jets);
+bool check_kernels(const vector<PseudoJet> &particles, const vector<PseudoJet> &axes);
+
+const double double_tolerance = 1e-12;
+const double float_tolerance = 1e-5;
+const double njettiness_tolerance = 1e-10;
+const int max_N = 5;
+
+//----------------------------------------------------------------------
+int main(){
+
+   //----------------------------------------------------------
+   // the fixed sample of jets
+   vector<vector<PseudoJet> > jets;
+   make_jets(jets);
+   cout << "# made " << jets.size() << " jets" << endl;
+
+   // which kernels are in use goes to cerr, the rest must not depend on it
+#if defined(NSUBJETTINESS_SIMD_AVX)
+   cerr << "# AVX kernels" << endl;
+#elif defined(NSUBJETTINESS_SIMD_SSE2)
+   cerr << "# SSE2 kernels" << endl;
+#else
+   cerr << "# scalar kernels" << endl;
+#endif
+
+   UnnormalizedMeasure measure(1.0);
+   Njettiness wta(WTA_KT_Axes(), measure);
+   Njettiness onepass(OnePass_WTA_KT_Axes(), measure);
+
+   bool kernels_ok = true;
+   bool njettiness_ok = true;
+
+   cout << "-------------------------------------------------------------------------------------" << endl;
+   cout << "One-pass WTA KT axes, Unnormalized Measure (beta = 1.00):" << endl;
+   cout << setw(6) << "jet" << setw(6) << "n";
+   for (int N = 1; N <= max_N; N++) cout << setw(11) << "tau" << N;
+   cout << endl;
+
+   for (unsigned i = 0; i < jets.size(); i++) {
+      const vector<PseudoJet> & particles = jets[i];
+      cout << setw(6) << i << setw(6) << particles.size();
+      for (int N = 1; N <= max_N; N++) {
+
+         // kernels on the WTA kT axes
+         double tau_wta = wta.getTau(N, particles);
+         vector<PseudoJet> axes = wta.currentAxes();
+         kernels_ok = check_kernels(particles, axes) && kernels_ok;
+
+         // Njettiness on the same axes
+         double tau_ref = 0.0;
+         for (unsigned j = 0; j < particles.size(); j++) {
+            double best = numeric_limits<double>::max();
+            for (int k = 0; k < N; k++) best = min(best, particles[j].squared_distance(axes[k]));
+            tau_ref += particles[j].perp() * sqrt(best);
+         }
+         if (fabs(tau_wta - tau_ref) > njettiness_tolerance * tau_ref) njettiness_ok = false;
+
+         cout << setw(12) << fixed << setprecision(6) << onepass.getTau(N, particles);
+      }
+      cout << endl;
+   }
+   cout << "-------------------------------------------------------------------------------------" << endl;
+
+   cout << "kernels within tolerance: " << (kernels_ok ? "yes" : "NO") << endl;
+   cout << "Njettiness within tolerance: " << (njettiness_ok ? "yes" : "NO") << endl;
+
+   return (kernels_ok && njettiness_ok) ? 0 : 1;
+}
+
+// A small linear congruential generator, so that the sample is the same everywhere
+class FixedRandom {
+public:
+   FixedRandom(unsigned long seed) : _state(seed) {}
+   double uniform() {
+      _state = (_state * 6364136223846793005ULL + 1442695040888963407ULL);
+      return (_state >> 11) * (1.0 / 9007199254740992.0);
+   }
+   // roughly gaussian, with unit width
+   double gaussian() {
+      double sum = 0.0;
+      for (int i = 0; i < 12; i++) sum += uniform();
+      return sum - 6.0;
+   }
+private:
+   unsigned long long _state;
+};
+
+// Jets of 1 to 4 prongs with 7 to 200 particles (odd numbers too, so the
+// scalar remainder of the vector loops is used), some of them across phi = 0.
+void make_jets(vector<vector<PseudoJet> > &jets) {
+   FixedRandom random(12345);
+   const int sizes[] = {7, 13, 24, 31, 50, 63, 77, 100, 129, 150, 181, 200};
+   const int n_sizes = sizeof(sizes) / sizeof(sizes[0]);
+   for (int i = 0; i < 2 * n_sizes; i++) {
+      int n_prongs = 1 + i % 4;
+      double jet_rap = 2.0 * random.uniform() - 1.0;
+      double jet_phi = (i % 3 == 0) ? 0.05 : 2.0 * M_PI * random.uniform();
+      double prong_rap[4], prong_phi[4], prong_pt[4];
+      for (int k = 0; k < n_prongs; k++) {
+         prong_rap[k] = jet_rap + 0.3 * random.gaussian();
+         prong_phi[k] = jet_phi + 0.3 * random.gaussian();
+         prong_pt[k] = 5.0 + 50.0 * random.uniform();
+      }
+      vector<PseudoJet> jet;
+      for (int j = 0; j < sizes[i % n_sizes]; j++) {
+         int k = j % n_prongs;
+         PseudoJet particle;
+         particle.reset_PtYPhiM(prong_pt[k] * random.uniform() * random.uniform() + 0.1,
+                                prong_rap[k] + 0.08 * random.gaussian(),
+                                prong_phi[k] + 0.08 * random.gaussian());
+         jet.push_back(particle);
+      }
+      jets.push_back(jet);
+   }
+}
+
+// The assignment by the kernels (native width, with the scalar remainder) in
+// precision T, against the plain double precision loop
+template <int N, class T>
+bool check_assignment(const vector<PseudoJet> &particles, const vector<PseudoJet> &axes, double tolerance) {
+   kernels::BasicParticleArrays<T> arrays;
+   arrays.reset(particles);
+   T axis_rap[N], axis_phi[N];
+   for (int k = 0; k < N; k++) {
+      axis_rap[k] = axes[k].rap();
+      axis_phi[k] = axes[k].phi();
+   }
+   vector<int> assignment(particles.size());
+   vector<T> distSq(particles.size());
+   kernels::assign_to_axes<N>(arrays, axis_rap, axis_phi, numeric_limits<T>::max(), &assignment[0], &distSq[0]);
+
+   bool ok = true;
+   double tau = 0.0, tau_ref = 0.0;
+   for (unsigned j = 0; j < particles.size(); j++) {
+      double rap = particles[j].rap(), phi = particles[j].phi();
+      double dist[N];
+      int best = 0;
+      for (int k = 0; k < N; k++) {
+         double dRap = axes[k].rap() - rap;
+         double dPhi = fabs(axes[k].phi() - phi);
+         if (dPhi > M_PI) dPhi = 2.0 * M_PI - dPhi;
+         dist[k] = dRap * dRap + dPhi * dPhi;
+         if (dist[k] < dist[best]) best = k;
+      }
+      int k = assignment[j];
+      if (k < 0 || k >= N) return false;
+      // a different axis is only allowed if it is as close within the tolerance
+      if (fabs(sqrt(dist[k]) - sqrt(dist[best])) > tolerance) ok = false;
+      if (fabs(sqrt((double) distSq[j]) - sqrt(dist[k])) > tolerance) ok = false;
+      tau += particles[j].perp() * sqrt((double) distSq[j]);
+      tau_ref += particles[j].perp() * sqrt(dist[best]);
+   }
+   if (fabs(tau - tau_ref) > tolerance * tau_ref) ok = false;
+   return ok;
+}
+
+template <int N>
+bool check_both(const vector<PseudoJet> &particles, const vector<PseudoJet> &axes) {
+   bool double_ok = check_assignment<N, double>(particles, axes, double_tolerance);
+   bool float_ok = check_assignment<N, float>(particles, axes, float_tolerance);
+   return double_ok && float_ok;
+}
+
+bool check_kernels(const vector<PseudoJet> &particles, const vector<PseudoJet> &axes) {
+   switch (axes.size()) {
+      case 1: return check_both<1>(particles, axes);
+      case 2: return check_both<2>(particles, axes);
+      case 3: return check_both<3>(particles, axes);
+      case 4: return check_both<4>(particles, axes);
+      case 5: return check_both<5>(particles, axes);
+      default: return false;
+   }
+}
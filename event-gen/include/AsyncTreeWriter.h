@@ -0,0 +1,93 @@
+#ifndef ASYNCTREEWRITER_H
+#define ASYNCTREEWRITER_H
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+class TTree;
+class TBranch;
+class TLeaf;
+
+using namespace std;
+
+// Fills a TTree from a writer thread, so that the compression and the disk
+// writes of full baskets overlap with the generation of the next events.
+//
+// Start() takes over the branches of the tree: the values the branches
+// point to are copied into a ring of record buffers at each Fill(), and the
+// writer thread copies each record into buffers of its own that the
+// branches now point to and fills the tree from there.  Fill() only blocks
+// when the writer is a whole ring behind.  Stop() writes out what is left
+// in the ring, joins the thread and points the branches back to the
+// original variables; the tree and its file may then be written and closed
+// as usual.  Between Start() and Stop() nothing else may touch the tree or
+// its file.
+//
+// Only leaf-list branches (Branch(name, address, leaflist)) can be taken
+// over, with variable-length arrays (x[n]/F) only as the single leaf of
+// their branch.  Start() returns false and leaves the tree alone otherwise.
+class AsyncTreeWriter
+{
+    public:
+        AsyncTreeWriter(TTree *tree, int nbuffers = 16);
+        ~AsyncTreeWriter();
+
+        bool Start();
+        void Fill();
+        void Stop();
+
+        bool Running() const
+        {
+            return fRunning;
+        }
+
+        // how often and for how long Fill() waited for a free record
+        long long NStalls() const
+        {
+            return fNStalls;
+        }
+        double StallSeconds() const
+        {
+            return fStallSeconds;
+        }
+
+    private:
+        struct Slot
+        {
+            TBranch *branch;
+            char *source;       // the variables the branch pointed to
+            int fixed_bytes;    // bytes of the branch without a leaf count
+            int element_bytes;  // bytes per count of a variable-length leaf
+            int count_slot;     // slot holding the leaf count, -1 if none
+            int count_offset;   // offset of the leaf count in its slot
+            int count_type;     // size in bytes of the leaf count
+            vector<char> shadow;
+        };
+
+        long long CountValue(const char *address, int type) const;
+        void Capture(vector<char> &record) const;
+        void Release(const vector<char> &record);
+        void Run();
+
+        TTree *fTree;
+        vector<Slot> fSlots;
+
+        vector< vector<char> > fRecords;
+        int fHead;      // next record to fill
+        int fTail;      // next record to write
+        int fQueued;
+        bool fStopping;
+        bool fRunning;
+
+        mutex fMutex;
+        condition_variable fNotFull;
+        condition_variable fNotEmpty;
+        thread fThread;
+
+        long long fNStalls;
+        double fStallSeconds;
+};
+
+#endif
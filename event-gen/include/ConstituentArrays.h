@@ -0,0 +1,96 @@
+#ifndef CONSTITUENTARRAYS_H
+#define CONSTITUENTARRAYS_H
+
+#include <string>
+#include <vector>
+
+class TTree;
+
+using namespace std;
+
+// The constituents of one jet as jagged arrays of the EventTree, in the
+// order they are added (by decreasing pt in MIAnalysis):
+//
+//   NConst/I                       number of constituents
+//   ConstPt, ConstEta, ConstPhi,   pt, pseudorapidity, phi in [0, 2pi) and
+//   ConstE [NConst]/F              energy
+//   ConstPdgId[NConst]/I           with_info only: pdg id
+//   ConstCharge[NConst]/B          with_info only: charge in units of e
+//
+// with a suffix on every name for the other jets (NConst_nopix, ...).  At
+// most capacity constituents are kept, the ones added last are dropped.
+// The same class reads them back (SetAddresses), with no dependence beyond
+// ROOT, for the rerasterize tool.
+class ConstituentArrays
+{
+    public:
+        ConstituentArrays(int capacity = 1000, bool with_info = false);
+
+        void DeclareBranches(TTree *tree, const string &suffix = "");
+        // points the branches of tree to the arrays; false if the tree has
+        // no such constituents (or without pdg id and charge when with_info)
+        bool SetAddresses(TTree *tree, const string &suffix = "");
+
+        // -999 everywhere and the full capacity, as Intensity and NFilled,
+        // so that a RecordStream opened after it makes room for the longest
+        // lists
+        void Reset();
+        void Clear()
+        {
+            fN = 0;
+        }
+        // false when the arrays are full
+        bool Add(double pt, double eta, double phi, double E,
+            int pdg_id = 0, double charge = 0);
+
+        int N() const
+        {
+            return fN;
+        }
+        int Capacity() const
+        {
+            return fCapacity;
+        }
+        bool WithInfo() const
+        {
+            return fWithInfo;
+        }
+        const float* Pt() const
+        {
+            return &fPt[0];
+        }
+        const float* Eta() const
+        {
+            return &fEta[0];
+        }
+        const float* Phi() const
+        {
+            return &fPhi[0];
+        }
+        const float* E() const
+        {
+            return &fE[0];
+        }
+        const int* PdgId() const
+        {
+            return &fPdgId[0];
+        }
+        const signed char* Charge() const
+        {
+            return &fCharge[0];
+        }
+
+    private:
+        int fCapacity;
+        bool fWithInfo;
+
+        int fN;
+        vector<float> fPt;
+        vector<float> fEta;
+        vector<float> fPhi;
+        vector<float> fE;
+        vector<int> fPdgId;
+        vector<signed char> fCharge;
+};
+
+#endif
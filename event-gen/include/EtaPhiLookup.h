@@ -0,0 +1,60 @@
+#ifndef ETAPHILOOKUP_H
+#define ETAPHILOOKUP_H
+
+#include <vector>
+
+#include "fastjet/PseudoJet.hh"
+
+using namespace std;
+using fastjet::PseudoJet;
+
+// Bins a list of particles in (rapidity, phi) once, so that all the
+// particles within some distance of a direction can be found by looking at
+// the few cells around it instead of scanning the whole list.  Distances are
+// the PseudoJet::delta_R ones (rapidity and phi, with the phi wrap-around),
+// and the results are the same as a linear scan with delta_R, in the order
+// of the input list within each cell.
+class EtaPhiLookup
+{
+    public:
+        // cellsize is best of the order of the radii that will be queried;
+        // it is raised to 0.05 if smaller (or not positive)
+        EtaPhiLookup(double cellsize = 0.4);
+
+        void Fill(const vector<PseudoJet> &particles);
+
+        unsigned int Size() const
+        {
+            return fRap.size();
+        }
+
+        // appends to found the indices (in the list given to Fill) of the
+        // particles with delta_R to centre below radius
+        void Within(const PseudoJet &centre, double radius, vector<int> &found) const;
+
+        // whether any particle has delta_R to centre below radius
+        bool AnyWithin(const PseudoJet &centre, double radius) const;
+
+    private:
+        int RapBin(double rap) const;
+        int PhiBin(double phi) const;
+
+        // ranges of cells to visit for a query; false if none
+        bool Range(const PseudoJet &centre, double radius,
+            int &rap_lo, int &rap_hi, int &phi_lo, int &phi_hi) const;
+
+        double fCellSize;
+        double fRapMin;
+        double fPhiWidth;
+        int fNRap;
+        int fNPhi;
+
+        // the particles of cell c are fIndex[fStart[c] .. fStart[c+1]-1]
+        vector<int> fStart;
+        vector<int> fIndex;
+
+        vector<double> fRap;
+        vector<double> fPhi;
+};
+
+#endif
@@ -0,0 +1,105 @@
+#ifndef IMAGECODEC_H
+#define IMAGECODEC_H
+
+#include <string>
+#include <vector>
+
+class TTree;
+
+using namespace std;
+
+// Storage encodings of the jet image.  The image is always computed as
+// floats (fTIntensity); the encoding only decides what goes to the tree,
+// and the branch name tells the reader which one was used:
+//
+//   float32     Intensity[NFilled]/F, as before
+//   float16     Intensity_f16[NFilled]/s, IEEE half precision (round to
+//               nearest even, larger than 65504 stored as 65504)
+//   log-uint16  Intensity_log16[NFilled]/s, 0 for E <= 0, else
+//               k = 1 + round(ln(E / log_min) / log_step) in [1, 65535],
+//               decoded as log_min * exp((k - 1) * log_step); the relative
+//               error is below 1.6e-4 between log_min and log_max
+//   uint8       Intensity_u8[NFilled]/b with IntensityScale/F per image,
+//               k = round(E / scale) with scale = max(E) / 255, decoded as
+//               k * scale; the error is below scale / 2 per pixel
+//
+// Other images (ImageSet) get the same suffixes on their own names.
+// The decoding is exact arithmetic that jettools.decode_intensity repeats
+// in numpy.  Encode() keeps the relative L2 error of each image,
+// |decoded - image| / |image|, which is what survives the unit-norm
+// normalization of the images downstream.
+class ImageCodec
+{
+    public:
+        enum Encoding
+        {
+            Float32,
+            Float16,
+            LogUInt16,
+            ScaledUInt8
+        };
+
+        ImageCodec(Encoding encoding = Float32, int size = 625);
+
+        static bool FromName(const string &name, Encoding &encoding);
+        static string Name(Encoding encoding);
+
+        Encoding GetEncoding() const
+        {
+            return fEncoding;
+        }
+        int Size() const
+        {
+            return fSize;
+        }
+
+        // declares the branches of the encoded image called name, of length
+        // given by a leaf count or a number (name_f16[length]/s, ...);
+        // nothing for float32, whose branch points to the image
+        void DeclareBranches(TTree *tree, const string &name = "Intensity",
+            const string &length = "NFilled");
+
+        // encodes size floats of image into the branch buffers
+        void Encode(const float *image);
+        // decodes the branch buffers into size floats
+        void Decode(float *image) const;
+
+        // over all the images encoded so far
+        long long NImages() const
+        {
+            return fNImages;
+        }
+        double MeanError() const
+        {
+            return fNImages ? fSumError / fNImages : 0.;
+        }
+        double MaxError() const
+        {
+            return fMaxError;
+        }
+
+        // the conversions themselves
+        static unsigned short HalfFromFloat(float value);
+        static float FloatFromHalf(unsigned short half);
+        static unsigned short LogCode(float value);
+        static float LogValue(unsigned short code);
+
+        static const double log_min;
+        static const double log_max;
+        static const double log_step;
+
+    private:
+        Encoding fEncoding;
+        int fSize;
+
+        vector<unsigned short> fCodes16;
+        vector<unsigned char> fCodes8;
+        float fScale;
+
+        vector<float> fDecoded;
+        long long fNImages;
+        double fSumError;
+        double fMaxError;
+};
+
+#endif
@@ -0,0 +1,114 @@
+#ifndef IMAGENSUBJETTINESS_H
+#define IMAGENSUBJETTINESS_H
+
+#include <vector>
+
+using namespace std;
+
+// N-subjettiness evaluated on a jet image instead of the jet constituents.
+//
+// The image is the pixels x pixels grid over [-range, range]^2 that
+// MIAnalysis::AnalyzeEvent writes to the Intensity branch (the first index
+// runs over the x = eta bins, the second over the y = phi bins), and each
+// cell counts as one particle at its centre with the cell content as its
+// weight.  The cell centres are computed once in the constructor, so the
+// cost of an evaluation only depends on the number of filled cells (at most
+// pixels^2), not on the multiplicity of the jet.  Nothing beyond the standard
+// library is needed, so taus can be recomputed from stored images, e.g. in a
+// ROOT macro reading the EventTree.
+//
+// tau_N = sum_i w_i min_k dR_ik^beta / sum_i w_i R0^beta, with dR the
+// euclidean distance in the image plane.  As for the OnePass_WTA_KT_Axes of
+// the constituent taus, the axes start from an exclusive kT clustering of
+// the cells with winner-take-all recombination, and are then refined by
+// alternating assignment to the nearest axis and the weighted update of each
+// axis (the weighted mean for beta = 2, the Weiszfeld step for beta = 1) for
+// as long as tau decreases.
+class ImageNsubjettiness
+{
+    public:
+        ImageNsubjettiness(int pixels = 25, double range = 1.0,
+            double beta = 1.0, double R0 = 1.0);
+
+        // tau_N of image, which holds pixels * pixels values in the order
+        // of the Intensity branch.  Returns 0 for an empty image.
+        double Tau(int N, const float *image);
+
+        // tau_N for each N of Ns in one go, with one clustering for all N
+        void Taus(const vector<int> &Ns, const float *image, vector<double> &taus);
+
+        // axes of the last evaluated N, in image coordinates
+        const vector<double>& AxesX() const
+        {
+            return fAxisX;
+        }
+        const vector<double>& AxesY() const
+        {
+            return fAxisY;
+        }
+
+        int Pixels() const
+        {
+            return fPixels;
+        }
+        double Range() const
+        {
+            return fRange;
+        }
+        double Beta() const
+        {
+            return fBeta;
+        }
+        double R0() const
+        {
+            return fR0;
+        }
+
+        // centre of cell (i, j), 0 <= i, j < pixels
+        double CellX(int i) const
+        {
+            return fCellX[i];
+        }
+        double CellY(int j) const
+        {
+            return fCellY[j];
+        }
+
+    private:
+        void LoadImage(const float *image);
+        void Cluster(int maxN);
+        double Evaluate(int N);
+        double Assign();
+        double Refine();
+
+        int fPixels;
+        double fRange;
+        double fBeta;
+        double fR0;
+        double fMinDist;  // distance floor of the axis update, well below a cell
+
+        // cell centres along each axis of the image
+        vector<double> fCellX;
+        vector<double> fCellY;
+
+        // filled cells of the current image
+        vector<double> fX;
+        vector<double> fY;
+        vector<double> fW;
+        double fSumW;
+
+        // distance^2 and distance^beta to, and index of, the nearest axis,
+        // per filled cell
+        vector<double> fD2;
+        vector<double> fDist;
+        vector<int> fLabel;
+
+        // seed axes for each N up to the largest one asked for
+        vector<vector<double> > fSeedX;
+        vector<vector<double> > fSeedY;
+
+        vector<double> fAxisX;
+        vector<double> fAxisY;
+};
+
+#endif
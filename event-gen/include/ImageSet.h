@@ -0,0 +1,101 @@
+#ifndef IMAGESET_H
+#define IMAGESET_H
+
+#include <string>
+#include <vector>
+
+#include "ImageCodec.h"
+
+class TTree;
+
+using namespace std;
+
+// One image definition: a grid of pixels x pixels cells over
+// [-range, range] in (eta, phi) around the leading subjet, and the
+// preprocessing applied to the constituents and the image:
+//
+//   rotate     turn the first principal axis (PCEta, PCPhi) to -phi
+//   flip       after rotate: mirror in eta so the +eta half has the most
+//              energy
+//   normalize  scale the image to unit L2 norm
+//
+// Written as "[name=]pixels:range[:step+step...]", e.g. "40:1.2" or
+// "wide=40:1.2:rotate+flip".  Without a name the branch is called after
+// the definition, Image_40x40_R1p2 or Image_40x40_R1p2_rotate_flip.
+struct ImageConfig
+{
+    ImageConfig();
+
+    string name;
+    int pixels;
+    double range;
+    bool rotate;
+    bool flip;
+    bool normalize;
+
+    // parses a comma separated list of definitions; false if one is wrong
+    static bool Parse(const string &spec, vector<ImageConfig> &configs);
+};
+
+// The extra images of an event: all the ImageConfigs are filled from the
+// same constituents in one pass, each into its own branch, next to the
+// Intensity image of the run.  The cells are summed in float and binned
+// as TH2F does, so a configuration equal to --Pixels/--Range without
+// preprocessing gives back Intensity exactly.
+class ImageSet
+{
+    public:
+        ImageSet(const vector<ImageConfig> &configs);
+        ~ImageSet();
+
+        // one fixed-length array branch per image, name[pixels*pixels]/F or
+        // the encoded forms of ImageCodec
+        void DeclareBranches(TTree *tree, ImageCodec::Encoding encoding);
+        void Reset();
+
+        // x, y: eta and phi of the constituents relative to the leading
+        // subjet; pc_x, pc_y: the first principal axis of the jet
+        void Fill(const vector<double> &x, const vector<double> &y,
+            const vector<double> &energy, double pc_x, double pc_y);
+
+        // copies image i computed elsewhere (by an ImageSet of the same
+        // configurations) into the branch buffers
+        void SetImage(int i, const float *image);
+
+        // encodes the images for the tree (when an encoding is set)
+        void Encode();
+
+        // the first principal axis of the energy distribution, PCEta and
+        // PCPhi of the EventTree; of the two signs, the one pointing to the
+        // side with less energy (the subleading prong)
+        static void PrincipalAxis(const vector<double> &x, const vector<double> &y,
+            const vector<double> &energy, double &pc_x, double &pc_y);
+
+        int Size() const
+        {
+            return fConfigs.size();
+        }
+        const ImageConfig& Config(int i) const
+        {
+            return fConfigs[i];
+        }
+        const float* Image(int i) const
+        {
+            return &fImages[i][0];
+        }
+        // 0 for float32
+        const ImageCodec* Codec(int i) const
+        {
+            return fCodecs[i];
+        }
+
+    private:
+        vector<ImageConfig> fConfigs;
+        vector< vector<float> > fImages;
+        vector<ImageCodec *> fCodecs;
+
+        vector<double> fRotX;
+        vector<double> fRotY;
+};
+
+#endif
@@ -0,0 +1,74 @@
+#ifndef ISOLATIONENGINE_H
+#define ISOLATIONENGINE_H
+
+#include <vector>
+
+#include "Pythia8/Pythia.h"
+
+using namespace std;
+
+// Isolation of any number of candidates of one event from a single pass over
+// the event record.
+//
+// Fill() keeps the particles MITools::IsIsolated sums over (final state, no
+// neutrinos, pT >= 0.5), binned in (rapidity, phi) and sorted by cell, with
+// prefix sums of their pT along phi in each rapidity row.  A query first
+// bounds the cone sum from those prefix sums, using the cells that overlap
+// the cone (upper bound) and the cells that lie entirely inside it (lower
+// bound), at a cost per rapidity row.  It walks the particles of the
+// overlapping cells only when the bounds cannot decide the answer.  That
+// walk adds them up in event order and in the same precision as
+// IsIsolated, so answers and cone sums are identical to it.
+class IsolationEngine
+{
+    public:
+        IsolationEngine(double cellsize = 0.1);
+
+        void Fill(const Pythia8::Event &event);
+
+        // sum of the pT of the particles within conesize of particle, other
+        // than itself (particle does not have to be in the event)
+        float ConeSum(const Pythia8::Particle *particle, float conesize) const;
+
+        // same as MITools::IsIsolated(particle, pythia8, rel_iso, conesize)
+        bool IsIsolated(const Pythia8::Particle *particle, float rel_iso, float conesize) const;
+
+    private:
+        struct Query
+        {
+            double rap;
+            double phi;
+            double pt;
+            int self;      // slot of the particle itself, -1 if not indexed
+            double cone;
+        };
+
+        Query MakeQuery(const Pythia8::Particle *particle, float conesize) const;
+        void Bounds(const Query &q, double &lower, double &upper) const;
+        float ExactSum(const Query &q) const;
+
+        int RapBin(double rap) const;
+        int PhiBin(double phi) const;
+        double RowSum(int row, int lo, int hi) const;
+
+        double fCellSize;
+        double fPhiWidth;
+        double fRapMin;
+        int fNRap;
+        int fNPhi;
+
+        const Pythia8::Event *fEvent;
+
+        // indexed particles, sorted by cell; within a cell in event order
+        vector<double> fRap;
+        vector<double> fPhi;
+        vector<double> fPt;
+        vector<int> fEntry;   // index in the event record
+        vector<int> fStart;   // particles of cell c: slots fStart[c] .. fStart[c+1]-1
+        vector<int> fSlot;    // slot of each event record entry, -1 if not indexed
+
+        // fRowPrefix[r * (fNPhi + 1) + k]: pT sum of phi cells 0..k-1 of row r
+        vector<double> fRowPrefix;
+};
+
+#endif
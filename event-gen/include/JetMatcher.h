@@ -0,0 +1,97 @@
+#ifndef JETMATCHER_H
+#define JETMATCHER_H
+
+#include <vector>
+
+#include "fastjet/PseudoJet.hh"
+
+#include "EtaPhiLookup.h"
+
+using namespace std;
+using fastjet::PseudoJet;
+
+// Matches all the jets of an event to truth objects (partons, bosons,
+// truth jets) in one call, by delta_R in (rapidity, phi) below maxR.
+//
+// The truth objects are binned once in an EtaPhiLookup with cells of size
+// maxR, so each jet only looks at the truth objects in the cells around it,
+// and the candidate pairs are listed once with their delta_R.  The pairs
+// are then resolved according to the mode:
+//
+//   ClosestTruth  each jet gets its closest truth object (many-to-one, as
+//                 MITools::Match does for a single jet)
+//   Greedy        one-to-one, pairs taken in order of increasing delta_R
+//   Optimal       one-to-one with the largest number of matches and, among
+//                 those, the smallest sum of delta_R (Hungarian algorithm)
+//
+// Ties in delta_R go to the lower jet, then the lower truth index.
+class JetMatcher
+{
+    public:
+        enum Mode
+        {
+            ClosestTruth,
+            Greedy,
+            Optimal
+        };
+
+        JetMatcher(double maxR = 0.7, Mode mode = ClosestTruth);
+
+        // jet_match[i]: index in truths of the match of jets[i], -1 if none
+        void Match(const vector<PseudoJet> &jets, const vector<PseudoJet> &truths,
+            vector<int> &jet_match);
+
+        // for the last Match: delta_R of each jet to its match (-1 if none),
+        // and for each truth object the matched jet (the closest one in the
+        // ClosestTruth mode; -1 if none)
+        const vector<double>& MatchDeltaR() const
+        {
+            return fMatchDeltaR;
+        }
+        const vector<int>& TruthMatch() const
+        {
+            return fTruthMatch;
+        }
+
+        double MaxR() const
+        {
+            return fMaxR;
+        }
+        Mode GetMode() const
+        {
+            return fMode;
+        }
+
+    private:
+        struct Pair
+        {
+            double dR;
+            int jet;
+            int truth;
+
+            bool operator<(const Pair &other) const
+            {
+                if (dR != other.dR) return dR < other.dR;
+                if (jet != other.jet) return jet < other.jet;
+                return truth < other.truth;
+            }
+        };
+
+        void FindPairs(const vector<PseudoJet> &jets, const vector<PseudoJet> &truths);
+        void MatchClosest(vector<int> &jet_match);
+        void MatchGreedy(vector<int> &jet_match);
+        void MatchOptimal(vector<int> &jet_match);
+
+        double fMaxR;
+        Mode fMode;
+
+        EtaPhiLookup fLookup;
+        vector<Pair> fPairs;   // all (jet, truth) with delta_R < maxR
+        int fNJets;
+        int fNTruths;
+
+        vector<double> fMatchDeltaR;
+        vector<int> fTruthMatch;
+};
+
+#endif
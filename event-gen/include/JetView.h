@@ -0,0 +1,97 @@
+#ifndef JETVIEW_H
+#define JETVIEW_H
+
+#include <vector>
+
+#include "fastjet/PseudoJet.hh"
+
+#include "myFastJetBase.h"
+
+using namespace std;
+using fastjet::PseudoJet;
+
+// A jet together with its constituents and their kinematics, taken out of
+// the jet once: jet.constituents() builds a new vector on every call, so
+// observables that loop over the constituents should be given a JetView
+// instead of the jet.  The per-constituent values are kept in plain arrays,
+// and a view can be reset to the next jet without freeing them.
+//
+// The constituent charge and pdg id come from the ParticleInfoTable if one
+// is given, else from MyUserInfo; constituents without either (e.g.
+// calorimeter cells) have charge 0 and pdg id 0.
+class JetView
+{
+    public:
+        JetView();
+        JetView(const PseudoJet &jet, const ParticleInfoTable *info = 0);
+
+        void Reset(const PseudoJet &jet, const ParticleInfoTable *info = 0);
+
+        const PseudoJet& Jet() const
+        {
+            return fJet;
+        }
+        double JetPt() const
+        {
+            return fJetPt;
+        }
+        double JetRap() const
+        {
+            return fJetRap;
+        }
+        double JetPhi() const
+        {
+            return fJetPhi;
+        }
+
+        unsigned int Size() const
+        {
+            return fConstituents.size();
+        }
+        const vector<PseudoJet>& Constituents() const
+        {
+            return fConstituents;
+        }
+
+        // per-constituent values, in the order of Constituents()
+        const vector<double>& Pt() const
+        {
+            return fPt;
+        }
+        const vector<double>& Rap() const
+        {
+            return fRap;
+        }
+        const vector<double>& Phi() const
+        {
+            return fPhi;
+        }
+        const vector<double>& E() const
+        {
+            return fE;
+        }
+        const vector<double>& Charge() const
+        {
+            return fCharge;
+        }
+        const vector<int>& PdgId() const
+        {
+            return fPdgId;
+        }
+
+    private:
+        PseudoJet fJet;
+        double fJetPt;
+        double fJetRap;
+        double fJetPhi;
+
+        vector<PseudoJet> fConstituents;
+        vector<double> fPt;
+        vector<double> fRap;
+        vector<double> fPhi;
+        vector<double> fE;
+        vector<double> fCharge;
+        vector<int> fPdgId;
+};
+
+#endif
@@ -16,6 +16,14 @@
 #include "TParticle.h"
 
 #include "MITools.h"
+#include "SubstructureEngine.h"
+#include "ImageNsubjettiness.h"
+#include "OutputProfile.h"
+#include "AsyncTreeWriter.h"
+#include "RecordStream.h"
+#include "ImageCodec.h"
+#include "ImageSet.h"
+#include "ConstituentArrays.h"
 #include "myFastJetBase.h"
 #include "Pythia8/Pythia.h"
 
@@ -30,7 +38,7 @@ class MIAnalysis
         MIAnalysis(int imagesize = 25);
         ~MIAnalysis();
         
-        void Begin();
+        bool Begin();
         void AnalyzeEvent(int iEvt, Pythia8::Pythia *pythia8,  
             Pythia8::Pythia *pythia_MB, int NPV, int pixels, float range);
 
@@ -47,14 +55,96 @@ class MIAnalysis
         {
             fOutName = outname;
         }
+
+        // how the EventTree is written, see OutputProfile; set before Begin
+        void SetOutputProfile(const OutputProfile &profile)
+        {
+            fProfile = profile;
+        }
+
+        // number of events buffered for the writer thread, which fills and
+        // writes the EventTree while the next events are generated; 0
+        // fills the tree from AnalyzeEvent.  Set before Begin
+        void SetWriterBuffers(int nbuffers)
+        {
+            fWriterBuffers = nbuffers;
+        }
+
+        // streams the records to the shared ring at path (see RecordStream)
+        // instead of writing the EventTree to the output file, waiting at
+        // most timeout seconds for the consumer.  Set before Begin
+        void SetStream(const string &path, int nslots, double timeout = 300)
+        {
+            fStreamPath = path;
+            fStreamSlots = nslots;
+            fStreamTimeout = timeout;
+        }
+
+        // false once the events can no longer be written (the stream
+        // consumer has gone), the event loop should stop
+        bool Good() const
+        {
+            return !fStream || !fStream->Failed();
+        }
+
+        // how the image is stored, see ImageCodec; set before Begin
+        void SetImageEncoding(ImageCodec::Encoding encoding)
+        {
+            delete imagecodec;
+            imagecodec = new ImageCodec(encoding, MaxN);
+        }
+
+        // more images of the leading jet, each its own branch, filled with
+        // the Intensity image (see ImageSet); set before Begin
+        void SetImages(const vector<ImageConfig> &configs)
+        {
+            delete imageset;
+            imageset = configs.empty() ? 0 : new ImageSet(configs);
+        }
+
+        // constituents of the trimmed leading jet in the EventTree (see
+        // ConstituentArrays): 0 none, 1 the calorimeter cells the images are
+        // made of, 2 also the particles of the _nopix jet with their pdg id
+        // and charge.  Set before Begin
+        void SetConstituents(int level)
+        {
+            delete constituents;
+            delete constituents_nopix;
+            constituents = level >= 1 ? new ConstituentArrays() : 0;
+            constituents_nopix = level >= 2 ? new ConstituentArrays(1000, true) : 0;
+        }
+
+        // seeds the random streams of the tools (b-tagging), so that a run
+        // is reproducible from its --Seed
+        void SetSeed(unsigned int seed)
+        {
+            tool->SetSeed(seed);
+        }
     private:
         int  ftest;
         int  fDebug;
         string fOutName;
+        OutputProfile fProfile;
+        int fWriterBuffers;
+        string fStreamPath;
+        int fStreamSlots;
+        double fStreamTimeout;
 
         TFile *tF;
         TTree *tT;
+        AsyncTreeWriter *fWriter;
+        RecordStream *fStream;
         MITools *tool;
+        SubstructureEngine *substructure;
+        ImageNsubjettiness *imagetaus;
+        ImageCodec *imagecodec;
+        ImageSet *imageset;
+        ConstituentArrays *constituents;
+        ConstituentArrays *constituents_nopix;
+
+        // pdg id, pythia index, charge and pileup flag of the particles of
+        // the current event, indexed by their user_index
+        ParticleInfoTable fParticleInfo;
 
         // Tree Vars ---------------------------------------
         int fTEventNumber;
@@ -72,6 +162,10 @@ class MIAnalysis
         vector<int>   nsubs;
 
         TH2F* detector;
+        // unrotated jet image, kept out of every directory (so the event
+        // thread never touches the output file) and only rebuilt when the
+        // pixels or range change
+        TH2F* image;
 
         int MaxN;
 
@@ -93,6 +187,9 @@ class MIAnalysis
 	float fTPCEta;
 	float fTPCPhi;
 
+        float fTLeadingSubjetEta;
+        float fTLeadingSubjetPhi;
+
         //float fTRotationAngle;
 
         float fTTau1;
@@ -109,8 +206,23 @@ class MIAnalysis
 	float fTTau21_nopix;
 	float fTTau32_nopix;
 
+        float fTTau1_image;
+        float fTTau2_image;
+        float fTTau3_image;
+
+        float fTTau21_image;
+        float fTTau32_image;
+
         float fTdeltaR;
 
+        float fTC2;
+        float fTD2;
+
+        float fTC2_nopix;
+        float fTD2_nopix;
+
+        float fTJetCharge_nopix;
+
         // float fTTau21old;
         // float fTTau32old;
 
@@ -11,6 +11,12 @@
 #include "Pythia8/Pythia.h"
 
 #include "myFastJetBase.h"
+#include "EtaPhiLookup.h"
+#include "IsolationEngine.h"
+#include "JetView.h"
+#include "JetMatcher.h"
+
+class TRandom3;
 
 using namespace std;
 using fastjet::PseudoJet;
@@ -19,19 +25,53 @@ class MITools {
     private:
         int m_test;
 
+        // one random number stream per thread, see Random()
+        unsigned int m_seed;
+        vector<TRandom3*> m_random;
 
+        MITools(const MITools &);
+        MITools& operator=(const MITools &);
 
     public:
-        MITools();
+        MITools(unsigned int seed = 4357, int nstreams = 1);
+        ~MITools();
+
+        // Reseeds with nstreams independent, reproducible streams: stream i
+        // is seeded from (seed, i) only, so the numbers it gives do not
+        // depend on how many other streams there are or who else draws.
+        void SetSeed(unsigned int seed, int nstreams = 1);
+
+        // Stream for thread number `stream`; each stream must only be used
+        // by one thread at a time.
+        TRandom3& Random(int stream = 0);
+        int NStreams() const
+        {
+            return m_random.size();
+        }
         
         // methods
-        double JetCharge(fastjet::PseudoJet jet,double kappa);
+        double JetCharge(const fastjet::PseudoJet &jet, double kappa);
+        double JetCharge(const fastjet::PseudoJet &jet, double kappa, const ParticleInfoTable &info);
+        // From the constituents already taken out of the jet, so that several
+        // observables of the same jet share one constituents() call
+        double JetCharge(const JetView &jet, double kappa);
 	bool IsBHadron(int pdgId);
 	bool IsCHadron(int pdgId);
-	bool Btag(fastjet::PseudoJet jet,vector<fastjet::PseudoJet> bhadrons,vector<fastjet::PseudoJet> chadrons,double jetrad,double b, double c, double uds);
-	bool BosonMatch(fastjet::PseudoJet jet, vector<fastjet::PseudoJet> Bosons, double jetrad, int BosonID);
+	bool Btag(const fastjet::PseudoJet &jet, const vector<fastjet::PseudoJet> &bhadrons, const vector<fastjet::PseudoJet> &chadrons, double jetrad, double b, double c, double uds, int stream = 0);
+	// Tags all jets of an event at once: the hadrons are binned in (rap, phi)
+	// once and each jet only looks at the cells around it.  Same decisions
+	// and random draws, jet by jet, as calling Btag for each jet in turn.
+	void Btag(const vector<fastjet::PseudoJet> &jets, const vector<fastjet::PseudoJet> &bhadrons, const vector<fastjet::PseudoJet> &chadrons, double jetrad, double b, double c, double uds, vector<bool> &tags, int stream = 0);
+	bool BosonMatch(const fastjet::PseudoJet &jet, const vector<fastjet::PseudoJet> &Bosons, double jetrad, int BosonID);
+	bool BosonMatch(const fastjet::PseudoJet &jet, const vector<fastjet::PseudoJet> &Bosons, const ParticleInfoTable &info, double jetrad, int BosonID);
 	bool IsIsolated(Pythia8::Particle* particle, Pythia8::Pythia* pythia8, float rel_iso, float conesize);
-	int Match(fastjet::PseudoJet jet,vector<fastjet::PseudoJet> jets);
+	// Same answer from an IsolationEngine filled with the event once, for
+	// checking many candidates of the same event
+	bool IsIsolated(const Pythia8::Particle* particle, const IsolationEngine &isolation, float rel_iso, float conesize);
+	int Match(const fastjet::PseudoJet &jet, const vector<fastjet::PseudoJet> &jets);
+	// Matches all jets of an event at once, see JetMatcher; with the default
+	// mode matches[i] == Match(jets[i], truths)
+	void Match(const vector<fastjet::PseudoJet> &jets, const vector<fastjet::PseudoJet> &truths, vector<int> &matches, JetMatcher::Mode mode = JetMatcher::ClosestTruth, double maxR = 0.7);
 };
 
 #endif
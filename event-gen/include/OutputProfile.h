@@ -0,0 +1,60 @@
+#ifndef OUTPUTPROFILE_H
+#define OUTPUTPROFILE_H
+
+#include <string>
+#include <vector>
+
+class TTree;
+
+using namespace std;
+
+// How the EventTree is written: compression, basket sizes and cluster size.
+// The image branch holds pixels^2 values per event and dominates the file,
+// so it gets its own basket size (the other arrays, as the constituents,
+// get that of the scalars).
+//
+//   default         what ROOT does by default (the old behaviour)
+//   fast-write      LZ4, large baskets and clusters: least CPU per event
+//   archival        ZSTD level 9 (LZMA before ROOT 6.20): smallest files
+//   archival-lzma   LZMA level 9
+//   read-optimized  ZSTD level 4, clusters of a fixed number of events with
+//                   one basket per branch and cluster, so that a reader
+//                   shuffling clusters decompresses each basket once
+struct OutputProfile
+{
+    OutputProfile();
+
+    string name;
+    string description;
+
+    // ROOT compression algorithm (1 zlib, 2 LZMA, 4 LZ4, 5 ZSTD) and level;
+    // algorithm < 0 keeps the TFile default
+    int algorithm;
+    int level;
+
+    // bytes per basket for the other branches and the image branches
+    // (counted by NFilled, or of fixed length); 0 keeps the ROOT default, and
+    // image_basket_size < 0 makes the image baskets hold exactly one
+    // cluster of auto_flush > 0 events
+    int basket_size;
+    int image_basket_size;
+
+    // TTree::SetAutoFlush: > 0 events per cluster, < 0 bytes per cluster,
+    // 0 keeps the ROOT default
+    long long auto_flush;
+
+    // the TFile compression setting, algorithm * 100 + level
+    int Compression() const;
+
+    // Sets the compression of every branch, the basket sizes and the
+    // cluster size of tree, whose branches must all be declared already;
+    // image_pixels is the number of values per event in the Intensity image
+    // (the fixed-length images carry their own).
+    void ApplyTo(TTree *tree, int image_pixels) const;
+
+    // the profile called name; false if there is none
+    static bool Find(const string &name, OutputProfile &profile);
+    static vector<OutputProfile> All();
+};
+
+#endif
@@ -0,0 +1,110 @@
+#ifndef RECORDSTREAM_H
+#define RECORDSTREAM_H
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+class TTree;
+
+using namespace std;
+
+// Streams the EventTree records to a consumer on the same machine through
+// a ring of fixed-size records in a shared file (normally under /dev/shm),
+// instead of writing them to a ROOT file.  jetstream.py reads the ring as
+// numpy arrays without copying it.
+//
+// The record holds the leaf-list branches of the tree, one field per leaf,
+// in the order of the branches; variable-length arrays get the length they
+// have at Open() (longer ones are cut).  The file is
+//
+//   [0, 4096)        header: RecordStreamHeader, then from byte 256 the
+//                    layout as text, one "name type offset count" line per
+//                    field, type being a numpy type code (f4, i4, ...)
+//   [4096, ...)      nslots records of record_size bytes
+//
+// Record i is in slot i % nslots.  The producer publishes records by
+// raising head, the consumer frees them by raising tail; Write() waits
+// while the ring is full (head - tail == nslots), so a slow consumer slows
+// the generation down rather than losing events.  The consumer writes its
+// pid when it attaches; Write() gives up once that process is gone, or
+// after waiting timeout seconds for a free slot (e.g. no consumer ever
+// attached).  Close() raises done.
+struct RecordStreamHeader
+{
+    char magic[8];          // "JETRING1", written last
+    uint32_t header_size;
+    uint32_t record_size;
+    uint64_t nslots;
+    uint64_t head;          // records written, set by the producer
+    uint64_t tail;          // records consumed, set by the consumer
+    uint64_t done;          // 1 when the producer has finished
+    uint64_t consumer_pid;  // set by the consumer, 0 until it attaches
+};
+
+class RecordStream
+{
+    public:
+        // timeout: longest wait for a free slot in seconds, 0 for no limit
+        RecordStream(const string &path, int nslots = 256, double timeout = 300);
+        ~RecordStream();
+
+        // lays the records out after the branches of tree and creates the
+        // shared file; false (with a message) if that fails
+        bool Open(TTree *tree);
+
+        // appends a record with the current values of the branches; false
+        // (with a message the first time) if the consumer has exited or
+        // has not freed a slot within the timeout, and from then on
+        bool Write();
+
+        bool Failed() const
+        {
+            return fFailed;
+        }
+
+        void Close();
+
+        // how often and for how long Write() waited for the consumer
+        long long NWaits() const
+        {
+            return fNWaits;
+        }
+        double WaitSeconds() const
+        {
+            return fWaitSeconds;
+        }
+
+    private:
+        struct Field
+        {
+            string name;
+            string type;
+            const char *source;
+            int type_bytes;
+            int offset;     // in the record
+            int bytes;      // in the record
+
+            // leaf count of a variable-length array, 0 if none
+            const char *count;
+            int count_type;
+            int element_bytes;
+        };
+
+        string fPath;
+        uint64_t fNSlots;
+        double fTimeout;
+        bool fFailed;
+        vector<Field> fFields;
+        uint32_t fRecordSize;
+
+        char *fMap;
+        size_t fMapSize;
+        RecordStreamHeader *fHeader;
+        uint64_t fHead;
+
+        long long fNWaits;
+        double fWaitSeconds;
+};
+
+#endif
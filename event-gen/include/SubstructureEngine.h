@@ -0,0 +1,109 @@
+#ifndef SUBSTRUCTUREENGINE_H
+#define SUBSTRUCTUREENGINE_H
+
+#include <vector>
+
+#include "fastjet/PseudoJet.hh"
+
+#include "Njettiness.hh"
+
+#include "myFastJetBase.h"
+#include "JetView.h"
+
+using namespace std;
+using fastjet::PseudoJet;
+
+// Which observables SubstructureEngine computes, and their parameters
+struct SubstructureConfig
+{
+    SubstructureConfig();
+
+    // tau_N (one-pass WTA kT axes, normalized measure) for each N
+    vector<int> tau_Ns;
+    double tau_beta;
+    double tau_R0;
+    // start the minimization from the tau_{N-1} (or seed) axes instead, see
+    // Compute; this saves about a sixth of the steps, but some tau_2 and tau_3
+    // end in a larger local minimum than without it, so it is off by default
+    // (TauMinimizationStats gives the steps on a real sample)
+    bool tau_warm_start;
+
+    // energy correlation functions e2, e3 and the ratios C2, D2
+    bool do_ecf;
+    double ecf_beta;
+
+    // jet charge for each kappa, from the charge of the constituents in the
+    // ParticleInfoTable given to the engine (or their MyUserInfo without one)
+    vector<double> charge_kappas;
+};
+
+// Observables of one jet, in the order of the SubstructureConfig lists
+struct SubstructureResult
+{
+    vector<double> taus;
+    vector<vector<PseudoJet> > tau_axes;
+
+    double e2;
+    double e3;
+    double C2;  // e3 / e2^2, -10 if e2 vanishes
+    double D2;  // e3 / e2^3, -10 if e2 vanishes
+
+    vector<double> charges;
+
+    int nconst;
+};
+
+// Computes a set of substructure observables of a jet in one go: the
+// constituents are read once into a JetView (pt, rapidity, phi, charge) that
+// all observables share, and the pairwise angular distances needed by the
+// energy correlation functions are computed once per pair.
+class SubstructureEngine
+{
+    public:
+        SubstructureEngine(const SubstructureConfig &config = SubstructureConfig());
+        ~SubstructureEngine();
+
+        // Fills result for jet.  With tau_warm_start, the tau_N axes are seeded
+        // with the tau_{N-1} axes of the same jet (for N-1 >= 2), or, if seed
+        // is given, with its tau_N axes (e.g. the result for the pixelized
+        // version of the jet); seed is ignored otherwise.
+        void Compute(const PseudoJet &jet, SubstructureResult &result,
+            const SubstructureResult *seed = 0);
+
+        // table the constituent charges are read from; it must outlive the
+        // Compute calls (0 reads MyUserInfo instead)
+        void SetParticleInfo(const ParticleInfoTable *info)
+        {
+            fInfo = info;
+        }
+
+        const SubstructureConfig& Config() const
+        {
+            return fConfig;
+        }
+
+        // one-pass minimizations of all tau_N so far, and their steps
+        fastjet::contrib::MinimizationStats TauMinimizationStats() const;
+
+    private:
+        SubstructureEngine(const SubstructureEngine &);
+        SubstructureEngine& operator=(const SubstructureEngine &);
+
+        void FillCache(const PseudoJet &jet);
+        void ComputeTaus(SubstructureResult &result, const SubstructureResult *seed);
+        void ComputeECF(SubstructureResult &result);
+        void ComputeCharges(SubstructureResult &result);
+
+        SubstructureConfig fConfig;
+        vector<fastjet::contrib::Njettiness*> fNjettiness;  // one per tau_Ns entry
+        const ParticleInfoTable *fInfo;
+
+        // constituent cache, refilled for each jet
+        JetView fView;
+        double fSumPt;
+
+        // pairwise distances R_ij^ecf_beta, n x n, filled for i < j
+        vector<double> fPairR;
+};
+
+#endif
@@ -1,6 +1,8 @@
 #ifndef MYFASTJETBASE_H
 #define MYFASTJETBASE_H
 
+#include <vector>
+
 #include "fastjet/PseudoJet.hh"
 
 using namespace fastjet;
@@ -8,7 +10,7 @@ using namespace fastjet;
 class MyUserInfo : public PseudoJet::UserInfoBase{
  public:
  MyUserInfo(const int & pdg_id_in,const int & pythia_id_in,  const double & charge_in, const bool & pileup_in) :
-  _pdg_id(pdg_id_in),_pythia_id(pythia_id_in), _charge(charge_in){}
+  _pdg_id(pdg_id_in),_pythia_id(pythia_id_in), _charge(charge_in), _pileup(pileup_in){}
   int pdg_id() const { return _pdg_id;}
   int pythia_id() const {return _pythia_id;}
   double charge() const { return _charge;}
@@ -20,4 +22,47 @@ class MyUserInfo : public PseudoJet::UserInfoBase{
   bool _pileup;
 };
 
+// The same information as MyUserInfo for all the particles of an event,
+// kept in one contiguous table instead of one heap-allocated object per
+// particle.  A particle refers to its row through its user_index, which
+// survives clustering, so jet constituents can be looked up as well;
+// particles without a row (user_index -1, e.g. calorimeter cells) read as
+// pdg id 0, pythia index -1, charge 0 and not pileup.
+//
+//   table.clear();
+//   p.set_user_index(table.add(pdg_id, pythia_id, charge, pileup));
+//   ... table.charge(jet.constituents()[i]) ...
+class ParticleInfoTable{
+ public:
+  void clear() { _pdg_id.clear(); _pythia_id.clear(); _charge.clear(); _pileup.clear();}
+  void reserve(unsigned int n) { _pdg_id.reserve(n); _pythia_id.reserve(n); _charge.reserve(n); _pileup.reserve(n);}
+  unsigned int size() const { return _pdg_id.size();}
+
+  // appends a row and returns its index, to be used as user_index
+  int add(int pdg_id_in, int pythia_id_in, double charge_in, bool pileup_in){
+    _pdg_id.push_back(pdg_id_in);
+    _pythia_id.push_back(pythia_id_in);
+    _charge.push_back(charge_in);
+    _pileup.push_back(pileup_in);
+    return _pdg_id.size() - 1;
+  }
+
+  bool has_info(const PseudoJet & p) const { return p.user_index() >= 0 && p.user_index() < (int) _pdg_id.size();}
+  int pdg_id(const PseudoJet & p) const { return has_info(p) ? _pdg_id[p.user_index()] : 0;}
+  int pythia_id(const PseudoJet & p) const { return has_info(p) ? _pythia_id[p.user_index()] : -1;}
+  double charge(const PseudoJet & p) const { return has_info(p) ? _charge[p.user_index()] : 0.;}
+  bool pileup(const PseudoJet & p) const { return has_info(p) ? _pileup[p.user_index()] != 0 : false;}
+
+  // direct access to the columns
+  const std::vector<int> & pdg_ids() const { return _pdg_id;}
+  const std::vector<int> & pythia_ids() const { return _pythia_id;}
+  const std::vector<double> & charges() const { return _charge;}
+  const std::vector<char> & pileups() const { return _pileup;}
+ protected:
+  std::vector<int> _pdg_id;
+  std::vector<int> _pythia_id;
+  std::vector<double> _charge;
+  std::vector<char> _pileup;
+};
+
 #endif
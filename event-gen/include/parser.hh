@@ -670,7 +670,9 @@ std::string parser::get_value<std::string>(std::string key)
 {
     try
     {
-        return m_values[key][0];
+        // an option with an empty default and not given has no value
+        std::vector<std::string> &values = m_values[key];
+        return values.empty() ? std::string() : values[0];
     }
     catch(std::out_of_range &err)
     {
@@ -678,7 +680,7 @@ std::string parser::get_value<std::string>(std::string key)
         e += key;
         e += "' which is not a valid field.";
         throw std::out_of_range(e);
-    }  
+    }
 }
 //----------------------------------------------------------------------------
 template <>
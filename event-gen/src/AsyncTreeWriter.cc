@@ -0,0 +1,236 @@
+#include <vector>
+#include <chrono>
+#include <string.h>
+
+#include "RVersion.h"
+#include "TROOT.h"
+#include "TTree.h"
+#include "TBranch.h"
+#include "TLeaf.h"
+#include "TObjArray.h"
+
+#include "AsyncTreeWriter.h"
+
+using namespace std;
+
+// Constructor
+AsyncTreeWriter::AsyncTreeWriter(TTree *tree, int nbuffers)
+    : fTree(tree), fRecords(nbuffers > 0 ? nbuffers : 1), fHead(0), fTail(0),
+      fQueued(0), fStopping(false), fRunning(false), fNStalls(0), fStallSeconds(0)
+{
+}
+
+// Destructor
+AsyncTreeWriter::~AsyncTreeWriter()
+{
+    Stop();
+}
+
+bool AsyncTreeWriter::Start()
+{
+    if (fRunning) return true;
+
+    TObjArray *branches = fTree->GetListOfBranches();
+    vector<Slot> slots(branches->GetEntriesFast());
+    for (unsigned int i = 0; i < slots.size(); i++)
+    {
+        TBranch *branch = (TBranch *) branches->UncheckedAt(i);
+        if (branch->IsA() != TBranch::Class() || branch->GetListOfBranches()->GetEntriesFast() > 0)
+            return false;
+
+        Slot &slot = slots[i];
+        slot.branch = branch;
+        slot.source = branch->GetAddress();
+        slot.fixed_bytes = 0;
+        slot.element_bytes = 0;
+        slot.count_slot = -1;
+        slot.count_offset = 0;
+        slot.count_type = 0;
+        if (!slot.source) return false;
+
+        TObjArray *leaves = branch->GetListOfLeaves();
+        for (int k = 0; k < leaves->GetEntriesFast(); k++)
+        {
+            TLeaf *leaf = (TLeaf *) leaves->UncheckedAt(k);
+            // strings have no fixed size
+            if (leaf->InheritsFrom("TLeafC")) return false;
+
+            int bytes = leaf->GetLenStatic() * leaf->GetLenType();
+            if (leaf->GetLeafCount())
+            {
+                if (leaves->GetEntriesFast() != 1) return false;
+                slot.element_bytes = bytes;
+            }
+            else if (leaf->GetOffset() + bytes > slot.fixed_bytes)
+            {
+                slot.fixed_bytes = leaf->GetOffset() + bytes;
+            }
+        }
+    }
+
+    // the slots holding the leaf counts of the variable-length arrays
+    for (unsigned int i = 0; i < slots.size(); i++)
+    {
+        if (slots[i].element_bytes == 0) continue;
+        TLeaf *count = ((TLeaf *) slots[i].branch->GetListOfLeaves()->UncheckedAt(0))->GetLeafCount();
+        for (unsigned int j = 0; j < slots.size(); j++)
+        {
+            if (slots[j].branch == count->GetBranch() && slots[j].element_bytes == 0)
+            {
+                slots[i].count_slot = j;
+                slots[i].count_offset = count->GetOffset();
+                slots[i].count_type = count->GetLenType();
+            }
+        }
+        if (slots[i].count_slot < 0) return false;
+    }
+
+    fSlots.swap(slots);
+    for (unsigned int i = 0; i < fSlots.size(); i++)
+    {
+        Slot &slot = fSlots[i];
+        long long bytes = slot.fixed_bytes;
+        if (slot.count_slot >= 0)
+        {
+            const Slot &count = fSlots[slot.count_slot];
+            bytes += slot.element_bytes * CountValue(count.source + slot.count_offset, slot.count_type);
+        }
+        slot.shadow.assign(bytes > 0 ? bytes : 1, 0);
+        slot.branch->SetAddress(&slot.shadow[0]);
+    }
+
+    // gDirectory and gFile become per thread, so that the baskets written
+    // from the writer thread do not change the directory of the caller
+#if ROOT_VERSION_CODE >= ROOT_VERSION(6,6,0)
+    ROOT::EnableThreadSafety();
+#endif
+
+    fHead = 0;
+    fTail = 0;
+    fQueued = 0;
+    fStopping = false;
+    fRunning = true;
+    fThread = thread(&AsyncTreeWriter::Run, this);
+    return true;
+}
+
+void AsyncTreeWriter::Fill()
+{
+    if (!fRunning)
+    {
+        fTree->Fill();
+        return;
+    }
+
+    int size = fRecords.size();
+    unique_lock<mutex> lock(fMutex);
+    if (fQueued == size)
+    {
+        fNStalls++;
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        fNotFull.wait(lock, [this, size] { return fQueued < size; });
+        fStallSeconds += chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    }
+    int index = fHead;
+    lock.unlock();
+
+    // the record between fHead and fTail belongs to this thread
+    Capture(fRecords[index]);
+
+    lock.lock();
+    fHead = (fHead + 1) % size;
+    fQueued++;
+    lock.unlock();
+    fNotEmpty.notify_one();
+}
+
+void AsyncTreeWriter::Stop()
+{
+    if (!fRunning) return;
+
+    {
+        lock_guard<mutex> lock(fMutex);
+        fStopping = true;
+    }
+    fNotEmpty.notify_one();
+    fThread.join();
+
+    for (unsigned int i = 0; i < fSlots.size(); i++)
+    {
+        fSlots[i].branch->SetAddress(fSlots[i].source);
+    }
+    fRunning = false;
+    fStopping = false;
+}
+
+long long AsyncTreeWriter::CountValue(const char *address, int type) const
+{
+    if (type == 1) return *(const unsigned char *) address;
+    if (type == 2) return *(const short *) address;
+    if (type == 8) return *(const long long *) address;
+    return *(const int *) address;
+}
+
+// Record: for each slot the number of bytes, then the bytes
+void AsyncTreeWriter::Capture(vector<char> &record) const
+{
+    record.clear();
+    for (unsigned int i = 0; i < fSlots.size(); i++)
+    {
+        const Slot &slot = fSlots[i];
+        int bytes = slot.fixed_bytes;
+        if (slot.count_slot >= 0)
+        {
+            const Slot &count = fSlots[slot.count_slot];
+            bytes += slot.element_bytes * CountValue(count.source + slot.count_offset, slot.count_type);
+        }
+
+        size_t at = record.size();
+        record.resize(at + sizeof(int) + bytes);
+        memcpy(&record[at], &bytes, sizeof(int));
+        if (bytes > 0) memcpy(&record[at + sizeof(int)], slot.source, bytes);
+    }
+}
+
+void AsyncTreeWriter::Release(const vector<char> &record)
+{
+    size_t at = 0;
+    for (unsigned int i = 0; i < fSlots.size(); i++)
+    {
+        Slot &slot = fSlots[i];
+        int bytes;
+        memcpy(&bytes, &record[at], sizeof(int));
+        at += sizeof(int);
+
+        if (bytes > (int) slot.shadow.size())
+        {
+            slot.shadow.resize(bytes);
+            slot.branch->SetAddress(&slot.shadow[0]);
+        }
+        if (bytes > 0) memcpy(&slot.shadow[0], &record[at], bytes);
+        at += bytes;
+    }
+}
+
+void AsyncTreeWriter::Run()
+{
+    int size = fRecords.size();
+    while (true)
+    {
+        {
+            unique_lock<mutex> lock(fMutex);
+            fNotEmpty.wait(lock, [this] { return fQueued > 0 || fStopping; });
+            if (fQueued == 0) break;
+        }
+
+        Release(fRecords[fTail]);
+        fTree->Fill();
+
+        {
+            lock_guard<mutex> lock(fMutex);
+            fTail = (fTail + 1) % size;
+            fQueued--;
+        }
+        fNotFull.notify_one();
+    }
+}
@@ -0,0 +1,115 @@
+#include <string>
+#include <vector>
+#include <math.h>
+
+#include "TTree.h"
+#include "TBranch.h"
+#include "TLeaf.h"
+
+#include "ConstituentArrays.h"
+
+using namespace std;
+
+// Constructor
+ConstituentArrays::ConstituentArrays(int capacity, bool with_info)
+    : fCapacity(capacity), fWithInfo(with_info), fN(0)
+{
+    fPt.assign(fCapacity, -999.f);
+    fEta.assign(fCapacity, -999.f);
+    fPhi.assign(fCapacity, -999.f);
+    fE.assign(fCapacity, -999.f);
+    if (fWithInfo)
+    {
+        fPdgId.assign(fCapacity, 0);
+        fCharge.assign(fCapacity, 0);
+    }
+}
+
+void ConstituentArrays::DeclareBranches(TTree *tree, const string &suffix)
+{
+    string count = "NConst" + suffix;
+    tree->Branch(count.c_str(), &fN, (count + "/I").c_str());
+
+    string names[4] = {"ConstPt", "ConstEta", "ConstPhi", "ConstE"};
+    float *arrays[4] = {&fPt[0], &fEta[0], &fPhi[0], &fE[0]};
+    for (int k = 0; k < 4; k++)
+    {
+        string name = names[k] + suffix;
+        tree->Branch(name.c_str(), arrays[k], (name + "[" + count + "]/F").c_str());
+    }
+    if (fWithInfo)
+    {
+        string pdg = "ConstPdgId" + suffix;
+        string charge = "ConstCharge" + suffix;
+        tree->Branch(pdg.c_str(), &fPdgId[0], (pdg + "[" + count + "]/I").c_str());
+        tree->Branch(charge.c_str(), &fCharge[0], (charge + "[" + count + "]/B").c_str());
+    }
+}
+
+bool ConstituentArrays::SetAddresses(TTree *tree, const string &suffix)
+{
+    string count = "NConst" + suffix;
+    TBranch *branch = tree->GetBranch(count.c_str());
+    if (!branch) return false;
+    if (fWithInfo && !tree->GetBranch(("ConstPdgId" + suffix).c_str())) return false;
+
+    // room for the longest list of the file
+    TLeaf *leaf = (TLeaf *) branch->GetListOfLeaves()->At(0);
+    int longest = leaf ? leaf->GetMaximum() : 0;
+    if (longest > fCapacity)
+    {
+        fCapacity = longest;
+        fPt.resize(fCapacity);
+        fEta.resize(fCapacity);
+        fPhi.resize(fCapacity);
+        fE.resize(fCapacity);
+        if (fWithInfo)
+        {
+            fPdgId.resize(fCapacity);
+            fCharge.resize(fCapacity);
+        }
+    }
+
+    tree->SetBranchAddress(count.c_str(), &fN);
+    tree->SetBranchAddress(("ConstPt" + suffix).c_str(), &fPt[0]);
+    tree->SetBranchAddress(("ConstEta" + suffix).c_str(), &fEta[0]);
+    tree->SetBranchAddress(("ConstPhi" + suffix).c_str(), &fPhi[0]);
+    tree->SetBranchAddress(("ConstE" + suffix).c_str(), &fE[0]);
+    if (fWithInfo)
+    {
+        tree->SetBranchAddress(("ConstPdgId" + suffix).c_str(), &fPdgId[0]);
+        tree->SetBranchAddress(("ConstCharge" + suffix).c_str(), &fCharge[0]);
+    }
+    return true;
+}
+
+void ConstituentArrays::Reset()
+{
+    fN = fCapacity;
+    fPt.assign(fCapacity, -999.f);
+    fEta.assign(fCapacity, -999.f);
+    fPhi.assign(fCapacity, -999.f);
+    fE.assign(fCapacity, -999.f);
+    if (fWithInfo)
+    {
+        fPdgId.assign(fCapacity, 0);
+        fCharge.assign(fCapacity, 0);
+    }
+}
+
+bool ConstituentArrays::Add(double pt, double eta, double phi, double E,
+    int pdg_id, double charge)
+{
+    if (fN >= fCapacity) return false;
+    fPt[fN] = (float) pt;
+    fEta[fN] = (float) eta;
+    fPhi[fN] = (float) phi;
+    fE[fN] = (float) E;
+    if (fWithInfo)
+    {
+        fPdgId[fN] = pdg_id;
+        fCharge[fN] = (signed char) floor(charge + 0.5);
+    }
+    fN++;
+    return true;
+}
@@ -0,0 +1,163 @@
+#include <math.h>
+#include <vector>
+
+#include "fastjet/PseudoJet.hh"
+
+#include "EtaPhiLookup.h"
+
+using namespace std;
+using fastjet::PseudoJet;
+
+// rapidities are clamped to this range for the binning only, so that
+// particles at the PseudoJet rapidity cap do not blow up the grid
+static const double lookup_max_rap = 10.;
+
+// smallest cell size: smaller ones (or none at all, for a cell size <= 0)
+// would only make the grid huge, while bigger cells give the same results
+static const double lookup_min_cellsize = 0.05;
+
+static double ClampRap(double rap)
+{
+    if (rap > lookup_max_rap) return lookup_max_rap;
+    if (rap < -lookup_max_rap) return -lookup_max_rap;
+    return rap;
+}
+
+// Constructor
+EtaPhiLookup::EtaPhiLookup(double cellsize)
+    : fCellSize(cellsize >= lookup_min_cellsize ? cellsize : lookup_min_cellsize),
+      fRapMin(0), fPhiWidth(2. * M_PI), fNRap(0), fNPhi(1)
+{
+    fNPhi = (int) (2. * M_PI / fCellSize);
+    if (fNPhi < 1) fNPhi = 1;
+    fPhiWidth = 2. * M_PI / fNPhi;
+}
+
+void EtaPhiLookup::Fill(const vector<PseudoJet> &particles)
+{
+    unsigned int n = particles.size();
+    fRap.resize(n);
+    fPhi.resize(n);
+
+    double rap_max = 0;
+    for (unsigned int i = 0; i < n; i++)
+    {
+        fRap[i] = particles[i].rap();
+        fPhi[i] = particles[i].phi();
+        double rap = ClampRap(fRap[i]);
+        if (i == 0 || rap < fRapMin) fRapMin = rap;
+        if (i == 0 || rap > rap_max) rap_max = rap;
+    }
+    fNRap = n > 0 ? (int) ((rap_max - fRapMin) / fCellSize) + 1 : 0;
+
+    // counting sort of the particles into their cells
+    fStart.assign(fNRap * fNPhi + 1, 0);
+    vector<int> cell(n);
+    for (unsigned int i = 0; i < n; i++)
+    {
+        cell[i] = RapBin(ClampRap(fRap[i])) * fNPhi + PhiBin(fPhi[i]);
+        fStart[cell[i] + 1]++;
+    }
+    for (unsigned int c = 0; c + 1 < fStart.size(); c++)
+    {
+        fStart[c + 1] += fStart[c];
+    }
+
+    fIndex.resize(n);
+    vector<int> next(fStart.begin(), fStart.end() - 1);
+    for (unsigned int i = 0; i < n; i++)
+    {
+        fIndex[next[cell[i]]++] = i;
+    }
+}
+
+int EtaPhiLookup::RapBin(double rap) const
+{
+    int bin = (int) floor((rap - fRapMin) / fCellSize);
+    if (bin < 0) return 0;
+    if (bin >= fNRap) return fNRap - 1;
+    return bin;
+}
+
+int EtaPhiLookup::PhiBin(double phi) const
+{
+    int bin = (int) floor(phi / fPhiWidth);
+    if (bin < 0) return 0;
+    if (bin >= fNPhi) return fNPhi - 1;
+    return bin;
+}
+
+bool EtaPhiLookup::Range(const PseudoJet &centre, double radius,
+    int &rap_lo, int &rap_hi, int &phi_lo, int &phi_hi) const
+{
+    if (fNRap == 0 || !(radius > 0)) return false;
+
+    double rap = centre.rap();
+    rap_lo = RapBin(ClampRap(rap - radius));
+    rap_hi = RapBin(ClampRap(rap + radius));
+
+    // in cells, as a double so that a huge radius does not overflow
+    double reach = ceil(radius / fPhiWidth);
+    if (2 * reach + 1 >= fNPhi)
+    {
+        phi_lo = 0;
+        phi_hi = fNPhi - 1;
+    }
+    else
+    {
+        int centre_bin = PhiBin(centre.phi());
+        phi_lo = centre_bin - (int) reach;
+        phi_hi = centre_bin + (int) reach;
+    }
+    return true;
+}
+
+void EtaPhiLookup::Within(const PseudoJet &centre, double radius, vector<int> &found) const
+{
+    int rap_lo, rap_hi, phi_lo, phi_hi;
+    if (!Range(centre, radius, rap_lo, rap_hi, phi_lo, phi_hi)) return;
+
+    double rap = centre.rap();
+    double phi = centre.phi();
+    for (int ir = rap_lo; ir <= rap_hi; ir++)
+    {
+        for (int ip = phi_lo; ip <= phi_hi; ip++)
+        {
+            int c = ir * fNPhi + (ip + fNPhi) % fNPhi;
+            for (int k = fStart[c]; k < fStart[c + 1]; k++)
+            {
+                int i = fIndex[k];
+                // same arithmetic as PseudoJet::delta_R
+                double dphi = fabs(fPhi[i] - phi);
+                if (dphi > M_PI) dphi = 2. * M_PI - dphi;
+                double drap = fRap[i] - rap;
+                if (sqrt(dphi * dphi + drap * drap) < radius) found.push_back(i);
+            }
+        }
+    }
+}
+
+bool EtaPhiLookup::AnyWithin(const PseudoJet &centre, double radius) const
+{
+    int rap_lo, rap_hi, phi_lo, phi_hi;
+    if (!Range(centre, radius, rap_lo, rap_hi, phi_lo, phi_hi)) return false;
+
+    double rap = centre.rap();
+    double phi = centre.phi();
+    for (int ir = rap_lo; ir <= rap_hi; ir++)
+    {
+        for (int ip = phi_lo; ip <= phi_hi; ip++)
+        {
+            int c = ir * fNPhi + (ip + fNPhi) % fNPhi;
+            for (int k = fStart[c]; k < fStart[c + 1]; k++)
+            {
+                int i = fIndex[k];
+                double dphi = fabs(fPhi[i] - phi);
+                if (dphi > M_PI) dphi = 2. * M_PI - dphi;
+                double drap = fRap[i] - rap;
+                if (sqrt(dphi * dphi + drap * drap) < radius) return true;
+            }
+        }
+    }
+    return false;
+}
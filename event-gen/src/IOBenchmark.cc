@@ -0,0 +1,238 @@
+// Write throughput of the EventTree for each OutputProfile.
+//
+// Writes the same events with every profile and reports the write speed
+// (uncompressed MB/s), the file size per event, the compression ratio and
+// the speed of reading the file back.  The events are either copied from an
+// existing event-gen file (--Input) or synthetic: a sparse jet image with
+// the energy falling off from the centre, stored with --ImageEncoding, and
+// the scalar branches of the EventTree filled with random values.
+
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <math.h>
+#include <stdio.h>
+
+#include "TFile.h"
+#include "TTree.h"
+#include "TRandom3.h"
+#include "TStopwatch.h"
+#include "TSystem.h"
+
+#include "OutputProfile.h"
+#include "ImageCodec.h"
+#include "parser.hh"
+
+using namespace std;
+
+// scalar branches of a synthetic EventTree
+static const int bench_nscalars = 40;
+
+static void FillSynthetic(TRandom3 &rand, int pixels, float *image, float *scalars)
+{
+    int n = pixels * pixels;
+    for (int i = 0; i < n; i++) image[i] = 0;
+
+    // two prongs of a few dozen cells each
+    for (int prong = 0; prong < 2; prong++)
+    {
+        double x0 = pixels * (0.5 + (prong ? rand.Gaus(0, 0.15) : 0.));
+        double y0 = pixels * (0.5 + (prong ? rand.Gaus(0, 0.15) : 0.));
+        double energy = prong ? rand.Uniform(20, 200) : rand.Uniform(100, 500);
+        int ncells = 10 + rand.Integer(40);
+        for (int k = 0; k < ncells; k++)
+        {
+            int x = (int) (x0 + rand.Gaus(0, 1.5));
+            int y = (int) (y0 + rand.Gaus(0, 1.5));
+            if (x < 0 || y < 0 || x >= pixels || y >= pixels) continue;
+            image[x * pixels + y] += energy * rand.Exp(1.) / ncells;
+        }
+    }
+    for (int i = 0; i < bench_nscalars; i++) scalars[i] = rand.Gaus(0, 100);
+}
+
+struct BenchResult
+{
+    double write_seconds;
+    double read_seconds;
+    double raw_bytes;
+    double file_bytes;
+};
+
+static BenchResult Run(const OutputProfile &profile, const string &path,
+    TTree *input, int nevents, int pixels, ImageCodec::Encoding encoding)
+{
+    BenchResult result;
+
+    TFile *file;
+    if (profile.algorithm >= 0)
+        file = new TFile(path.c_str(), "RECREATE", "", profile.Compression());
+    else
+        file = new TFile(path.c_str(), "RECREATE");
+
+    int nfilled = pixels * pixels;
+    vector<float> image(nfilled);
+    vector<float> scalars(bench_nscalars);
+    ImageCodec codec(encoding, nfilled);
+    TTree *tree;
+    if (input)
+    {
+        tree = input->CloneTree(0);
+        tree->SetDirectory(file);
+    }
+    else
+    {
+        tree = new TTree("EventTree", "Event Tree for MI");
+        tree->Branch("NFilled", &nfilled, "NFilled/I");
+        if (encoding == ImageCodec::Float32)
+            tree->Branch("Intensity", &image[0], "Intensity[NFilled]/F");
+        else
+            codec.DeclareBranches(tree);
+        for (int i = 0; i < bench_nscalars; i++)
+        {
+            stringstream name;
+            name << "Scalar" << i;
+            tree->Branch(name.str().c_str(), &scalars[i], (name.str() + "/F").c_str());
+        }
+    }
+    profile.ApplyTo(tree, nfilled);
+
+    TRandom3 rand(12345);
+    TStopwatch write_clock;
+    write_clock.Stop();
+    write_clock.Reset();
+    for (int i = 0; i < nevents; i++)
+    {
+        if (input)
+        {
+            input->GetEntry(i % input->GetEntries());
+        }
+        else
+        {
+            FillSynthetic(rand, pixels, &image[0], &scalars[0]);
+            codec.Encode(&image[0]);
+        }
+
+        write_clock.Start(kFALSE);
+        tree->Fill();
+        write_clock.Stop();
+    }
+    write_clock.Start(kFALSE);
+    tree->Write();
+    result.raw_bytes = tree->GetTotBytes();
+    file->Close();
+    write_clock.Stop();
+    result.write_seconds = write_clock.RealTime();
+    delete file;
+
+    FileStat_t stat;
+    gSystem->GetPathInfo(path.c_str(), stat);
+    result.file_bytes = stat.fSize;
+
+    // read back every branch of every event
+    TStopwatch read_clock;
+    TFile *in = TFile::Open(path.c_str());
+    TTree *back = (TTree *) in->Get("EventTree");
+    for (Long64_t i = 0; i < back->GetEntries(); i++) back->GetEntry(i);
+    read_clock.Stop();
+    result.read_seconds = read_clock.RealTime();
+    in->Close();
+    delete in;
+
+    gSystem->Unlink(path.c_str());
+    return result;
+}
+
+int main(int argc, const char* argv[])
+{
+    optionparser::parser parser("Write throughput of the EventTree for each output profile");
+
+    parser.add_option("--NEvents").mode(optionparser::store_value).default_value(20000).help("Number of events to write per profile");
+    parser.add_option("--Pixels").mode(optionparser::store_value).default_value(25).help("Number of pixels per dimension of the synthetic images");
+    parser.add_option("--Input").mode(optionparser::store_value).default_value("").help("event-gen file to take the events from instead of synthetic ones");
+    parser.add_option("--Profiles").mode(optionparser::store_value).default_value("").help("Comma separated profiles to run (default: all)");
+    parser.add_option("--ImageEncoding").mode(optionparser::store_value).default_value("float32").help("Storage of the synthetic images: float32, float16, log-uint16 or uint8");
+    parser.add_option("--TmpFile").mode(optionparser::store_value).default_value("io-benchmark.root").help("Scratch output file");
+
+    parser.eat_arguments(argc, argv);
+
+    int nevents = parser.get_value<int>("NEvents");
+    int pixels = parser.get_value<int>("Pixels");
+    string inputName = parser.get_value<string>("Input");
+    string profileNames = parser.get_value<string>("Profiles");
+    string tmpName = parser.get_value<string>("TmpFile");
+    string encodingName = parser.get_value<string>("ImageEncoding");
+
+    ImageCodec::Encoding encoding;
+    if (!ImageCodec::FromName(encodingName, encoding))
+    {
+        cerr << "Unknown image encoding " << encodingName << endl;
+        return 1;
+    }
+
+    vector<OutputProfile> profiles;
+    if (profileNames.empty())
+    {
+        profiles = OutputProfile::All();
+    }
+    else
+    {
+        stringstream names(profileNames);
+        string name;
+        while (getline(names, name, ','))
+        {
+            OutputProfile profile;
+            if (!OutputProfile::Find(name, profile))
+            {
+                cerr << "Unknown output profile " << name << endl;
+                return 1;
+            }
+            profiles.push_back(profile);
+        }
+    }
+
+    TFile *inputFile = 0;
+    TTree *input = 0;
+    if (!inputName.empty())
+    {
+        inputFile = TFile::Open(inputName.c_str());
+        if (!inputFile || inputFile->IsZombie())
+        {
+            cerr << "Cannot open " << inputName << endl;
+            return 1;
+        }
+        input = (TTree *) inputFile->Get("EventTree");
+        if (!input || input->GetEntries() == 0)
+        {
+            cerr << "No events in " << inputName << endl;
+            return 1;
+        }
+        pixels = (int) sqrt((double) input->GetMaximum("NFilled") + 0.5);
+    }
+
+    cout << nevents << " events, " << (input ? inputName : "synthetic") << ", "
+         << pixels << "x" << pixels << " images";
+    if (!input) cout << " stored as " << encodingName;
+    cout << endl;
+    cout << setw(16) << "profile"
+         << setw(14) << "write MB/s"
+         << setw(14) << "bytes/event"
+         << setw(10) << "ratio"
+         << setw(14) << "read MB/s" << endl;
+
+    for (unsigned int p = 0; p < profiles.size(); p++)
+    {
+        BenchResult r = Run(profiles[p], tmpName, input, nevents, pixels, encoding);
+        double mb = r.raw_bytes / 1e6;
+        cout << setw(16) << profiles[p].name
+             << setw(14) << fixed << setprecision(1) << mb / r.write_seconds
+             << setw(14) << setprecision(0) << r.file_bytes / nevents
+             << setw(10) << setprecision(2) << r.raw_bytes / r.file_bytes
+             << setw(14) << setprecision(1) << mb / r.read_seconds << endl;
+    }
+
+    if (inputFile) inputFile->Close();
+    return 0;
+}
@@ -0,0 +1,186 @@
+#include <string>
+#include <vector>
+#include <math.h>
+#include <string.h>
+
+#include "TTree.h"
+
+#include "ImageCodec.h"
+
+using namespace std;
+
+// 1e-4 to 1e5 GeV over 65534 codes: half a step is 1.58e-4 in ln(E)
+const double ImageCodec::log_min = 1e-4;
+const double ImageCodec::log_max = 1e5;
+const double ImageCodec::log_step = (log(1e5) - log(1e-4)) / 65534.;
+
+// Constructor
+ImageCodec::ImageCodec(Encoding encoding, int size)
+    : fEncoding(encoding), fSize(size), fScale(0), fNImages(0), fSumError(0), fMaxError(0)
+{
+    if (fEncoding == Float16 || fEncoding == LogUInt16) fCodes16.assign(size, 0);
+    if (fEncoding == ScaledUInt8) fCodes8.assign(size, 0);
+    fDecoded.assign(size, 0.f);
+}
+
+bool ImageCodec::FromName(const string &name, Encoding &encoding)
+{
+    if (name == "float32")         encoding = Float32;
+    else if (name == "float16")    encoding = Float16;
+    else if (name == "log-uint16") encoding = LogUInt16;
+    else if (name == "uint8")      encoding = ScaledUInt8;
+    else return false;
+    return true;
+}
+
+string ImageCodec::Name(Encoding encoding)
+{
+    if (encoding == Float16)     return "float16";
+    if (encoding == LogUInt16)   return "log-uint16";
+    if (encoding == ScaledUInt8) return "uint8";
+    return "float32";
+}
+
+void ImageCodec::DeclareBranches(TTree *tree, const string &name, const string &length)
+{
+    if (fEncoding == Float16)
+    {
+        string branch = name + "_f16";
+        tree->Branch(branch.c_str(), &fCodes16[0], (branch + "[" + length + "]/s").c_str());
+    }
+    else if (fEncoding == LogUInt16)
+    {
+        string branch = name + "_log16";
+        tree->Branch(branch.c_str(), &fCodes16[0], (branch + "[" + length + "]/s").c_str());
+    }
+    else if (fEncoding == ScaledUInt8)
+    {
+        string branch = name + "_u8";
+        string scale = name + "Scale";
+        tree->Branch(branch.c_str(), &fCodes8[0], (branch + "[" + length + "]/b").c_str());
+        tree->Branch(scale.c_str(), &fScale, (scale + "/F").c_str());
+    }
+}
+
+void ImageCodec::Encode(const float *image)
+{
+    if (fEncoding == Float32) return;
+
+    if (fEncoding == Float16)
+    {
+        for (int i = 0; i < fSize; i++) fCodes16[i] = HalfFromFloat(image[i]);
+    }
+    else if (fEncoding == LogUInt16)
+    {
+        for (int i = 0; i < fSize; i++) fCodes16[i] = LogCode(image[i]);
+    }
+    else
+    {
+        float max = 0;
+        for (int i = 0; i < fSize; i++)
+        {
+            if (image[i] > max) max = image[i];
+        }
+        fScale = max / 255.f;
+        for (int i = 0; i < fSize; i++)
+        {
+            double k = image[i] > 0 && fScale > 0 ? floor(image[i] / fScale + 0.5) : 0.;
+            fCodes8[i] = (unsigned char) (k > 255 ? 255 : k);
+        }
+    }
+
+    // relative L2 error of the image
+    Decode(&fDecoded[0]);
+    double norm = 0, diff = 0;
+    for (int i = 0; i < fSize; i++)
+    {
+        norm += (double) image[i] * image[i];
+        diff += ((double) fDecoded[i] - image[i]) * ((double) fDecoded[i] - image[i]);
+    }
+    double error = norm > 0 ? sqrt(diff / norm) : 0.;
+    fNImages++;
+    fSumError += error;
+    if (error > fMaxError) fMaxError = error;
+}
+
+void ImageCodec::Decode(float *image) const
+{
+    if (fEncoding == Float16)
+    {
+        for (int i = 0; i < fSize; i++) image[i] = FloatFromHalf(fCodes16[i]);
+    }
+    else if (fEncoding == LogUInt16)
+    {
+        for (int i = 0; i < fSize; i++) image[i] = LogValue(fCodes16[i]);
+    }
+    else if (fEncoding == ScaledUInt8)
+    {
+        for (int i = 0; i < fSize; i++) image[i] = fCodes8[i] * fScale;
+    }
+}
+
+unsigned short ImageCodec::HalfFromFloat(float value)
+{
+    unsigned int bits;
+    memcpy(&bits, &value, sizeof(bits));
+    unsigned int sign = (bits >> 16) & 0x8000;
+    unsigned int abs = bits & 0x7fffffff;
+
+    if (abs > 0x7f800000) return sign | 0x7e00;     // NaN
+    if (abs > 0x477fe000) return sign | 0x7bff;     // beyond 65504
+
+    if (abs < 0x38800000)
+    {
+        // below 2^-14: a subnormal half, 2^-25 and below round to zero
+        if (abs <= 0x33000000) return sign;
+        unsigned int exp = abs >> 23;
+        unsigned int mant = (abs & 0x7fffff) | 0x800000;
+        unsigned int shift = 126 - exp;
+        unsigned int half = mant >> shift;
+        unsigned int rest = mant & ((1u << shift) - 1);
+        unsigned int tie = 1u << (shift - 1);
+        if (rest > tie || (rest == tie && (half & 1))) half++;
+        return sign | half;
+    }
+
+    // rebias the exponent from 127 to 15, round the 13 bits dropped
+    unsigned int half = (abs - 0x38000000) >> 13;
+    unsigned int rest = abs & 0x1fff;
+    if (rest > 0x1000 || (rest == 0x1000 && (half & 1))) half++;
+    return sign | half;
+}
+
+float ImageCodec::FloatFromHalf(unsigned short half)
+{
+    unsigned int sign = (half & 0x8000) << 16;
+    unsigned int exp = (half >> 10) & 0x1f;
+    unsigned int mant = half & 0x3ff;
+
+    if (exp == 0)
+    {
+        float value = ldexpf((float) mant, -24);
+        return sign ? -value : value;
+    }
+
+    unsigned int bits;
+    if (exp == 31) bits = sign | 0x7f800000 | (mant << 13);
+    else bits = sign | ((exp + 112) << 23) | (mant << 13);
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+unsigned short ImageCodec::LogCode(float value)
+{
+    if (!(value > 0)) return 0;
+    double x = floor(log(value / log_min) / log_step + 0.5);
+    if (x < 0) return 1;
+    if (x > 65534) return 65535;
+    return (unsigned short) (x + 1);
+}
+
+float ImageCodec::LogValue(unsigned short code)
+{
+    if (code == 0) return 0.f;
+    return (float) (log_min * exp((code - 1) * log_step));
+}
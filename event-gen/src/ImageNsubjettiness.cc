@@ -0,0 +1,320 @@
+#include <math.h>
+#include <vector>
+
+#include "ImageNsubjettiness.h"
+
+using namespace std;
+
+// refinement steps per N, and the relative tau change taken as converged
+static const int image_max_iterations = 20;
+static const double image_precision = 1e-6;
+
+// Constructor
+ImageNsubjettiness::ImageNsubjettiness(int pixels, double range, double beta, double R0)
+    : fPixels(pixels), fRange(range), fBeta(beta), fR0(R0), fSumW(0)
+{
+    double width = 2. * range / pixels;
+    fMinDist = 1e-3 * width;
+
+    // same binning as the TH2F the image is filled from
+    fCellX.resize(pixels);
+    fCellY.resize(pixels);
+    for (int i = 0; i < pixels; i++)
+    {
+        fCellX[i] = -range + (i + 0.5) * width;
+        fCellY[i] = -range + (i + 0.5) * width;
+    }
+}
+
+double ImageNsubjettiness::Tau(int N, const float *image)
+{
+    LoadImage(image);
+    fAxisX.clear();
+    fAxisY.clear();
+    if (fSumW <= 0 || N < 1) return 0.;
+
+    Cluster(N);
+    return Evaluate(N) / (fSumW * pow(fR0, fBeta));
+}
+
+void ImageNsubjettiness::Taus(const vector<int> &Ns, const float *image, vector<double> &taus)
+{
+    taus.assign(Ns.size(), 0.);
+
+    int maxN = 0;
+    for (unsigned int k = 0; k < Ns.size(); k++)
+    {
+        if (Ns[k] > maxN) maxN = Ns[k];
+    }
+
+    LoadImage(image);
+    fAxisX.clear();
+    fAxisY.clear();
+    if (fSumW <= 0 || maxN < 1) return;
+
+    Cluster(maxN);
+    double norm = fSumW * pow(fR0, fBeta);
+    for (unsigned int k = 0; k < Ns.size(); k++)
+    {
+        if (Ns[k] >= 1) taus[k] = Evaluate(Ns[k]) / norm;
+    }
+}
+
+// Keeps the filled cells only, so that the loops below run over a dense list
+void ImageNsubjettiness::LoadImage(const float *image)
+{
+    fX.clear();
+    fY.clear();
+    fW.clear();
+    fSumW = 0;
+
+    int counter = 0;
+    for (int i = 0; i < fPixels; i++)
+    {
+        for (int j = 0; j < fPixels; j++)
+        {
+            double w = image[counter++];
+            if (w > 0)
+            {
+                fX.push_back(fCellX[i]);
+                fY.push_back(fCellY[j]);
+                fW.push_back(w);
+                fSumW += w;
+            }
+        }
+    }
+
+    fD2.resize(fW.size());
+    fDist.resize(fW.size());
+    fLabel.resize(fW.size());
+}
+
+// Exclusive kT clustering of the filled cells with winner-take-all
+// recombination (the image analogue of the WTA kT axes), run down to one
+// jet; the positions of the jets left when there are n <= maxN of them are
+// the seed axes for tau_n.  A merged jet sits at the position of its harder
+// parent, so only the jets whose geometric nearest neighbour was the softer
+// one need a new neighbour search.
+void ImageNsubjettiness::Cluster(int maxN)
+{
+    unsigned int ncells = fW.size();
+    fSeedX.assign(maxN + 1, vector<double>());
+    fSeedY.assign(maxN + 1, vector<double>());
+
+    vector<double> w(fW);
+    vector<int> alive(ncells);
+    vector<int> nn(ncells, -1);
+    vector<double> nn_dist(ncells, 1e300);
+    for (unsigned int c = 0; c < ncells; c++) alive[c] = c;
+
+    for (unsigned int a = 0; a < ncells; a++)
+    {
+        for (unsigned int b = a + 1; b < ncells; b++)
+        {
+            double dx = fX[a] - fX[b];
+            double dy = fY[a] - fY[b];
+            double r2 = dx * dx + dy * dy;
+            if (r2 < nn_dist[a]) { nn_dist[a] = r2; nn[a] = b; }
+            if (r2 < nn_dist[b]) { nn_dist[b] = r2; nn[b] = a; }
+        }
+    }
+
+    while (true)
+    {
+        unsigned int njets = alive.size();
+        if ((int) njets <= maxN)
+        {
+            for (unsigned int a = 0; a < njets; a++)
+            {
+                fSeedX[njets].push_back(fX[alive[a]]);
+                fSeedY[njets].push_back(fY[alive[a]]);
+            }
+        }
+        if (njets <= 1) break;
+
+        // smallest d_ij = min(w_i, w_j)^2 dR_ij^2 is between neighbours
+        unsigned int best = 0;
+        double best_dij = 1e300;
+        for (unsigned int a = 0; a < njets; a++)
+        {
+            int i = alive[a];
+            double wmin = w[i] < w[nn[i]] ? w[i] : w[nn[i]];
+            double dij = wmin * wmin * nn_dist[i];
+            if (dij < best_dij)
+            {
+                best_dij = dij;
+                best = a;
+            }
+        }
+
+        int i = alive[best];
+        int j = nn[i];
+        int winner = w[i] >= w[j] ? i : j;
+        int loser = winner == i ? j : i;
+        w[winner] += w[loser];
+
+        for (unsigned int a = 0; a < njets; a++)
+        {
+            if (alive[a] == loser)
+            {
+                alive[a] = alive[njets - 1];
+                alive.pop_back();
+                break;
+            }
+        }
+        njets--;
+
+        for (unsigned int a = 0; a < njets; a++)
+        {
+            int k = alive[a];
+            if (nn[k] != loser) continue;
+            nn_dist[k] = 1e300;
+            nn[k] = k;
+            for (unsigned int b = 0; b < njets; b++)
+            {
+                int l = alive[b];
+                if (l == k) continue;
+                double dx = fX[k] - fX[l];
+                double dy = fY[k] - fY[l];
+                double r2 = dx * dx + dy * dy;
+                if (r2 < nn_dist[k]) { nn_dist[k] = r2; nn[k] = l; }
+            }
+        }
+    }
+}
+
+// Seeds the axes for tau_N from the clustering and refines them; with no
+// more filled cells than axes, every cell gets its own axis and tau vanishes
+double ImageNsubjettiness::Evaluate(int N)
+{
+    if ((int) fW.size() <= N)
+    {
+        fAxisX = fX;
+        fAxisY = fY;
+        return 0.;
+    }
+    fAxisX = fSeedX[N];
+    fAxisY = fSeedY[N];
+    return Refine();
+}
+
+// Assigns each cell to its nearest axis and returns sum_i w_i dR_i^beta
+double ImageNsubjettiness::Assign()
+{
+    unsigned int ncells = fW.size();
+    unsigned int naxes = fAxisX.size();
+    double *d2 = &fD2[0];
+    double *dist = &fDist[0];
+    int *label = &fLabel[0];
+    const double *x = &fX[0];
+    const double *y = &fY[0];
+
+    for (unsigned int c = 0; c < ncells; c++)
+    {
+        double dx = x[c] - fAxisX[0];
+        double dy = y[c] - fAxisY[0];
+        d2[c] = dx * dx + dy * dy;
+        label[c] = 0;
+    }
+    for (unsigned int k = 1; k < naxes; k++)
+    {
+        double ax = fAxisX[k];
+        double ay = fAxisY[k];
+        for (unsigned int c = 0; c < ncells; c++)
+        {
+            double dx = x[c] - ax;
+            double dy = y[c] - ay;
+            double r2 = dx * dx + dy * dy;
+            bool closer = r2 < d2[c];
+            d2[c] = closer ? r2 : d2[c];
+            label[c] = closer ? (int) k : label[c];
+        }
+    }
+
+    double sum = 0;
+    const double *w = &fW[0];
+    if (fBeta == 2.)
+    {
+        for (unsigned int c = 0; c < ncells; c++)
+        {
+            dist[c] = d2[c];
+            sum += w[c] * dist[c];
+        }
+    }
+    else if (fBeta == 1.)
+    {
+        for (unsigned int c = 0; c < ncells; c++)
+        {
+            dist[c] = sqrt(d2[c]);
+            sum += w[c] * dist[c];
+        }
+    }
+    else
+    {
+        double half_beta = 0.5 * fBeta;
+        for (unsigned int c = 0; c < ncells; c++)
+        {
+            dist[c] = pow(d2[c], half_beta);
+            sum += w[c] * dist[c];
+        }
+    }
+    return sum;
+}
+
+// Moves each axis to the minimum of sum_i w_i dR_i^beta over its cells with
+// the reweighted mean u_i = w_i dR_i^(beta-2), and stops as soon as tau no
+// longer decreases; returns the tau numerator of the final axes
+double ImageNsubjettiness::Refine()
+{
+    unsigned int ncells = fW.size();
+    unsigned int naxes = fAxisX.size();
+    double tau = Assign();
+
+    vector<double> old_x(naxes);
+    vector<double> old_y(naxes);
+    double min_d2 = fMinDist * fMinDist;
+    double floor_weight = pow(min_d2, 0.5 * fBeta - 1.);
+
+    for (int iter = 0; iter < image_max_iterations; iter++)
+    {
+        if (tau <= 0) break;
+
+        old_x = fAxisX;
+        old_y = fAxisY;
+        for (unsigned int k = 0; k < naxes; k++)
+        {
+            double sx = 0;
+            double sy = 0;
+            double su = 0;
+            for (unsigned int c = 0; c < ncells; c++)
+            {
+                // dR^(beta-2) = dR^beta / dR^2, with dR floored at fMinDist
+                double u = fW[c] * (fD2[c] > min_d2 ?
+                    fDist[c] / fD2[c] : floor_weight);
+                u = (fLabel[c] == (int) k) ? u : 0.;
+                sx += u * fX[c];
+                sy += u * fY[c];
+                su += u;
+            }
+            if (su > 0)
+            {
+                fAxisX[k] = sx / su;
+                fAxisY[k] = sy / su;
+            }
+        }
+
+        double new_tau = Assign();
+        if (new_tau >= tau)
+        {
+            fAxisX = old_x;
+            fAxisY = old_y;
+            tau = Assign();
+            break;
+        }
+
+        bool converged = (tau - new_tau) < image_precision * tau;
+        tau = new_tau;
+        if (converged) break;
+    }
+    return tau;
+}
@@ -0,0 +1,268 @@
+#include <string>
+#include <vector>
+#include <sstream>
+#include <stdlib.h>
+#include <math.h>
+
+#include "TTree.h"
+
+#include "ImageSet.h"
+#include "ImageCodec.h"
+
+using namespace std;
+
+// Constructor
+ImageConfig::ImageConfig()
+    : pixels(25), range(1.0), rotate(false), flip(false), normalize(false)
+{
+}
+
+bool ImageConfig::Parse(const string &spec, vector<ImageConfig> &configs)
+{
+    configs.clear();
+    stringstream list(spec);
+    string item;
+    while (getline(list, item, ','))
+    {
+        if (item.empty()) continue;
+
+        ImageConfig config;
+        size_t equals = item.find('=');
+        if (equals != string::npos)
+        {
+            config.name = item.substr(0, equals);
+            item = item.substr(equals + 1);
+        }
+
+        stringstream fields(item);
+        string pixels, range, steps;
+        if (!getline(fields, pixels, ':') || !getline(fields, range, ':')) return false;
+        getline(fields, steps);
+
+        // the range goes through a float, as --Range does
+        config.pixels = atoi(pixels.c_str());
+        config.range = (float) atof(range.c_str());
+        if (config.pixels <= 0 || !(config.range > 0)) return false;
+
+        stringstream stepList(steps);
+        string step;
+        string suffix;
+        while (getline(stepList, step, '+'))
+        {
+            if (step == "rotate")         config.rotate = true;
+            else if (step == "flip")      config.flip = true;
+            else if (step == "normalize") config.normalize = true;
+            else if (!step.empty())       return false;
+            if (!step.empty()) suffix += "_" + step;
+        }
+
+        if (config.name.empty())
+        {
+            stringstream name;
+            name << "Image_" << config.pixels << "x" << config.pixels << "_R" << range << suffix;
+            config.name = name.str();
+            for (unsigned int k = 0; k < config.name.size(); k++)
+            {
+                if (config.name[k] == '.') config.name[k] = 'p';
+            }
+        }
+        configs.push_back(config);
+    }
+    return true;
+}
+
+// Constructor
+ImageSet::ImageSet(const vector<ImageConfig> &configs)
+    : fConfigs(configs), fImages(configs.size()), fCodecs(configs.size(), (ImageCodec *) 0)
+{
+    for (unsigned int c = 0; c < fConfigs.size(); c++)
+    {
+        fImages[c].assign(fConfigs[c].pixels * fConfigs[c].pixels, -999.f);
+    }
+}
+
+// Destructor
+ImageSet::~ImageSet()
+{
+    for (unsigned int c = 0; c < fCodecs.size(); c++) delete fCodecs[c];
+}
+
+void ImageSet::DeclareBranches(TTree *tree, ImageCodec::Encoding encoding)
+{
+    for (unsigned int c = 0; c < fConfigs.size(); c++)
+    {
+        int size = fImages[c].size();
+        stringstream length;
+        length << size;
+
+        if (encoding == ImageCodec::Float32)
+        {
+            string leaves = fConfigs[c].name + "[" + length.str() + "]/F";
+            tree->Branch(fConfigs[c].name.c_str(), &fImages[c][0], leaves.c_str());
+        }
+        else
+        {
+            delete fCodecs[c];
+            fCodecs[c] = new ImageCodec(encoding, size);
+            fCodecs[c]->DeclareBranches(tree, fConfigs[c].name, length.str());
+        }
+    }
+}
+
+void ImageSet::Reset()
+{
+    for (unsigned int c = 0; c < fImages.size(); c++)
+    {
+        fImages[c].assign(fImages[c].size(), -999.f);
+    }
+}
+
+void ImageSet::Fill(const vector<double> &x, const vector<double> &y,
+    const vector<double> &energy, double pc_x, double pc_y)
+{
+    int n = x.size();
+    for (unsigned int c = 0; c < fImages.size(); c++)
+    {
+        fImages[c].assign(fImages[c].size(), 0.f);
+    }
+
+    // the principal axis turned to -phi, for all the rotated images
+    bool any_rotate = false;
+    for (unsigned int c = 0; c < fConfigs.size(); c++) any_rotate |= fConfigs[c].rotate;
+    if (any_rotate)
+    {
+        double alpha = -0.5 * M_PI - atan2(pc_y, pc_x);
+        double cosa = cos(alpha);
+        double sina = sin(alpha);
+        fRotX.resize(n);
+        fRotY.resize(n);
+        for (int i = 0; i < n; i++)
+        {
+            fRotX[i] = cosa * x[i] - sina * y[i];
+            fRotY[i] = sina * x[i] + cosa * y[i];
+        }
+    }
+
+    // mirror in eta when the -eta half has more energy, with and without
+    // the rotation
+    double left = 0, right = 0, left_rot = 0, right_rot = 0;
+    for (int i = 0; i < n; i++)
+    {
+        if (x[i] < 0) left += energy[i];
+        else if (x[i] > 0) right += energy[i];
+        if (any_rotate)
+        {
+            if (fRotX[i] < 0) left_rot += energy[i];
+            else if (fRotX[i] > 0) right_rot += energy[i];
+        }
+    }
+    bool mirror = left > right;
+    bool mirror_rot = left_rot > right_rot;
+
+    // one pass over the constituents, each filling every image; the cells
+    // as TH2F::Fill finds and sums them
+    for (int i = 0; i < n; i++)
+    {
+        float e = (float) energy[i];
+        for (unsigned int c = 0; c < fConfigs.size(); c++)
+        {
+            const ImageConfig &config = fConfigs[c];
+            double px = config.rotate ? fRotX[i] : x[i];
+            double py = config.rotate ? fRotY[i] : y[i];
+            if (config.flip && (config.rotate ? mirror_rot : mirror)) px = -px;
+
+            double r = config.range;
+            if (px < -r || !(px < r) || py < -r || !(py < r)) continue;
+            int ix = int(config.pixels * (px + r) / (r + r));
+            int iy = int(config.pixels * (py + r) / (r + r));
+            if (ix >= config.pixels || iy >= config.pixels) continue;
+            fImages[c][ix * config.pixels + iy] += e;
+        }
+    }
+
+    for (unsigned int c = 0; c < fConfigs.size(); c++)
+    {
+        if (!fConfigs[c].normalize) continue;
+        double norm = 0;
+        for (unsigned int k = 0; k < fImages[c].size(); k++) norm += (double) fImages[c][k] * fImages[c][k];
+        if (norm <= 0) continue;
+        norm = sqrt(norm);
+        for (unsigned int k = 0; k < fImages[c].size(); k++) fImages[c][k] = (float) (fImages[c][k] / norm);
+    }
+}
+
+void ImageSet::Encode()
+{
+    for (unsigned int c = 0; c < fCodecs.size(); c++)
+    {
+        if (fCodecs[c]) fCodecs[c]->Encode(&fImages[c][0]);
+    }
+}
+
+void ImageSet::SetImage(int i, const float *image)
+{
+    fImages[i].assign(image, image + fImages[i].size());
+}
+
+void ImageSet::PrincipalAxis(const vector<double> &x, const vector<double> &y,
+    const vector<double> &energy, double &pc_x, double &pc_y)
+{
+    int n = x.size();
+    double xbar = 0.;
+    double ybar = 0.;
+    double x2bar = 0.;
+    double y2bar = 0.;
+    double xybar = 0.;
+    double sumE = 0.;
+
+    for (int i = 0; i < n; i++)
+    {
+        sumE += energy[i];
+        xbar += x[i] * energy[i];
+        ybar += y[i] * energy[i];
+    }
+
+    double mux = xbar / sumE;
+    double muy = ybar / sumE;
+
+    xbar = 0.;
+    ybar = 0.;
+    sumE = 0.;
+
+    for (int i = 0; i < n; i++)
+    {
+        double dx = x[i] - mux;
+        double dy = y[i] - muy;
+        double E = energy[i];
+        sumE += E;
+        xbar += dx * E;
+        ybar += dy * E;
+        x2bar += dx * dx * E;
+        y2bar += dy * dy * E;
+        xybar += dx * dy * E;
+    }
+
+    double sigmax2 = x2bar / sumE - mux * mux;
+    double sigmay2 = y2bar / sumE - muy * muy;
+    double sigmaxy = xybar / sumE - mux * muy;
+    double lamb_min = 0.5 * (sigmax2 + sigmay2 - sqrt((sigmax2 - sigmay2) * (sigmax2 - sigmay2) + 4 * sigmaxy * sigmaxy));
+
+    pc_x = sigmax2 + sigmaxy - lamb_min;
+    pc_y = sigmay2 + sigmaxy - lamb_min;
+
+    // only defined up to a sign: away from the side with the most energy
+    double Eup = 0.;
+    double Edn = 0.;
+    for (int i = 0; i < n; i++)
+    {
+        double dotprod = pc_x * (x[i] - mux) + pc_y * (y[i] - muy);
+        if (dotprod > 0) Eup += energy[i];
+        else Edn += energy[i];
+    }
+
+    if (Edn < Eup)
+    {
+        pc_x = -pc_x;
+        pc_y = -pc_y;
+    }
+}
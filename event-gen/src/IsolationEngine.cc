@@ -0,0 +1,265 @@
+#include <math.h>
+#include <stdint.h>
+#include <vector>
+#include <algorithm>
+
+#include "fastjet/PseudoJet.hh"
+
+#include "Pythia8/Pythia.h"
+
+#include "IsolationEngine.h"
+
+using namespace std;
+using fastjet::PseudoJet;
+
+// slack on the bounds, relative for the float rounding of the IsIsolated
+// sum and absolute (in GeV) for the rounding of the prefix sum differences;
+// within it the particles are summed exactly instead
+static const double isolation_bound_slack = 1e-3;
+static const double isolation_bound_abs_slack = 1e-6;
+
+// Constructor
+IsolationEngine::IsolationEngine(double cellsize)
+    : fCellSize(cellsize), fRapMin(0), fNRap(0), fEvent(0)
+{
+    fNPhi = (int) (2. * M_PI / cellsize);
+    if (fNPhi < 1) fNPhi = 1;
+    fPhiWidth = 2. * M_PI / fNPhi;
+}
+
+void IsolationEngine::Fill(const Pythia8::Event &event)
+{
+    fEvent = &event;
+    fSlot.assign(event.size(), -1);
+
+    // the particles IsIsolated sums over, in event order
+    vector<double> rap, phi, pt;
+    vector<int> entry;
+    for (int ip = 0; ip < event.size(); ++ip)
+    {
+        if (!event[ip].isFinal())        continue;
+        if (fabs(event[ip].id())  == 12) continue;
+        if (fabs(event[ip].id())  == 14) continue;
+        if (fabs(event[ip].id())  == 16) continue;
+        if (event[ip].pT()        < 0.5) continue;
+
+        PseudoJet p(event[ip].px(), event[ip].py(), event[ip].pz(), event[ip].e());
+        rap.push_back(p.rap());
+        phi.push_back(p.phi());
+        pt.push_back(p.pt());
+        entry.push_back(ip);
+    }
+
+    unsigned int n = entry.size();
+    double rap_max = 0;
+    for (unsigned int i = 0; i < n; i++)
+    {
+        if (i == 0 || rap[i] < fRapMin) fRapMin = rap[i];
+        if (i == 0 || rap[i] > rap_max) rap_max = rap[i];
+    }
+    fNRap = n > 0 ? (int) ((rap_max - fRapMin) / fCellSize) + 1 : 0;
+
+    // counting sort by cell, which keeps event order within a cell
+    fStart.assign(fNRap * fNPhi + 1, 0);
+    vector<int> cell(n);
+    for (unsigned int i = 0; i < n; i++)
+    {
+        cell[i] = RapBin(rap[i]) * fNPhi + PhiBin(phi[i]);
+        fStart[cell[i] + 1]++;
+    }
+    for (unsigned int c = 0; c + 1 < fStart.size(); c++)
+    {
+        fStart[c + 1] += fStart[c];
+    }
+
+    fRap.resize(n);
+    fPhi.resize(n);
+    fPt.resize(n);
+    fEntry.resize(n);
+    vector<int> next(fStart.begin(), fStart.end() - 1);
+    for (unsigned int i = 0; i < n; i++)
+    {
+        int slot = next[cell[i]]++;
+        fRap[slot] = rap[i];
+        fPhi[slot] = phi[i];
+        fPt[slot] = pt[i];
+        fEntry[slot] = entry[i];
+        fSlot[entry[i]] = slot;
+    }
+
+    fRowPrefix.assign(fNRap * (fNPhi + 1), 0.);
+    for (int r = 0; r < fNRap; r++)
+    {
+        double *prefix = &fRowPrefix[r * (fNPhi + 1)];
+        for (int k = 0; k < fNPhi; k++)
+        {
+            int c = r * fNPhi + k;
+            double sum = 0;
+            for (int s = fStart[c]; s < fStart[c + 1]; s++) sum += fPt[s];
+            prefix[k + 1] = prefix[k] + sum;
+        }
+    }
+}
+
+int IsolationEngine::RapBin(double rap) const
+{
+    int bin = (int) floor((rap - fRapMin) / fCellSize);
+    if (bin < 0) return 0;
+    if (bin >= fNRap) return fNRap - 1;
+    return bin;
+}
+
+int IsolationEngine::PhiBin(double phi) const
+{
+    int bin = (int) floor(phi / fPhiWidth);
+    if (bin < 0) return 0;
+    if (bin >= fNPhi) return fNPhi - 1;
+    return bin;
+}
+
+// pT in phi cells lo..hi of row r, where lo and hi may run past either end
+double IsolationEngine::RowSum(int r, int lo, int hi) const
+{
+    if (hi < lo) return 0.;
+    const double *prefix = &fRowPrefix[r * (fNPhi + 1)];
+    if (hi - lo + 1 >= fNPhi) return prefix[fNPhi];
+
+    lo = ((lo % fNPhi) + fNPhi) % fNPhi;
+    hi = ((hi % fNPhi) + fNPhi) % fNPhi;
+    if (lo <= hi) return prefix[hi + 1] - prefix[lo];
+    return (prefix[fNPhi] - prefix[lo]) + prefix[hi + 1];
+}
+
+IsolationEngine::Query IsolationEngine::MakeQuery(const Pythia8::Particle *particle, float conesize) const
+{
+    PseudoJet part(particle->px(), particle->py(), particle->pz(), particle->e());
+
+    Query q;
+    q.rap = part.rap();
+    q.phi = part.phi();
+    q.pt = part.pt();
+    q.cone = conesize;
+
+    // IsIsolated skips the particle itself by address
+    q.self = -1;
+    if (fEvent && fEvent->size() > 0)
+    {
+        // compared as addresses, as particle need not point into the record
+        uintptr_t first = (uintptr_t) &(*fEvent)[0];
+        uintptr_t address = (uintptr_t) particle;
+        if (address >= first && (address - first) % sizeof(Pythia8::Particle) == 0)
+        {
+            uintptr_t entry = (address - first) / sizeof(Pythia8::Particle);
+            if (entry < (uintptr_t) fEvent->size() && &(*fEvent)[entry] == particle)
+                q.self = fSlot[entry];
+        }
+    }
+    return q;
+}
+
+void IsolationEngine::Bounds(const Query &q, double &lower, double &upper) const
+{
+    lower = 0.;
+    upper = 0.;
+    if (fNRap == 0) return;
+
+    int row_lo = RapBin(q.rap - q.cone);
+    int row_hi = RapBin(q.rap + q.cone);
+    int phi_lo = (int) floor((q.phi - q.cone) / fPhiWidth);
+    int phi_hi = (int) floor((q.phi + q.cone) / fPhiWidth);
+
+    for (int r = row_lo; r <= row_hi; r++)
+    {
+        upper += RowSum(r, phi_lo, phi_hi);
+
+        // cells of this row entirely within the cone
+        double a = fRapMin + r * fCellSize - 1e-9;
+        double b = fRapMin + (r + 1) * fCellSize + 1e-9;
+        double drap = max(fabs(a - q.rap), fabs(b - q.rap));
+        double left = q.cone * q.cone - drap * drap;
+        if (left <= 0) continue;
+        double dphi = sqrt(left) * (1. - 1e-9);
+        if (dphi >= M_PI)
+        {
+            lower += RowSum(r, 0, fNPhi - 1);
+            continue;
+        }
+        int in_lo = (int) ceil((q.phi - dphi) / fPhiWidth);
+        int in_hi = (int) floor((q.phi + dphi) / fPhiWidth) - 1;
+        lower += RowSum(r, in_lo, in_hi);
+    }
+
+    if (q.self >= 0)
+    {
+        upper -= fPt[q.self];
+        lower -= fPt[q.self];
+    }
+    if (upper < 0) upper = 0;
+}
+
+// The IsIsolated sum: same particles, same order, same precision
+float IsolationEngine::ExactSum(const Query &q) const
+{
+    float sumpT = 0;
+    if (fNRap == 0) return sumpT;
+
+    int row_lo = RapBin(q.rap - q.cone);
+    int row_hi = RapBin(q.rap + q.cone);
+    int phi_lo = (int) floor((q.phi - q.cone) / fPhiWidth);
+    int phi_hi = (int) floor((q.phi + q.cone) / fPhiWidth);
+    if (phi_hi - phi_lo + 1 >= fNPhi)
+    {
+        phi_lo = 0;
+        phi_hi = fNPhi - 1;
+    }
+
+    vector<pair<int, int> > inside;  // (event entry, slot)
+    for (int r = row_lo; r <= row_hi; r++)
+    {
+        for (int k = phi_lo; k <= phi_hi; k++)
+        {
+            int c = r * fNPhi + ((k % fNPhi) + fNPhi) % fNPhi;
+            for (int s = fStart[c]; s < fStart[c + 1]; s++)
+            {
+                if (s == q.self) continue;
+                // same arithmetic as PseudoJet::delta_R
+                double dphi = fabs(fPhi[s] - q.phi);
+                if (dphi > M_PI) dphi = 2. * M_PI - dphi;
+                double drap = fRap[s] - q.rap;
+                if (sqrt(dphi * dphi + drap * drap) > q.cone) continue;
+                inside.push_back(make_pair(fEntry[s], s));
+            }
+        }
+    }
+
+    sort(inside.begin(), inside.end());
+    for (unsigned int i = 0; i < inside.size(); i++)
+    {
+        sumpT += fPt[inside[i].second];
+    }
+    return sumpT;
+}
+
+float IsolationEngine::ConeSum(const Pythia8::Particle *particle, float conesize) const
+{
+    return ExactSum(MakeQuery(particle, conesize));
+}
+
+bool IsolationEngine::IsIsolated(const Pythia8::Particle *particle, float rel_iso, float conesize) const
+{
+    Query q = MakeQuery(particle, conesize);
+
+    if (q.pt > 0)
+    {
+        double lower, upper;
+        Bounds(q, lower, upper);
+        upper = upper * (1. + isolation_bound_slack) + isolation_bound_abs_slack;
+        lower = lower * (1. - isolation_bound_slack) - isolation_bound_abs_slack;
+        if (upper / q.pt < rel_iso) return true;
+        if (lower / q.pt > rel_iso) return false;
+    }
+
+    float sumpT = ExactSum(q);
+    if (sumpT / q.pt > rel_iso) return false;
+    else return true;
+}
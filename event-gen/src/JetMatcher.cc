@@ -0,0 +1,170 @@
+#include <vector>
+#include <algorithm>
+
+#include "fastjet/PseudoJet.hh"
+
+#include "JetMatcher.h"
+#include "EtaPhiLookup.h"
+
+using namespace std;
+using fastjet::PseudoJet;
+
+// Constructor
+JetMatcher::JetMatcher(double maxR, Mode mode)
+    : fMaxR(maxR), fMode(mode), fLookup(maxR), fNJets(0), fNTruths(0)
+{
+}
+
+void JetMatcher::Match(const vector<PseudoJet> &jets, const vector<PseudoJet> &truths,
+    vector<int> &jet_match)
+{
+    FindPairs(jets, truths);
+
+    jet_match.assign(fNJets, -1);
+    fMatchDeltaR.assign(fNJets, -1.);
+    fTruthMatch.assign(fNTruths, -1);
+
+    if (fMode == ClosestTruth)  MatchClosest(jet_match);
+    else if (fMode == Greedy)   MatchGreedy(jet_match);
+    else                        MatchOptimal(jet_match);
+}
+
+void JetMatcher::FindPairs(const vector<PseudoJet> &jets, const vector<PseudoJet> &truths)
+{
+    fNJets = jets.size();
+    fNTruths = truths.size();
+    fPairs.clear();
+    if (fNJets == 0 || fNTruths == 0) return;
+
+    fLookup.Fill(truths);
+
+    vector<int> found;
+    for (int i = 0; i < fNJets; i++)
+    {
+        found.clear();
+        fLookup.Within(jets[i], fMaxR, found);
+        for (unsigned int k = 0; k < found.size(); k++)
+        {
+            Pair pair;
+            pair.dR = jets[i].delta_R(truths[found[k]]);
+            pair.jet = i;
+            pair.truth = found[k];
+            fPairs.push_back(pair);
+        }
+    }
+    sort(fPairs.begin(), fPairs.end());
+}
+
+void JetMatcher::MatchClosest(vector<int> &jet_match)
+{
+    // the first pair of each jet and of each truth object is its closest
+    for (unsigned int k = 0; k < fPairs.size(); k++)
+    {
+        const Pair &pair = fPairs[k];
+        if (jet_match[pair.jet] < 0)
+        {
+            jet_match[pair.jet] = pair.truth;
+            fMatchDeltaR[pair.jet] = pair.dR;
+            if (fTruthMatch[pair.truth] < 0) fTruthMatch[pair.truth] = pair.jet;
+        }
+    }
+}
+
+void JetMatcher::MatchGreedy(vector<int> &jet_match)
+{
+    for (unsigned int k = 0; k < fPairs.size(); k++)
+    {
+        const Pair &pair = fPairs[k];
+        if (jet_match[pair.jet] >= 0 || fTruthMatch[pair.truth] >= 0) continue;
+        jet_match[pair.jet] = pair.truth;
+        fTruthMatch[pair.truth] = pair.jet;
+        fMatchDeltaR[pair.jet] = pair.dR;
+    }
+}
+
+// Hungarian algorithm on the rows (the smaller of the two sets) against the
+// columns.  Pairs beyond maxR cost more than any maxR-allowed assignment of
+// all rows can, so the number of allowed pairs is maximized first.
+void JetMatcher::MatchOptimal(vector<int> &jet_match)
+{
+    if (fPairs.empty()) return;
+
+    bool jets_are_rows = fNJets <= fNTruths;
+    int n = jets_are_rows ? fNJets : fNTruths;
+    int m = jets_are_rows ? fNTruths : fNJets;
+
+    double forbidden = (n + 1) * fMaxR + 1.;
+    vector<double> cost((n + 1) * (m + 1), forbidden);
+    for (unsigned int k = 0; k < fPairs.size(); k++)
+    {
+        int row = (jets_are_rows ? fPairs[k].jet : fPairs[k].truth) + 1;
+        int col = (jets_are_rows ? fPairs[k].truth : fPairs[k].jet) + 1;
+        cost[row * (m + 1) + col] = fPairs[k].dR;
+    }
+
+    // rows and columns are 1-based, 0 is the free column
+    const double inf = 1e300;
+    vector<double> u(n + 1, 0.), v(m + 1, 0.);
+    vector<int> p(m + 1, 0), way(m + 1, 0);
+    for (int i = 1; i <= n; i++)
+    {
+        p[0] = i;
+        int j0 = 0;
+        vector<double> minv(m + 1, inf);
+        vector<char> used(m + 1, 0);
+        do
+        {
+            used[j0] = 1;
+            int i0 = p[j0];
+            double delta = inf;
+            int j1 = 0;
+            for (int j = 1; j <= m; j++)
+            {
+                if (used[j]) continue;
+                double cur = cost[i0 * (m + 1) + j] - u[i0] - v[j];
+                if (cur < minv[j])
+                {
+                    minv[j] = cur;
+                    way[j] = j0;
+                }
+                if (minv[j] < delta)
+                {
+                    delta = minv[j];
+                    j1 = j;
+                }
+            }
+            for (int j = 0; j <= m; j++)
+            {
+                if (used[j])
+                {
+                    u[p[j]] += delta;
+                    v[j] -= delta;
+                }
+                else
+                {
+                    minv[j] -= delta;
+                }
+            }
+            j0 = j1;
+        } while (p[j0] != 0);
+
+        do
+        {
+            int j1 = way[j0];
+            p[j0] = p[j1];
+            j0 = j1;
+        } while (j0);
+    }
+
+    for (int j = 1; j <= m; j++)
+    {
+        if (p[j] == 0) continue;
+        double dR = cost[p[j] * (m + 1) + j];
+        if (dR >= forbidden) continue;
+        int jet = (jets_are_rows ? p[j] : j) - 1;
+        int truth = (jets_are_rows ? j : p[j]) - 1;
+        jet_match[jet] = truth;
+        fTruthMatch[truth] = jet;
+        fMatchDeltaR[jet] = dR;
+    }
+}
@@ -0,0 +1,65 @@
+#include <vector>
+
+#include "fastjet/PseudoJet.hh"
+
+#include "JetView.h"
+#include "myFastJetBase.h"
+
+using namespace std;
+using fastjet::PseudoJet;
+
+// Constructors
+JetView::JetView()
+    : fJetPt(0), fJetRap(0), fJetPhi(0)
+{
+}
+
+JetView::JetView(const PseudoJet &jet, const ParticleInfoTable *info)
+{
+    Reset(jet, info);
+}
+
+void JetView::Reset(const PseudoJet &jet, const ParticleInfoTable *info)
+{
+    fJet = jet;
+    fJetPt = jet.pt();
+    fJetRap = jet.rap();
+    fJetPhi = jet.phi();
+
+    if (jet.has_constituents())
+        fConstituents = jet.constituents();
+    else
+        fConstituents.clear();
+    unsigned int n = fConstituents.size();
+
+    fPt.resize(n);
+    fRap.resize(n);
+    fPhi.resize(n);
+    fE.resize(n);
+    fCharge.resize(n);
+    fPdgId.resize(n);
+    for (unsigned int i = 0; i < n; i++)
+    {
+        const PseudoJet &c = fConstituents[i];
+        fPt[i] = c.pt();
+        fRap[i] = c.rap();
+        fPhi[i] = c.phi();
+        fE[i] = c.e();
+
+        if (info)
+        {
+            fCharge[i] = info->charge(c);
+            fPdgId[i] = info->pdg_id(c);
+        }
+        else if (c.has_user_info<MyUserInfo>())
+        {
+            fCharge[i] = c.user_info<MyUserInfo>().charge();
+            fPdgId[i] = c.user_info<MyUserInfo>().pdg_id();
+        }
+        else
+        {
+            fCharge[i] = 0.;
+            fPdgId[i] = 0;
+        }
+    }
+}
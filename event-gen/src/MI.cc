@@ -70,6 +70,14 @@ int main(int argc, const char* argv[])
     float  image_range = 1.0;
     int    proc        = 1;
     int    seed        = -1;
+    string profileName = "default";
+    int    writerBuffers = 16;
+    string streamPath    = "";
+    int    streamSlots   = 256;
+    float  streamTimeout = 300;
+    string encodingName  = "float32";
+    string imagesSpec    = "";
+    int    constituentLevel = 0;
 
     optionparser::parser parser("Allowed options");
 
@@ -84,6 +92,14 @@ int main(int argc, const char* argv[])
     parser.add_option("--pThatMin").mode(optionparser::store_value).default_value(100).help("pThatMin for QCD");
     parser.add_option("--pThatMax").mode(optionparser::store_value).default_value(500).help("pThatMax for QCD");
     parser.add_option("--BosonMass").mode(optionparser::store_value).default_value(800).help("Z' or W' mass in GeV");
+    parser.add_option("--OutputProfile").mode(optionparser::store_value).default_value("default").help("EventTree output profile: default, fast-write, archival, archival-lzma or read-optimized");
+    parser.add_option("--WriterBuffers").mode(optionparser::store_value).default_value(16).help("Events buffered for the output writer thread (0: write from the event loop)");
+    parser.add_option("--Stream").mode(optionparser::store_value).default_value("").help("Stream the records to a consumer through this shared ring file (e.g. /dev/shm/jets) instead of writing OutFile");
+    parser.add_option("--StreamSlots").mode(optionparser::store_value).default_value(256).help("Records in the stream ring");
+    parser.add_option("--StreamTimeout").mode(optionparser::store_value).default_value(300).help("Seconds to wait for the stream consumer to free a slot before stopping (0: no limit)");
+    parser.add_option("--ImageEncoding").mode(optionparser::store_value).default_value("float32").help("Storage of the image: float32, float16, log-uint16 or uint8");
+    parser.add_option("--Images").mode(optionparser::store_value).default_value("").help("More images of the leading jet, comma separated [name=]pixels:range[:rotate+flip+normalize], e.g. 40:1.2,37:1.5:rotate+flip");
+    parser.add_option("--Constituents").mode(optionparser::store_value).default_value(0).help("Constituents of the leading jet in the output: 0 none, 1 the calorimeter cells of the image, 2 also the particles with pdg id and charge");
 
     parser.eat_arguments(argc, argv);
 
@@ -98,6 +114,33 @@ int main(int argc, const char* argv[])
     pThatmin = parser.get_value<float>("pThatMin");
     pThatmax = parser.get_value<float>("pThatMax");
     boson_mass = parser.get_value<float>("BosonMass");
+    profileName = parser.get_value<string>("OutputProfile");
+    writerBuffers = parser.get_value<int>("WriterBuffers");
+    streamPath = parser.get_value<string>("Stream");
+    streamSlots = parser.get_value<int>("StreamSlots");
+    streamTimeout = parser.get_value<float>("StreamTimeout");
+    encodingName = parser.get_value<string>("ImageEncoding");
+    imagesSpec = parser.get_value<string>("Images");
+    constituentLevel = parser.get_value<int>("Constituents");
+
+    OutputProfile profile;
+    if (!OutputProfile::Find(profileName, profile))
+    {
+        cerr << "Unknown output profile " << profileName << endl;
+        return 1;
+    }
+    ImageCodec::Encoding encoding;
+    if (!ImageCodec::FromName(encodingName, encoding))
+    {
+        cerr << "Unknown image encoding " << encodingName << endl;
+        return 1;
+    }
+    vector<ImageConfig> images;
+    if (!ImageConfig::Parse(imagesSpec, images))
+    {
+        cerr << "Bad image definitions " << imagesSpec << endl;
+        return 1;
+    }
 
 
     //seed 
@@ -186,7 +229,14 @@ int main(int argc, const char* argv[])
 
     MIAnalysis * analysis = new MIAnalysis(pixels);
     analysis->SetOutName(outName);
-    analysis->Begin();
+    analysis->SetOutputProfile(profile);
+    analysis->SetWriterBuffers(writerBuffers);
+    analysis->SetStream(streamPath, streamSlots, streamTimeout);
+    analysis->SetImageEncoding(encoding);
+    analysis->SetImages(images);
+    analysis->SetConstituents(constituentLevel);
+    analysis->SetSeed(seed + 2);
+    if (!analysis->Begin()) return 1;
     analysis->Debug(fDebug);
 
     std::cout << pileup << " is the number of pileu pevents " << std::endl;
@@ -199,13 +249,15 @@ int main(int argc, const char* argv[])
             std::cout << "Generating event number " << iev << std::endl;
         }
         analysis->AnalyzeEvent(iev, pythia8, pythia_MB, pileup, pixels, image_range);
+        if (!analysis->Good()) break;
     }
 
+    bool good = analysis->Good();
     analysis->End();
 
     // that was it
     delete pythia8;
     delete analysis;
 
-    return 0;
+    return good ? 0 : 1;
 }
@@ -14,6 +14,14 @@
 
 #include "MIAnalysis.h"
 #include "MITools.h"
+#include "SubstructureEngine.h"
+#include "ImageNsubjettiness.h"
+#include "OutputProfile.h"
+#include "AsyncTreeWriter.h"
+#include "RecordStream.h"
+#include "ImageCodec.h"
+#include "ImageSet.h"
+#include "ConstituentArrays.h"
 
 #include "myFastJetBase.h"
 #include "fastjet/ClusterSequence.hh"
@@ -59,7 +67,20 @@ MIAnalysis::MIAnalysis(int imagesize)
     ftest = 0;
     fDebug = false;
     fOutName = "test.root";
+    fWriterBuffers = 0;
+    fWriter = 0;
+    fStreamSlots = 256;
+    fStreamTimeout = 300;
+    fStream = 0;
     tool = new MITools();
+    substructure = new SubstructureEngine();
+    substructure->SetParticleInfo(&fParticleInfo);
+    imagetaus = 0;
+    imagecodec = new ImageCodec(ImageCodec::Float32, MaxN);
+    imageset = 0;
+    constituents = 0;
+    constituents_nopix = 0;
+    image = 0;
 
     //model the detector as a 2D histogram   
     //                         xbins       y bins
@@ -78,7 +99,16 @@ MIAnalysis::MIAnalysis(int imagesize)
 // Destructor 
 MIAnalysis::~MIAnalysis()
 {
+    delete fWriter;
+    delete fStream;
     delete tool;
+    delete substructure;
+    delete imagetaus;
+    delete imagecodec;
+    delete imageset;
+    delete constituents;
+    delete constituents_nopix;
+    delete image;
 
     delete[] fTIntensity;
     // delete[] fTRotatedIntensity;
@@ -87,22 +117,88 @@ MIAnalysis::~MIAnalysis()
 }
 
 // Begin method
-void MIAnalysis::Begin()
+bool MIAnalysis::Begin()
 {
+   if (!fStreamPath.empty())
+   {
+       // the tree only describes the records, nothing is filled into it
+       tF = 0;
+       tT = new TTree("EventTree", "Event Tree for MI");
+       tT->SetDirectory(0);
+       DeclareBranches();
+       ResetBranches();
+
+       fStream = new RecordStream(fStreamPath, fStreamSlots, fStreamTimeout);
+       return fStream->Open(tT);
+   }
+
    // Declare TTree
-   tF = new TFile(fOutName.c_str(), "RECREATE");
+   if (fProfile.algorithm >= 0)
+       tF = new TFile(fOutName.c_str(), "RECREATE", "", fProfile.Compression());
+   else
+       tF = new TFile(fOutName.c_str(), "RECREATE");
    tT = new TTree("EventTree", "Event Tree for MI");
    
    // for shit you want to do by hand
    DeclareBranches();
    ResetBranches();
+
+   // compression, baskets and clusters of the output profile
+   fProfile.ApplyTo(tT, MaxN);
+
+   if (fWriterBuffers > 0)
+   {
+       fWriter = new AsyncTreeWriter(tT, fWriterBuffers);
+       if (!fWriter->Start())
+       {
+           cout << "MIAnalysis::Begin: cannot write the EventTree from a writer thread, filling it directly" << endl;
+           delete fWriter;
+           fWriter = 0;
+       }
+   }
    
-   return;
+   return true;
 }
 
 // End
 void MIAnalysis::End()
 {
+    if (fDebug)
+    {
+        fastjet::contrib::MinimizationStats stats = substructure->TauMinimizationStats();
+        cout << "MIAnalysis::End: " << stats.minimizations << " tau minimizations, "
+             << stats.mean_steps() << " steps on average, " << stats.unconverged << " stopped by the halt" << endl;
+        if (stats.warm_starts > 0)
+            cout << "MIAnalysis::End: " << stats.warm_starts << " warm starts, " << stats.warm_rejected
+                 << " dropped for the standard axes, " << stats.warm_fallbacks << " checked against them" << endl;
+    }
+    if (imagecodec->GetEncoding() != ImageCodec::Float32)
+    {
+        cout << "MIAnalysis::End: images stored as " << ImageCodec::Name(imagecodec->GetEncoding())
+             << ", relative L2 reconstruction error mean " << imagecodec->MeanError()
+             << ", max " << imagecodec->MaxError() << " over " << imagecodec->NImages() << " images" << endl;
+        for (int c = 0; imageset && c < imageset->Size(); c++)
+        {
+            const ImageCodec *codec = imageset->Codec(c);
+            cout << "MIAnalysis::End:   " << imageset->Config(c).name << " error mean " << codec->MeanError()
+                 << ", max " << codec->MaxError() << endl;
+        }
+    }
+    if (fStream)
+    {
+        fStream->Close();
+        if (fDebug) cout << "MIAnalysis::End: waited " << fStream->NWaits() << " times for the stream consumer, "
+                         << fStream->WaitSeconds() << " s" << endl;
+        delete tT;
+        tT = 0;
+        return;
+    }
+    if (fWriter)
+    {
+        fWriter->Stop();
+        if (fDebug) cout << "MIAnalysis::End: the writer thread held up " << fWriter->NStalls()
+                         << " events for " << fWriter->StallSeconds() << " s" << endl;
+    }
     tT->Write();
     tF->Close();
     return;
@@ -128,6 +224,8 @@ void MIAnalysis::AnalyzeEvent(int ievt, Pythia8::Pythia* pythia8, Pythia8::Pythi
     std::vector <fastjet::PseudoJet> particlesForJets_nopixel;
 
     detector->Reset();
+    fParticleInfo.clear();
+    fParticleInfo.reserve(pythia8->event.size());
    
     // Particle loop ----------------------------------------------------------
     for (int ip=0; ip<pythia8->event.size(); ++ip){
@@ -154,6 +252,8 @@ void MIAnalysis::AnalyzeEvent(int ievt, Pythia8::Pythia* pythia8, Pythia8::Pythi
         detector->SetBinContent(ybin, phibin, 
                                 detector->GetBinContent(ybin, phibin) + p.e());
 	fastjet::PseudoJet p_nopix(p.px(),p.py(),p.pz(),p.e());
+	p_nopix.set_user_index(fParticleInfo.add(pythia8->event[ip].id(), ip,
+	    pythia8->event[ip].charge(), false));
 	particlesForJets_nopixel.push_back(p_nopix);
     }  
     // end particle loop -----------------------------------------------  
@@ -232,78 +332,50 @@ void MIAnalysis::AnalyzeEvent(int ievt, Pythia8::Pythia* pythia8, Pythia8::Pythi
       consts_image[i].second = sorted_consts[i].delta_phi_to(subjets[0]); //use delta phi to take care of the dis-continuity in phi
     }
 
+    //Step 1b): keep the constituents themselves (--Constituents), with the
+    //centre of the image, so that images can be made again offline
+    if (constituents)
+    {
+        fTLeadingSubjetEta = subjets[0].eta();
+        fTLeadingSubjetPhi = subjets[0].phi();
+        constituents->Clear();
+        for (int i = 0; i < sorted_consts.size(); i++)
+        {
+            if (!constituents->Add(sorted_consts[i].perp(), sorted_consts[i].eta(),
+                                   sorted_consts[i].phi(), sorted_consts[i].e())) break;
+        }
+    }
+    if (constituents_nopix)
+    {
+        vector<fastjet::PseudoJet> sorted_consts_nopix = sorted_by_pt(leading_jet_nopix.constituents());
+        constituents_nopix->Clear();
+        for (int i = 0; i < sorted_consts_nopix.size(); i++)
+        {
+            const fastjet::PseudoJet &p = sorted_consts_nopix[i];
+            if (!constituents_nopix->Add(p.perp(), p.eta(), p.phi(), p.e(),
+                                         fParticleInfo.pdg_id(p), fParticleInfo.charge(p))) break;
+        }
+    }
+
     //Quickly run PCA for the rotation.
-    double xbar = 0.;
-    double ybar = 0.;
-    double x2bar = 0.;
-    double y2bar = 0.;
-    double xybar = 0.;
-    double n = 0;
-
-    for(int i = 0; i < leading_jet.constituents().size(); i++)
-      {
-        double x = consts_image[i].first;
-        double y = consts_image[i].second;
-	double E = sorted_consts[i].e();
-        n+=E;
-        xbar+=x*E;
-        ybar+=y*E;
-      }
-
-    double mux = xbar / n;
-    double muy = ybar / n;
-
-    xbar = 0.;
-    ybar = 0.;
-    n = 0.;
-
-    for(int i = 0; i < leading_jet.constituents().size(); i++)
-      {
-        double x = consts_image[i].first - mux;
-        double y = consts_image[i].second - muy;
-        double E = sorted_consts[i].e();
-        n+=E;
-        xbar+=x*E;
-        ybar+=y*E;
-        x2bar+=x*x*E;
-        y2bar+=y*y*E;
-        xybar+=x*y*E;
-      }
-
-    double sigmax2 = x2bar / n - mux*mux;
-    double sigmay2 = y2bar / n - muy*muy;
-    double sigmaxy = xybar / n - mux*muy;
-    double lamb_min = 0.5* ( sigmax2 + sigmay2 - sqrt( (sigmax2-sigmay2)*(sigmax2-sigmay2) + 4*sigmaxy*sigmaxy) );
-    double lamb_max = 0.5* ( sigmax2 + sigmay2 + sqrt( (sigmax2-sigmay2)*(sigmax2-sigmay2) + 4*sigmaxy*sigmaxy) );
-
-    double dir_x = sigmax2+sigmaxy-lamb_min;
-    double dir_y = sigmay2+sigmaxy-lamb_min;
-
-    //The first PC is only defined up to a sign.  Let's have it point toward the side of the jet with the most energy.
-
-    double Eup = 0.;
-    double Edn = 0.;
-
-    for(int i = 0; i < leading_jet.constituents().size(); i++)
-      {
-	double x = consts_image[i].first - mux;
-        double y = consts_image[i].second - muy;
-	double E = sorted_consts[i].e();
-	double dotprod = dir_x*x+dir_y*y;
-	if (dotprod > 0) Eup+=E;
-	else Edn+=E;
-      }
-    
-    if (Edn < Eup){
-      dir_x = -dir_x;
-      dir_y = -dir_y;
+    vector<double> image_x(sorted_consts.size());
+    vector<double> image_y(sorted_consts.size());
+    vector<double> image_E(sorted_consts.size());
+    for (int i = 0; i < sorted_consts.size(); i++)
+    {
+        image_x[i] = consts_image[i].first;
+        image_y[i] = consts_image[i].second;
+        image_E[i] = sorted_consts[i].e();
     }
 
+    double dir_x;
+    double dir_y;
+    ImageSet::PrincipalAxis(image_x, image_y, image_E, dir_x, dir_y);
+
     fTPCEta = dir_x;
     fTPCPhi = dir_y;
 
     //Doing a little check to see how often the PC points in the direction of the subleading subjet if it exists.
-    //std::cout << "new event " << 100*(dir_x) << " " << 100*(dir_y) << " " << leading_jet.m() << " " << leading_jet.perp() << " " << sigmax2*100 << " " << sigmay2*100 << " " << sigmaxy*100 << " " << 100*lamb_min << " " << 100*lamb_max << " " << 100*(sigmax2+sigmaxy-lamb_max) << " " << 100*(sigmay2+sigmaxy-lamb_max) << std::endl; 
     //for (int i=0; i<leading_jet.pieces().size(); i++){
     //  std::cout << i << " " << (leading_jet.pieces()[i].eta() - subjets[0].eta())*100 << " " << leading_jet.pieces()[i].delta_phi_to(subjets[0])*100 << " " << leading_jet.pieces()[i].e() << std::endl; 
     //}
@@ -318,14 +390,27 @@ void MIAnalysis::AnalyzeEvent(int ievt, Pythia8::Pythia* pythia8, Pythia8::Pythi
 
     //Step 2: Fill in the unrotated image
     //-------------------------------------------------------------------------   
-    TH2F* orig_im = new TH2F("", "", pixels, -range, range, pixels, -range, range);
+    if (!image || image->GetNbinsX() != pixels || image->GetXaxis()->GetXmax() != range)
+    {
+        delete image;
+        bool add_directory = TH1::AddDirectoryStatus();
+        TH1::AddDirectory(kFALSE);
+        image = new TH2F("", "", pixels, -range, range, pixels, -range, range);
+        TH1::AddDirectory(add_directory);
+    }
+    image->Reset();
 
     for (int i = 0; i < sorted_consts.size(); i++)
     {
-        orig_im->Fill(consts_image[i].first,consts_image[i].second,sorted_consts[i].e());
+        image->Fill(consts_image[i].first,consts_image[i].second,sorted_consts[i].e());
       //std::cout << i << "       " << consts_image[i].first  << " " << consts_image[i].second << std::endl;  
     }
 
+    //Step 2a): the other images of --Images, all from this pass over the
+    //constituents
+    //-------------------------------------------------------------------------
+    if (imageset) imageset->Fill(image_x, image_y, image_E, dir_x, dir_y);
+
     //Step 2b): fill in the density
     //-------------------------------------------------------------------------
     // double Rlocal = 0.5;
@@ -407,12 +492,12 @@ void MIAnalysis::AnalyzeEvent(int ievt, Pythia8::Pythia* pythia8, Pythia8::Pythi
     //Step 5: Dump the images in the tree!
     //-------------------------------------------------------------------------
     int counter=0;
-    for (int i=1; i<=orig_im->GetNbinsX(); i++)
+    for (int i=1; i<=image->GetNbinsX(); i++)
     {
-        for (int j=1; j<=orig_im->GetNbinsY(); j++)
+        for (int j=1; j<=image->GetNbinsY(); j++)
         {
             // fTRotatedIntensity[counter] = rotatedimage->GetBinContent(i,j);
-            fTIntensity[counter] = orig_im->GetBinContent(i,j);
+            fTIntensity[counter] = image->GetBinContent(i,j);
             // fTLocalDensity[counter] = localdensity->GetBinContent(i, j);
             // fTGlobalDensity[counter] = globaldensity->GetBinContent(i, j);
 
@@ -420,30 +505,63 @@ void MIAnalysis::AnalyzeEvent(int ievt, Pythia8::Pythia* pythia8, Pythia8::Pythi
         }
     }
 
-    // Step 6: Fill in nsubjettiness (new)
+    // Step 6: Fill in nsubjettiness and the other substructure observables
     //----------------------------------------------------------------------------
-    OnePass_WTA_KT_Axes axis_spec;
-    NormalizedMeasure parameters(1.0, 1.0);
-
-    // NormalizedMeasure parameters(1.0, 1.0);
-    Nsubjettiness subjettiness_1(1, axis_spec, parameters);
-    Nsubjettiness subjettiness_2(2, axis_spec, parameters);
-    Nsubjettiness subjettiness_3(3, axis_spec, parameters);
-
-    fTTau1 = (float) subjettiness_1.result(leading_jet);
-    fTTau2 = (float) subjettiness_2.result(leading_jet);
-    fTTau3 = (float) subjettiness_3.result(leading_jet);
+    // One pass over the constituents of each jet for tau_1..3 (one-pass WTA kT
+    // axes; the pixelized result is passed as the seed of the _nopix one, which
+    // only matters with SubstructureConfig::tau_warm_start), the energy
+    // correlation functions and the jet charge.
+    // The calorimeter cells carry no charge, so the jet charge is only kept for
+    // the _nopix jet.
+    SubstructureResult sub;
+    SubstructureResult sub_nopix;
+    substructure->Compute(leading_jet, sub);
+    substructure->Compute(leading_jet_nopix, sub_nopix, &sub);
+
+    fTTau1 = (float) sub.taus[0];
+    fTTau2 = (float) sub.taus[1];
+    fTTau3 = (float) sub.taus[2];
 
     fTTau32 = (abs(fTTau2) < 1e-4 ? -10 : fTTau3 / fTTau2);
     fTTau21 = (abs(fTTau1) < 1e-4 ? -10 : fTTau2 / fTTau1);
 
-    fTTau1_nopix = (float) subjettiness_1.result(leading_jet_nopix);
-    fTTau2_nopix = (float) subjettiness_2.result(leading_jet_nopix);
-    fTTau3_nopix = (float) subjettiness_3.result(leading_jet_nopix);
+    fTTau1_nopix = (float) sub_nopix.taus[0];
+    fTTau2_nopix = (float) sub_nopix.taus[1];
+    fTTau3_nopix = (float) sub_nopix.taus[2];
 
     fTTau32_nopix = (abs(fTTau2_nopix) < 1e-4 ? -10 : fTTau3_nopix / fTTau2_nopix);
     fTTau21_nopix = (abs(fTTau1_nopix) < 1e-4 ? -10 : fTTau2_nopix / fTTau1_nopix);
 
+    fTC2 = (float) sub.C2;
+    fTD2 = (float) sub.D2;
+    fTC2_nopix = (float) sub_nopix.C2;
+    fTD2_nopix = (float) sub_nopix.D2;
+
+    fTJetCharge_nopix = (float) sub_nopix.charges[0];
+
+    // Step 6b: tau_1..3 of the image itself, from the filled cells of the
+    // grid (the cell energy is the weight), so the cost does not grow with
+    // the number of constituents
+    //----------------------------------------------------------------------------
+    if (!imagetaus || imagetaus->Pixels() != pixels || imagetaus->Range() != range)
+    {
+        delete imagetaus;
+        imagetaus = new ImageNsubjettiness(pixels, range);
+    }
+    vector<int> image_Ns;
+    image_Ns.push_back(1);
+    image_Ns.push_back(2);
+    image_Ns.push_back(3);
+    vector<double> image_taus;
+    imagetaus->Taus(image_Ns, fTIntensity, image_taus);
+
+    fTTau1_image = (float) image_taus[0];
+    fTTau2_image = (float) image_taus[1];
+    fTTau3_image = (float) image_taus[2];
+
+    fTTau32_image = (abs(fTTau2_image) < 1e-4 ? -10 : fTTau3_image / fTTau2_image);
+    fTTau21_image = (abs(fTTau1_image) < 1e-4 ? -10 : fTTau2_image / fTTau1_image);
+
     // // Step 7: Fill in nsubjettiness (old)
     // //----------------------------------------------------------------------------
     // OnePass_KT_Axes axis_spec_old;
@@ -460,7 +578,12 @@ void MIAnalysis::AnalyzeEvent(int ievt, Pythia8::Pythia* pythia8, Pythia8::Pythi
     // fTTau32old = (abs(fTTau2) < 1e-4 ? -10 : fTTau3 / fTTau2);
     // fTTau21old = (abs(fTTau1) < 1e-4 ? -10 : fTTau2 / fTTau1);
 
-    tT->Fill();
+    imagecodec->Encode(fTIntensity);
+    if (imageset) imageset->Encode();
+
+    if (fStream) fStream->Write();
+    else if (fWriter) fWriter->Fill();
+    else tT->Fill();
 
     return;
 }
@@ -472,7 +595,19 @@ void MIAnalysis::DeclareBranches()
     // Event Properties 
     tT->Branch("NFilled", &fTNFilled, "NFilled/I");
 
-    tT->Branch("Intensity", *&fTIntensity, "Intensity[NFilled]/F");
+    if (imagecodec->GetEncoding() == ImageCodec::Float32)
+        tT->Branch("Intensity", *&fTIntensity, "Intensity[NFilled]/F");
+    else
+        imagecodec->DeclareBranches(tT);
+    if (imageset) imageset->DeclareBranches(tT, imagecodec->GetEncoding());
+
+    if (constituents)
+    {
+        tT->Branch("LeadingSubjetEta", &fTLeadingSubjetEta, "LeadingSubjetEta/F");
+        tT->Branch("LeadingSubjetPhi", &fTLeadingSubjetPhi, "LeadingSubjetPhi/F");
+        constituents->DeclareBranches(tT);
+    }
+    if (constituents_nopix) constituents_nopix->DeclareBranches(tT, "_nopix");
 
     // tT->Branch("LocalDensity", *&fTLocalDensity, "LocalDensity[NFilled]/F");
     // tT->Branch("GlobalDensity", *&fTGlobalDensity, "GlobalDensity[NFilled]/F");
@@ -512,6 +647,19 @@ void MIAnalysis::DeclareBranches()
     
     tT->Branch("Tau32_nopix", &fTTau32_nopix, "Tau32_nopix/F");
     tT->Branch("Tau21_nopix", &fTTau21_nopix, "Tau21_nopix/F");
+
+    tT->Branch("Tau1_image", &fTTau1_image, "Tau1_image/F");
+    tT->Branch("Tau2_image", &fTTau2_image, "Tau2_image/F");
+    tT->Branch("Tau3_image", &fTTau3_image, "Tau3_image/F");
+    tT->Branch("Tau32_image", &fTTau32_image, "Tau32_image/F");
+    tT->Branch("Tau21_image", &fTTau21_image, "Tau21_image/F");
+
+    tT->Branch("C2", &fTC2, "C2/F");
+    tT->Branch("D2", &fTD2, "D2/F");
+    tT->Branch("C2_nopix", &fTC2_nopix, "C2_nopix/F");
+    tT->Branch("D2_nopix", &fTD2_nopix, "D2_nopix/F");
+
+    tT->Branch("JetCharge_nopix", &fTJetCharge_nopix, "JetCharge_nopix/F");
     
     // tT->Branch("Tau32old", &fTTau32old, "Tau32old/F");
     // tT->Branch("Tau21old", &fTTau21old, "Tau21old/F");
@@ -542,6 +690,19 @@ void MIAnalysis::ResetBranches(){
     fTTau2_nopix = -999;
     fTTau3_nopix = -999;
 
+    fTTau32_image = -999;
+    fTTau21_image = -999;
+
+    fTTau1_image = -999;
+    fTTau2_image = -999;
+    fTTau3_image = -999;
+
+    fTC2 = -999;
+    fTD2 = -999;
+    fTC2_nopix = -999;
+    fTD2_nopix = -999;
+    fTJetCharge_nopix = -999;
+
     // fTTau32old = -999;
     // fTTau21old = -999;
 
@@ -562,4 +723,9 @@ void MIAnalysis::ResetBranches(){
         // fTLocalDensity[iP]= -999;
         // fTGlobalDensity[iP]= -999;
     }
+    fTLeadingSubjetEta = -999;
+    fTLeadingSubjetPhi = -999;
+    if (imageset) imageset->Reset();
+    if (constituents) constituents->Reset();
+    if (constituents_nopix) constituents_nopix->Reset();
 }
@@ -17,21 +17,52 @@ using fastjet::PseudoJet;
 
 
 // Constructor 
-MITools::MITools(){
+MITools::MITools(unsigned int seed, int nstreams){
     m_test = 0;
+    SetSeed(seed, nstreams);
 }
 
-int MITools::Match(fastjet::PseudoJet jet,vector<fastjet::PseudoJet> jets){
+// Destructor
+MITools::~MITools(){
+    for (unsigned int i=0; i<m_random.size(); i++) delete m_random[i];
+}
+
+// Seed of stream i: (seed, i) mixed by the splitmix64 finalizer, never 0
+// (which would make TRandom3 seed itself from the clock)
+static unsigned int StreamSeed(unsigned int seed, int stream){
+  unsigned long long z = seed * 0x9E3779B97F4A7C15ULL + (stream + 1) * 0xBF58476D1CE4E5B9ULL;
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+  z = z ^ (z >> 31);
+  unsigned int s = (unsigned int) (z >> 32);
+  return s == 0 ? 1 : s;
+}
+
+void MITools::SetSeed(unsigned int seed, int nstreams){
+  for (unsigned int i=0; i<m_random.size(); i++) delete m_random[i];
+  m_random.clear();
+
+  m_seed = seed;
+  if (nstreams < 1) nstreams = 1;
+  for (int i=0; i<nstreams; i++){
+    m_random.push_back(new TRandom3(StreamSeed(seed, i)));
+  }
+}
+
+TRandom3& MITools::Random(int stream){
+  return *m_random[stream % m_random.size()];
+}
 
-  double close=500;
+int MITools::Match(const fastjet::PseudoJet &jet, const vector<fastjet::PseudoJet> &jets){
+
+  //Returns the index of the closest of jets within 0.7 of jet, -1 if none
+  double close=0.7;
   int found=-1;
-  double closePt = 0.;
   for (unsigned int i=0; i<jets.size(); i++){
     double myR = jet.delta_R(jets[i]);
-    if (jet.pt() > closePt && myR < 0.7){
+    if (myR < close){
       found=i;
-      myR=close;
-      closePt = jet.pt();
+      close=myR;
     }
   }
 
@@ -39,15 +70,36 @@ int MITools::Match(fastjet::PseudoJet jet,vector<fastjet::PseudoJet> jets){
 
 }
 
-double MITools::JetCharge(fastjet::PseudoJet jet,double kappa){
+void MITools::Match(const vector<fastjet::PseudoJet> &jets, const vector<fastjet::PseudoJet> &truths, vector<int> &matches, JetMatcher::Mode mode, double maxR){
+  JetMatcher matcher(maxR, mode);
+  matcher.Match(jets, truths, matches);
+}
+
+double MITools::JetCharge(const fastjet::PseudoJet &jet, double kappa){
   //Returns the jet charge with weighting factor kappa
+  vector<fastjet::PseudoJet> constituents = jet.constituents();
   double charge=0.;
-  for (unsigned int i=0; i<jet.constituents().size(); i++){
-    charge+=jet.constituents()[i].user_info<MyUserInfo>().charge()*pow(jet.constituents()[i].pt(),kappa);
+  for (unsigned int i=0; i<constituents.size(); i++){
+    charge+=constituents[i].user_info<MyUserInfo>().charge()*pow(constituents[i].pt(),kappa);
   }
   return charge/pow(jet.pt(),kappa);
 }
 
+double MITools::JetCharge(const fastjet::PseudoJet &jet, double kappa, const ParticleInfoTable &info){
+  //Same as above, with the constituent charges from the event's ParticleInfoTable
+  return JetCharge(JetView(jet, &info), kappa);
+}
+
+double MITools::JetCharge(const JetView &jet, double kappa){
+  const vector<double> &pt = jet.Pt();
+  const vector<double> &q = jet.Charge();
+  double charge=0.;
+  for (unsigned int i=0; i<jet.Size(); i++){
+    charge+=q[i]*pow(pt[i],kappa);
+  }
+  return charge/pow(jet.JetPt(),kappa);
+}
+
 bool MITools::IsBHadron(int pdgId){
   int abs_pdgId = abs(pdgId);
   int abs_pdgId_mod10k = (abs(pdgId)%10000);
@@ -68,53 +120,77 @@ bool MITools::IsCHadron(int pdgId){
   return false;
 }
 
-bool MITools::Btag(fastjet::PseudoJet jet,vector<fastjet::PseudoJet> bhadrons,vector<fastjet::PseudoJet> chadrons,double jetrad,double b,double c,double uds){
+// The b/c/light decision for one jet, given which hadrons it contains
+static bool BtagDecision(TRandom3 &rand, bool foundb, bool foundc, double b, double c, double uds){
+
+  if (foundb){
+    double flip = rand.Uniform(0.,1.);
+    if (flip < b) return true;
+  }
+  if (foundc){
+    double flip = rand.Uniform(0.,1.);
+    if (flip < 1./c) return true;
+  }
+  double flip = rand.Uniform(0.,1.);
+  if (flip < 1./uds) return true;
+
+  return false;
+}
+
+bool MITools::Btag(const fastjet::PseudoJet &jet, const vector<fastjet::PseudoJet> &bhadrons, const vector<fastjet::PseudoJet> &chadrons, double jetrad, double b, double c, double uds, int stream){
 
-  TRandom3 *rand = new TRandom3(0);
+  bool foundb=false;
+  bool foundc=false;
 
-  int foundb=0;
-  int foundc=0;
-  
-  for (unsigned int i=0; i<bhadrons.size(); i++){
+  for (unsigned int i=0; i<bhadrons.size() && !foundb; i++){
     if (bhadrons[i].delta_R(jet)<jetrad){
-      foundb=1;
+      foundb=true;
     }
   }
 
-  for (unsigned int i=0; i<chadrons.size(); i++){
+  for (unsigned int i=0; i<chadrons.size() && !foundc; i++){
     if (chadrons[i].delta_R(jet)<jetrad){
-      foundc=1;
+      foundc=true;
     }
   }
 
-  if (foundb==1){
-    double flip = rand->Uniform(0.,1.);
-    if (flip < b){
-      delete rand;
-      return true;
-    }
-  }
-  if (foundc==1){
-    double flip= rand->Uniform(0.,1.);
-    if (flip < 1./c){
-      delete rand;
-      return true;
-    }
+  return BtagDecision(Random(stream), foundb, foundc, b, c, uds);
+}
+
+void MITools::Btag(const vector<fastjet::PseudoJet> &jets, const vector<fastjet::PseudoJet> &bhadrons, const vector<fastjet::PseudoJet> &chadrons, double jetrad, double b, double c, double uds, vector<bool> &tags, int stream){
+
+  tags.assign(jets.size(), false);
+  if (jets.empty()) return;
+
+  // cells of about the jet radius, so each jet looks at 3x3 of them
+  EtaPhiLookup blookup(jetrad);
+  EtaPhiLookup clookup(jetrad);
+  blookup.Fill(bhadrons);
+  clookup.Fill(chadrons);
+
+  TRandom3 &rand = Random(stream);
+  for (unsigned int i=0; i<jets.size(); i++){
+    bool foundb = blookup.AnyWithin(jets[i], jetrad);
+    bool foundc = clookup.AnyWithin(jets[i], jetrad);
+    tags[i] = BtagDecision(rand, foundb, foundc, b, c, uds);
   }
-  double flip= rand->Uniform(0.,1.);
-  if (flip < 1./uds){
-    delete rand;
-    return true;
+}
+
+bool MITools::BosonMatch(const fastjet::PseudoJet &jet, const vector<fastjet::PseudoJet> &Bosons, double jetrad, int BosonID ){
+
+  for (unsigned int i=0; i<Bosons.size(); i++){
+      if (Bosons[i].user_info<MyUserInfo>().pdg_id() != BosonID) continue;
+      if (Bosons[i].delta_R(jet)<jetrad){
+        return true;
+      }
   }
-  
-  delete rand;
   return false;
 }
 
-bool MITools::BosonMatch(fastjet::PseudoJet jet, vector<fastjet::PseudoJet> Bosons, double jetrad, int BosonID ){
+bool MITools::BosonMatch(const fastjet::PseudoJet &jet, const vector<fastjet::PseudoJet> &Bosons, const ParticleInfoTable &info, double jetrad, int BosonID){
 
   for (unsigned int i=0; i<Bosons.size(); i++){
-      if (Bosons[i].user_info<MyUserInfo>().pdg_id() != BosonID) continue;
+      if (info.pdg_id(Bosons[i]) != BosonID) continue;
       if (Bosons[i].delta_R(jet)<jetrad){
         return true;
       }
@@ -139,3 +215,7 @@ bool MITools::IsIsolated(Pythia8::Particle* particle, Pythia8::Pythia* pythia8,
     if(sumpT/part.pt()>rel_iso) return false;
     else return true;
 }
+
+bool MITools::IsIsolated(const Pythia8::Particle* particle, const IsolationEngine &isolation, float rel_iso, float ConeSize){
+    return isolation.IsIsolated(particle, rel_iso, ConeSize);
+}
@@ -0,0 +1,136 @@
+#include <string>
+#include <vector>
+
+#include "RVersion.h"
+#include "TTree.h"
+#include "TBranch.h"
+#include "TLeaf.h"
+#include "TObjArray.h"
+
+#include "OutputProfile.h"
+
+using namespace std;
+
+// ZSTD is only available from ROOT 6.20 on, LZ4 from 6.12 on
+#if ROOT_VERSION_CODE >= ROOT_VERSION(6,20,0)
+static const int zstd_or_lzma = 5;
+#else
+static const int zstd_or_lzma = 2;
+#endif
+#if ROOT_VERSION_CODE >= ROOT_VERSION(6,12,0)
+static const int lz4_or_zlib = 4;
+#else
+static const int lz4_or_zlib = 1;
+#endif
+
+// events per cluster of the read-optimized profile
+static const int read_cluster_events = 1000;
+
+// Constructor: the ROOT defaults
+OutputProfile::OutputProfile()
+    : name("default"), description("ROOT defaults"), algorithm(-1), level(0),
+      basket_size(0), image_basket_size(0), auto_flush(0)
+{
+}
+
+int OutputProfile::Compression() const
+{
+    return algorithm * 100 + level;
+}
+
+void OutputProfile::ApplyTo(TTree *tree, int image_pixels) const
+{
+    TObjArray *branches = tree->GetListOfBranches();
+    if (algorithm >= 0)
+    {
+        for (int i = 0; i < branches->GetEntriesFast(); i++)
+        {
+            ((TBranch *) branches->UncheckedAt(i))->SetCompressionSettings(Compression());
+        }
+    }
+
+    if (auto_flush != 0) tree->SetAutoFlush(auto_flush);
+
+    if (basket_size > 0) tree->SetBasketSize("*", basket_size);
+
+    // the images are the arrays counted by NFilled (Intensity[NFilled] or
+    // its encoded forms) and the fixed-length ones of ImageSet; one basket
+    // per cluster holds their values and the entry offset of each event.
+    // Other variable-length arrays (ConstPt[NConst], ...) keep basket_size.
+    for (int i = 0; i < branches->GetEntriesFast(); i++)
+    {
+        TBranch *branch = (TBranch *) branches->UncheckedAt(i);
+        TLeaf *leaf = (TLeaf *) branch->GetListOfLeaves()->At(0);
+        if (!leaf) continue;
+        long long values = leaf->GetLenStatic();
+        if (leaf->GetLeafCount())
+        {
+            if (string(leaf->GetLeafCount()->GetName()) != "NFilled") continue;
+            values = image_pixels;
+        }
+        if (values <= 1) continue;
+
+        long long image_basket = image_basket_size;
+        if (image_basket < 0 && auto_flush > 0)
+            image_basket = auto_flush * (values * leaf->GetLenType() + sizeof(int)) + 1024;
+        if (image_basket > 0) branch->SetBasketSize((int) image_basket);
+    }
+}
+
+vector<OutputProfile> OutputProfile::All()
+{
+    vector<OutputProfile> profiles;
+
+    OutputProfile p;
+    profiles.push_back(p);
+
+    p.name = "fast-write";
+    p.description = "LZ4 level 1, 256 kB baskets (4 MB for the image), 64 MB clusters";
+    p.algorithm = lz4_or_zlib;
+    p.level = 1;
+    p.basket_size = 256000;
+    p.image_basket_size = 4000000;
+    p.auto_flush = -64000000;
+    profiles.push_back(p);
+
+    p.name = "archival";
+    p.description = "ZSTD level 9 (LZMA before ROOT 6.20), 512 kB baskets (8 MB for the image), 128 MB clusters";
+    p.algorithm = zstd_or_lzma;
+    p.level = 9;
+    p.basket_size = 512000;
+    p.image_basket_size = 8000000;
+    p.auto_flush = -128000000;
+    profiles.push_back(p);
+
+    p.name = "archival-lzma";
+    p.description = "LZMA level 9, 512 kB baskets (8 MB for the image), 128 MB clusters";
+    p.algorithm = 2;
+    p.level = 9;
+    profiles.push_back(p);
+
+    // image_basket_size < 0: sized from the image to hold one cluster
+    p.name = "read-optimized";
+    p.description = "ZSTD level 4 (LZ4 before ROOT 6.20), clusters of 1000 events, one basket per branch and cluster";
+    p.algorithm = zstd_or_lzma == 5 ? 5 : lz4_or_zlib;
+    p.level = 4;
+    p.basket_size = read_cluster_events * sizeof(float) + 1024;
+    p.image_basket_size = -1;
+    p.auto_flush = read_cluster_events;
+    profiles.push_back(p);
+
+    return profiles;
+}
+
+bool OutputProfile::Find(const string &name, OutputProfile &profile)
+{
+    vector<OutputProfile> profiles = All();
+    for (unsigned int i = 0; i < profiles.size(); i++)
+    {
+        if (profiles[i].name == name)
+        {
+            profile = profiles[i];
+            return true;
+        }
+    }
+    return false;
+}
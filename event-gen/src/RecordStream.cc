@@ -0,0 +1,232 @@
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "TTree.h"
+#include "TBranch.h"
+#include "TLeaf.h"
+#include "TObjArray.h"
+
+#include "RecordStream.h"
+
+using namespace std;
+
+static const uint32_t stream_header_size = 4096;
+static const uint32_t stream_layout_offset = 256;
+
+// numpy type code of a ROOT leaf type, empty if there is none
+static string NumpyType(const string &root_type)
+{
+    if (root_type == "Float_t")   return "f4";
+    if (root_type == "Double_t")  return "f8";
+    if (root_type == "Int_t")     return "i4";
+    if (root_type == "UInt_t")    return "u4";
+    if (root_type == "Short_t")   return "i2";
+    if (root_type == "UShort_t")  return "u2";
+    if (root_type == "Long64_t")  return "i8";
+    if (root_type == "ULong64_t") return "u8";
+    if (root_type == "Char_t")    return "i1";
+    if (root_type == "UChar_t")   return "u1";
+    if (root_type == "Bool_t")    return "u1";
+    return "";
+}
+
+static long long CountValue(const char *address, int type)
+{
+    if (type == 1) return *(const unsigned char *) address;
+    if (type == 2) return *(const short *) address;
+    if (type == 8) return *(const long long *) address;
+    return *(const int *) address;
+}
+
+// Constructor
+RecordStream::RecordStream(const string &path, int nslots, double timeout)
+    : fPath(path), fNSlots(nslots > 0 ? nslots : 1), fTimeout(timeout), fFailed(false), fRecordSize(0), fMap(0),
+      fMapSize(0), fHeader(0), fHead(0), fNWaits(0), fWaitSeconds(0)
+{
+}
+
+// Destructor
+RecordStream::~RecordStream()
+{
+    Close();
+}
+
+bool RecordStream::Open(TTree *tree)
+{
+    fFields.clear();
+    int offset = 0;
+    TObjArray *branches = tree->GetListOfBranches();
+    for (int i = 0; i < branches->GetEntriesFast(); i++)
+    {
+        TBranch *branch = (TBranch *) branches->UncheckedAt(i);
+        TObjArray *leaves = branch->GetListOfLeaves();
+        if (branch->IsA() != TBranch::Class() || !branch->GetAddress()) continue;
+
+        for (int k = 0; k < leaves->GetEntriesFast(); k++)
+        {
+            TLeaf *leaf = (TLeaf *) leaves->UncheckedAt(k);
+            Field field;
+            field.type = NumpyType(leaf->GetTypeName());
+            if (field.type.empty() || leaf->InheritsFrom("TLeafC"))
+            {
+                cout << "RecordStream::Open: leaving out " << leaf->GetName() << " of type " << leaf->GetTypeName() << endl;
+                continue;
+            }
+            field.name = leaves->GetEntriesFast() == 1 ? string(branch->GetName())
+                                                        : string(branch->GetName()) + "." + leaf->GetName();
+            field.source = branch->GetAddress() + leaf->GetOffset();
+            field.type_bytes = leaf->GetLenType();
+            field.count = 0;
+            field.count_type = 0;
+            field.element_bytes = 0;
+
+            int n = leaf->GetLenStatic();
+            TLeaf *count = leaf->GetLeafCount();
+            if (count)
+            {
+                if (!count->GetBranch()->GetAddress()) continue;
+                field.count = count->GetBranch()->GetAddress() + count->GetOffset();
+                field.count_type = count->GetLenType();
+                field.element_bytes = n * field.type_bytes;
+                n *= CountValue(field.count, field.count_type);
+            }
+            field.bytes = n * field.type_bytes;
+
+            // aligned to the size of the type, as numpy would
+            offset = (offset + field.type_bytes - 1) / field.type_bytes * field.type_bytes;
+            field.offset = offset;
+            offset += field.bytes;
+            fFields.push_back(field);
+        }
+    }
+    // records on cache lines
+    fRecordSize = (offset + 63) / 64 * 64;
+    if (fRecordSize == 0) fRecordSize = 64;
+
+    stringstream layout;
+    for (unsigned int i = 0; i < fFields.size(); i++)
+    {
+        layout << fFields[i].name << " " << fFields[i].type << " " << fFields[i].offset << " "
+               << fFields[i].bytes / fFields[i].type_bytes << "\n";
+    }
+    if (stream_layout_offset + layout.str().size() + 1 > stream_header_size)
+    {
+        cerr << "RecordStream::Open: too many fields for the header" << endl;
+        return false;
+    }
+
+    int fd = open(fPath.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+    {
+        cerr << "RecordStream::Open: cannot create " << fPath << ": " << strerror(errno) << endl;
+        return false;
+    }
+    fMapSize = stream_header_size + fNSlots * fRecordSize;
+    if (ftruncate(fd, fMapSize) != 0)
+    {
+        cerr << "RecordStream::Open: cannot size " << fPath << ": " << strerror(errno) << endl;
+        close(fd);
+        return false;
+    }
+    void *map = mmap(0, fMapSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+    {
+        cerr << "RecordStream::Open: cannot map " << fPath << ": " << strerror(errno) << endl;
+        return false;
+    }
+
+    fMap = (char *) map;
+    fHeader = (RecordStreamHeader *) fMap;
+    fHeader->header_size = stream_header_size;
+    fHeader->record_size = fRecordSize;
+    fHeader->nslots = fNSlots;
+    fHeader->head = 0;
+    fHeader->tail = 0;
+    fHeader->done = 0;
+    fHeader->consumer_pid = 0;
+    memcpy(fMap + stream_layout_offset, layout.str().c_str(), layout.str().size() + 1);
+    fHead = 0;
+
+    // a consumer waiting for the magic sees the rest of the header
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    memcpy(fHeader->magic, "JETRING1", 8);
+    return true;
+}
+
+bool RecordStream::Write()
+{
+    if (!fMap || fFailed) return false;
+
+    if (fHead - __atomic_load_n(&fHeader->tail, __ATOMIC_ACQUIRE) >= fNSlots)
+    {
+        fNWaits++;
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        useconds_t pause = 50;
+        while (fHead - __atomic_load_n(&fHeader->tail, __ATOMIC_ACQUIRE) >= fNSlots)
+        {
+            usleep(pause);
+            if (pause < 2000) pause *= 2;
+            if (pause < 2000) continue;
+
+            // checked at the slowest polling rate only
+            double waited = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+            uint64_t pid = __atomic_load_n(&fHeader->consumer_pid, __ATOMIC_ACQUIRE);
+            if (pid && kill((pid_t) pid, 0) != 0 && errno == ESRCH)
+            {
+                cerr << "RecordStream::Write: the consumer (pid " << pid << ") has exited, stopping after "
+                     << fHead << " records" << endl;
+                fFailed = true;
+            }
+            else if (fTimeout > 0 && waited > fTimeout)
+            {
+                cerr << "RecordStream::Write: no record consumed for " << fTimeout << " s"
+                     << (pid ? "" : " (no consumer attached)") << ", stopping after " << fHead << " records" << endl;
+                fFailed = true;
+            }
+            if (fFailed)
+            {
+                fWaitSeconds += waited;
+                return false;
+            }
+        }
+        fWaitSeconds += chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    }
+
+    char *record = fMap + stream_header_size + (fHead % fNSlots) * fRecordSize;
+    for (unsigned int i = 0; i < fFields.size(); i++)
+    {
+        const Field &field = fFields[i];
+        int bytes = field.bytes;
+        if (field.count)
+        {
+            long long n = CountValue(field.count, field.count_type) * field.element_bytes;
+            if (n < bytes) bytes = n > 0 ? n : 0;
+        }
+        memcpy(record + field.offset, field.source, bytes);
+        if (bytes < field.bytes) memset(record + field.offset + bytes, 0, field.bytes - bytes);
+    }
+
+    fHead++;
+    __atomic_store_n(&fHeader->head, fHead, __ATOMIC_RELEASE);
+    return true;
+}
+
+void RecordStream::Close()
+{
+    if (!fMap) return;
+
+    __atomic_store_n(&fHeader->done, (uint64_t) 1, __ATOMIC_RELEASE);
+    munmap(fMap, fMapSize);
+    fMap = 0;
+    fHeader = 0;
+}
@@ -0,0 +1,393 @@
+// Makes jet images again from the constituents an event-gen file keeps
+// with --Constituents, without generating the events again.
+//
+// For each event of --Input, the constituents are centred on the leading
+// subjet as in MIAnalysis::AnalyzeEvent, every image definition of --Images
+// (see ImageSet) is filled from them in one pass, and tau_1..3 of each image
+// are computed with ImageNsubjettiness.  tau_1..3 of the constituents
+// themselves are computed with NsubjettinessBatch, with the definition of
+// AnalyzeEvent (one-pass WTA kT axes, normalized measure with beta = R0 = 1),
+// so that Tau1_const of the cells agrees with Tau1 of the EventTree up to the
+// float rounding of the stored constituents.  The output tree, ImageTree, has
+// one entry per entry of the input EventTree, so it can be used as a friend:
+//
+//   <name>[pixels*pixels]/F (or encoded, --ImageEncoding)
+//   Tau1_<name>, Tau2_<name>, Tau3_<name>, Tau21_<name>, Tau32_<name>
+//   Tau1_const, Tau2_const, Tau3_const, Tau21_const, Tau32_const
+//
+// The events are read in batches by the main thread while --Threads worker
+// threads process the previous batch; the main thread then writes it out.
+// The positions are stored as floats, so a definition equal to the
+// --Pixels/--Range of the run gives back Intensity up to the constituents
+// that float rounding moves across a cell edge.
+
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <math.h>
+
+#include "TFile.h"
+#include "TTree.h"
+#include "TStopwatch.h"
+
+#include "ImageSet.h"
+#include "ImageCodec.h"
+#include "ImageNsubjettiness.h"
+#include "ConstituentArrays.h"
+#include "OutputProfile.h"
+#include "parser.hh"
+
+#include "fastjet/PseudoJet.hh"
+#include "NsubjettinessBatch.hh"
+
+using namespace std;
+using fastjet::PseudoJet;
+using namespace fastjet::contrib;
+
+// A block of consecutive events: their constituents on the way in, their
+// images and taus on the way out
+struct EventBatch
+{
+    int n;
+    vector<int> first;  // first constituent of each event, n + 1 entries
+    vector<float> pt;
+    vector<float> eta;
+    vector<float> phi;
+    vector<float> energy;
+    vector<float> centre_eta;
+    vector<float> centre_phi;
+
+    // per image definition, n images and 3 n taus
+    vector< vector<float> > images;
+    vector< vector<double> > taus;
+
+    // 3 n taus of the constituents
+    vector<double> const_taus;
+};
+
+// tau_1..3 of the constituents, as SubstructureEngine computes them for
+// AnalyzeEvent
+static vector<unsigned> ConstituentNs()
+{
+    vector<unsigned> Ns;
+    Ns.push_back(1);
+    Ns.push_back(2);
+    Ns.push_back(3);
+    return Ns;
+}
+
+// What one worker thread keeps between the batches
+struct Worker
+{
+    Worker(const vector<ImageConfig> &configs)
+        : images(configs),
+          const_taus(ConstituentNs(), OnePass_WTA_KT_Axes(), NormalizedMeasure(1.0, 1.0))
+    {
+        for (unsigned int c = 0; c < configs.size(); c++)
+        {
+            taus.push_back(ImageNsubjettiness(configs[c].pixels, configs[c].range));
+        }
+        Ns.push_back(1);
+        Ns.push_back(2);
+        Ns.push_back(3);
+    }
+
+    ImageSet images;
+    vector<ImageNsubjettiness> taus;
+    vector<int> Ns;
+
+    vector<double> x;
+    vector<double> y;
+    vector<double> energy;
+    vector<double> event_taus;
+
+    // one thread each, the workers are the threads
+    NsubjettinessBatch const_taus;
+    vector< vector<PseudoJet> > jets;
+    NsubjettinessTable const_table;
+};
+
+// images and taus of the events first, first + step, ... of batch
+static void Process(Worker *worker, EventBatch *batch, int first, int step)
+{
+    int njets = 0;
+    for (int i = first; i < batch->n; i += step)
+    {
+        // centred on the leading subjet: eta - eta0 and the delta phi to the
+        // subjet, as AnalyzeEvent does
+        int begin = batch->first[i];
+        int end = batch->first[i + 1];
+        worker->x.resize(end - begin);
+        worker->y.resize(end - begin);
+        worker->energy.resize(end - begin);
+        for (int k = begin; k < end; k++)
+        {
+            double dphi = (double) batch->centre_phi[i] - batch->phi[k];
+            if (dphi > M_PI) dphi -= 2 * M_PI;
+            if (dphi < -M_PI) dphi += 2 * M_PI;
+            worker->x[k - begin] = (double) batch->eta[k] - batch->centre_eta[i];
+            worker->y[k - begin] = dphi;
+            worker->energy[k - begin] = batch->energy[k];
+        }
+
+        double pc_x = 0;
+        double pc_y = 0;
+        if (end > begin) ImageSet::PrincipalAxis(worker->x, worker->y, worker->energy, pc_x, pc_y);
+        worker->images.Fill(worker->x, worker->y, worker->energy, pc_x, pc_y);
+
+        for (int c = 0; c < worker->images.Size(); c++)
+        {
+            int size = worker->images.Config(c).pixels * worker->images.Config(c).pixels;
+            const float *image = worker->images.Image(c);
+            copy(image, image + size, batch->images[c].begin() + (long long) i * size);
+
+            worker->taus[c].Taus(worker->Ns, image, worker->event_taus);
+            for (int k = 0; k < 3; k++) batch->taus[c][3 * i + k] = worker->event_taus[k];
+        }
+
+        // the constituents as massive particles, for their taus below
+        if ((int) worker->jets.size() <= njets) worker->jets.resize(njets + 1);
+        vector<PseudoJet> &particles = worker->jets[njets++];
+        particles.resize(end - begin);
+        for (int k = begin; k < end; k++)
+        {
+            double pt = batch->pt[k];
+            double phi = batch->phi[k];
+            particles[k - begin].reset(pt * cos(phi), pt * sin(phi), pt * sinh((double) batch->eta[k]), batch->energy[k]);
+        }
+    }
+
+    // the jets of this worker in one go (only the last batch is smaller)
+    worker->jets.resize(njets);
+    worker->const_taus.evaluate(worker->jets, worker->const_table);
+    for (int j = 0, i = first; j < njets; j++, i += step)
+    {
+        for (int k = 0; k < 3; k++) batch->const_taus[3 * i + k] = worker->const_table.tau(j, k);
+    }
+}
+
+// reads up to size events from entry on; returns the entry after the last
+static long long ReadBatch(TTree *tree, ConstituentArrays &constituents, float *centre,
+    long long entry, long long last, int size, const vector<ImageConfig> &configs, EventBatch &batch)
+{
+    batch.n = 0;
+    batch.first.assign(1, 0);
+    batch.pt.clear();
+    batch.eta.clear();
+    batch.phi.clear();
+    batch.energy.clear();
+    batch.centre_eta.clear();
+    batch.centre_phi.clear();
+
+    for (; entry < last && batch.n < size; entry++)
+    {
+        tree->GetEntry(entry);
+        int n = constituents.N();
+        batch.pt.insert(batch.pt.end(), constituents.Pt(), constituents.Pt() + n);
+        batch.eta.insert(batch.eta.end(), constituents.Eta(), constituents.Eta() + n);
+        batch.phi.insert(batch.phi.end(), constituents.Phi(), constituents.Phi() + n);
+        batch.energy.insert(batch.energy.end(), constituents.E(), constituents.E() + n);
+        batch.first.push_back(batch.eta.size());
+        batch.centre_eta.push_back(centre[0]);
+        batch.centre_phi.push_back(centre[1]);
+        batch.n++;
+    }
+
+    batch.images.resize(configs.size());
+    batch.taus.resize(configs.size());
+    for (unsigned int c = 0; c < configs.size(); c++)
+    {
+        batch.images[c].resize((long long) batch.n * configs[c].pixels * configs[c].pixels);
+        batch.taus[c].resize(3 * batch.n);
+    }
+    batch.const_taus.resize(3 * batch.n);
+    return entry;
+}
+
+int main(int argc, const char* argv[])
+{
+    optionparser::parser parser("Jet images and their taus again, from the constituents of an event-gen file");
+
+    parser.add_option("--Input").mode(optionparser::store_value).default_value("").help("event-gen file written with --Constituents");
+    parser.add_option("--OutFile").mode(optionparser::store_value).default_value("rerasterized.root").help("output file, with the ImageTree");
+    parser.add_option("--Images").mode(optionparser::store_value).default_value("").help("Images to make, comma separated [name=]pixels:range[:rotate+flip+normalize], as event-gen --Images");
+    parser.add_option("--Source").mode(optionparser::store_value).default_value("cells").help("Constituents to use: cells (--Constituents=1) or particles (--Constituents=2)");
+    parser.add_option("--Threads").mode(optionparser::store_value).default_value(0).help("Worker threads (0: one per core)");
+    parser.add_option("--Batch").mode(optionparser::store_value).default_value(1024).help("Events read per batch");
+    parser.add_option("--NEvents").mode(optionparser::store_value).default_value(-1).help("Number of events (-1: all)");
+    parser.add_option("--ImageEncoding").mode(optionparser::store_value).default_value("float32").help("Storage of the images: float32, float16, log-uint16 or uint8");
+    parser.add_option("--OutputProfile").mode(optionparser::store_value).default_value("default").help("ImageTree output profile: default, fast-write, archival, archival-lzma or read-optimized");
+
+    parser.eat_arguments(argc, argv);
+
+    string inputName = parser.get_value<string>("Input");
+    string outName = parser.get_value<string>("OutFile");
+    string imagesSpec = parser.get_value<string>("Images");
+    string source = parser.get_value<string>("Source");
+    int nthreads = parser.get_value<int>("Threads");
+    int batchSize = parser.get_value<int>("Batch");
+    long long nevents = parser.get_value<int>("NEvents");
+    string encodingName = parser.get_value<string>("ImageEncoding");
+    string profileName = parser.get_value<string>("OutputProfile");
+
+    vector<ImageConfig> configs;
+    if (!ImageConfig::Parse(imagesSpec, configs) || configs.empty())
+    {
+        cerr << "Bad or no image definitions " << imagesSpec << endl;
+        return 1;
+    }
+    for (unsigned int c = 0; c < configs.size(); c++)
+    {
+        if (configs[c].name == "const")
+        {
+            cerr << "The image name const is taken by the taus of the constituents" << endl;
+            return 1;
+        }
+    }
+    ImageCodec::Encoding encoding;
+    if (!ImageCodec::FromName(encodingName, encoding))
+    {
+        cerr << "Unknown image encoding " << encodingName << endl;
+        return 1;
+    }
+    OutputProfile profile;
+    if (!OutputProfile::Find(profileName, profile))
+    {
+        cerr << "Unknown output profile " << profileName << endl;
+        return 1;
+    }
+    if (source != "cells" && source != "particles")
+    {
+        cerr << "Unknown source " << source << endl;
+        return 1;
+    }
+    if (nthreads <= 0) nthreads = thread::hardware_concurrency();
+    if (nthreads <= 0) nthreads = 1;
+    if (batchSize <= 0) batchSize = 1024;
+
+    TFile *inputFile = TFile::Open(inputName.c_str());
+    if (!inputFile || inputFile->IsZombie())
+    {
+        cerr << "Cannot open " << inputName << endl;
+        return 1;
+    }
+    TTree *input = (TTree *) inputFile->Get("EventTree");
+    if (!input)
+    {
+        cerr << "No EventTree in " << inputName << endl;
+        return 1;
+    }
+
+    // only the branches used are read
+    string suffix = source == "particles" ? "_nopix" : "";
+    input->SetBranchStatus("*", 0);
+    input->SetBranchStatus(("NConst" + suffix).c_str(), 1);
+    input->SetBranchStatus(("ConstPt" + suffix).c_str(), 1);
+    input->SetBranchStatus(("ConstEta" + suffix).c_str(), 1);
+    input->SetBranchStatus(("ConstPhi" + suffix).c_str(), 1);
+    input->SetBranchStatus(("ConstE" + suffix).c_str(), 1);
+    input->SetBranchStatus("LeadingSubjetEta", 1);
+    input->SetBranchStatus("LeadingSubjetPhi", 1);
+
+    ConstituentArrays constituents;
+    float centre[2];
+    if (!constituents.SetAddresses(input, suffix) || !input->GetBranch("LeadingSubjetEta"))
+    {
+        cerr << inputName << " has no " << source << " constituents, run event-gen with --Constituents="
+             << (source == "particles" ? 2 : 1) << endl;
+        return 1;
+    }
+    input->SetBranchAddress("LeadingSubjetEta", &centre[0]);
+    input->SetBranchAddress("LeadingSubjetPhi", &centre[1]);
+
+    long long last = input->GetEntries();
+    if (nevents >= 0 && nevents < last) last = nevents;
+
+    TFile *outFile;
+    if (profile.algorithm >= 0)
+        outFile = new TFile(outName.c_str(), "RECREATE", "", profile.Compression());
+    else
+        outFile = new TFile(outName.c_str(), "RECREATE");
+    TTree *output = new TTree("ImageTree", "Images made again from the constituents");
+
+    ImageSet images(configs);
+    images.DeclareBranches(output, encoding);
+    // the taus of each image, then of the constituents
+    vector<float> tau_values(5 * (configs.size() + 1));
+    for (unsigned int c = 0; c <= configs.size(); c++)
+    {
+        string names[5] = {"Tau1_", "Tau2_", "Tau3_", "Tau21_", "Tau32_"};
+        for (int k = 0; k < 5; k++)
+        {
+            string name = names[k] + (c < configs.size() ? configs[c].name : "const");
+            output->Branch(name.c_str(), &tau_values[5 * c + k], (name + "/F").c_str());
+        }
+    }
+    profile.ApplyTo(output, 0);
+
+    vector<Worker *> workers;
+    for (int t = 0; t < nthreads; t++) workers.push_back(new Worker(configs));
+
+    TStopwatch clock;
+    EventBatch batches[2];
+    int current = 0;
+    long long entry = ReadBatch(input, constituents, centre, 0, last, batchSize, configs, batches[0]);
+    while (batches[current].n > 0)
+    {
+        EventBatch &batch = batches[current];
+
+        // image this batch while the next one is read
+        vector<thread> threads;
+        for (int t = 0; t < nthreads; t++) threads.push_back(thread(Process, workers[t], &batch, t, nthreads));
+        entry = ReadBatch(input, constituents, centre, entry, last, batchSize, configs, batches[1 - current]);
+        for (int t = 0; t < nthreads; t++) threads[t].join();
+
+        for (int i = 0; i < batch.n; i++)
+        {
+            for (unsigned int c = 0; c <= configs.size(); c++)
+            {
+                const vector<double> &taus = c < configs.size() ? batch.taus[c] : batch.const_taus;
+                if (c < configs.size())
+                {
+                    int size = configs[c].pixels * configs[c].pixels;
+                    images.SetImage(c, &batch.images[c][(long long) i * size]);
+                }
+
+                float tau1 = (float) taus[3 * i];
+                float tau2 = (float) taus[3 * i + 1];
+                float tau3 = (float) taus[3 * i + 2];
+                tau_values[5 * c] = tau1;
+                tau_values[5 * c + 1] = tau2;
+                tau_values[5 * c + 2] = tau3;
+                tau_values[5 * c + 3] = (fabs(tau1) < 1e-4 ? -10 : tau2 / tau1);
+                tau_values[5 * c + 4] = (fabs(tau2) < 1e-4 ? -10 : tau3 / tau2);
+            }
+            images.Encode();
+            output->Fill();
+        }
+        current = 1 - current;
+    }
+    output->Write();
+    outFile->Close();
+    clock.Stop();
+
+    cout << "rerasterize: " << last << " events, " << configs.size() << " images each, "
+         << nthreads << " threads, " << fixed << setprecision(1) << clock.RealTime() << " s, "
+         << setprecision(0) << (clock.RealTime() > 0 ? last / clock.RealTime() : 0.) << " events/s" << endl;
+    for (unsigned int c = 0; encoding != ImageCodec::Float32 && c < configs.size(); c++)
+    {
+        cout << defaultfloat << setprecision(6)
+             << "rerasterize:   " << configs[c].name << " stored as " << ImageCodec::Name(encoding)
+             << ", relative L2 reconstruction error mean " << images.Codec(c)->MeanError()
+             << ", max " << images.Codec(c)->MaxError() << endl;
+    }
+
+    for (int t = 0; t < nthreads; t++) delete workers[t];
+    delete outFile;
+    inputFile->Close();
+    delete inputFile;
+    return 0;
+}
@@ -0,0 +1,201 @@
+#include <math.h>
+#include <vector>
+
+#include "fastjet/PseudoJet.hh"
+
+#include "SubstructureEngine.h"
+#include "JetView.h"
+#include "myFastJetBase.h"
+
+#include "Njettiness.hh"
+#include "NjettinessDefinition.hh"
+
+using namespace std;
+using fastjet::PseudoJet;
+using namespace fastjet::contrib;
+
+// Defaults: what AnalyzeEvent writes out
+SubstructureConfig::SubstructureConfig()
+{
+    tau_Ns.push_back(1);
+    tau_Ns.push_back(2);
+    tau_Ns.push_back(3);
+    tau_beta = 1.0;
+    tau_R0 = 1.0;
+    tau_warm_start = false;
+
+    do_ecf = true;
+    ecf_beta = 1.0;
+
+    charge_kappas.push_back(0.5);
+}
+
+// Constructor
+SubstructureEngine::SubstructureEngine(const SubstructureConfig &config)
+    : fConfig(config), fInfo(0), fSumPt(0)
+{
+    NormalizedMeasure parameters(fConfig.tau_beta, fConfig.tau_R0);
+    for (unsigned int i = 0; i < fConfig.tau_Ns.size(); i++)
+    {
+        if (fConfig.tau_warm_start)
+            fNjettiness.push_back(new Njettiness(OnePass_WarmStart_WTA_KT_Axes(), parameters));
+        else
+            fNjettiness.push_back(new Njettiness(OnePass_WTA_KT_Axes(), parameters));
+    }
+}
+
+// Destructor
+SubstructureEngine::~SubstructureEngine()
+{
+    for (unsigned int i = 0; i < fNjettiness.size(); i++)
+    {
+        delete fNjettiness[i];
+    }
+}
+
+void SubstructureEngine::Compute(const PseudoJet &jet, SubstructureResult &result,
+    const SubstructureResult *seed)
+{
+    FillCache(jet);
+    result.nconst = fView.Size();
+
+    ComputeTaus(result, seed);
+    ComputeECF(result);
+    ComputeCharges(result);
+}
+
+// The only walk over the constituents of the jet
+void SubstructureEngine::FillCache(const PseudoJet &jet)
+{
+    fView.Reset(jet, fInfo);
+    unsigned int n = fView.Size();
+    const vector<double> &pt = fView.Pt();
+    const vector<double> &rap = fView.Rap();
+    const vector<double> &phi = fView.Phi();
+
+    fSumPt = 0;
+    for (unsigned int i = 0; i < n; i++)
+    {
+        fSumPt += pt[i];
+    }
+
+    if (!fConfig.do_ecf) return;
+
+    // pairwise distances, each pair once
+    double half_beta = 0.5 * fConfig.ecf_beta;
+    fPairR.resize(n * n);
+    for (unsigned int i = 0; i < n; i++)
+    {
+        double *row = &fPairR[i * n];
+        for (unsigned int j = i + 1; j < n; j++)
+        {
+            double dphi = fabs(phi[i] - phi[j]);
+            if (dphi > M_PI) dphi = 2. * M_PI - dphi;
+            double drap = rap[i] - rap[j];
+            double R2 = drap * drap + dphi * dphi;
+
+            if (half_beta == 0.5)      row[j] = sqrt(R2);
+            else if (half_beta == 1.0) row[j] = R2;
+            else                       row[j] = pow(R2, half_beta);
+        }
+    }
+}
+
+void SubstructureEngine::ComputeTaus(SubstructureResult &result, const SubstructureResult *seed)
+{
+    unsigned int ntaus = fConfig.tau_Ns.size();
+    result.taus.resize(ntaus);
+    result.tau_axes.resize(ntaus);
+
+    for (unsigned int k = 0; k < ntaus; k++)
+    {
+        int N = fConfig.tau_Ns[k];
+
+        // the warm-start axes are always set, so that nothing is carried over
+        // from the previous jet (a single tau_1 axis adds nothing to the
+        // standard seed, so tau_2 is not chained to it)
+        if (fConfig.tau_warm_start)
+        {
+            if (seed && k < seed->tau_axes.size())
+                fNjettiness[k]->setAxes(seed->tau_axes[k]);
+            else if (k > 0 && fConfig.tau_Ns[k - 1] == N - 1 && N - 1 >= 2)
+                fNjettiness[k]->setAxes(result.tau_axes[k - 1]);
+            else
+                fNjettiness[k]->setAxes(vector<PseudoJet>());
+        }
+
+        result.taus[k] = fNjettiness[k]->getTau(N, fView.Constituents());
+        result.tau_axes[k] = fNjettiness[k]->currentAxes();
+    }
+}
+
+MinimizationStats SubstructureEngine::TauMinimizationStats() const
+{
+    MinimizationStats stats;
+    for (unsigned int i = 0; i < fNjettiness.size(); i++)
+    {
+        stats += fNjettiness[i]->minimizationStats();
+    }
+    return stats;
+}
+
+// e2 = sum_{i<j} z_i z_j R_ij^beta and e3 = sum_{i<j<k} z_i z_j z_k (R_ij R_ik R_jk)^beta,
+// with z_i = pt_i / sum pt
+void SubstructureEngine::ComputeECF(SubstructureResult &result)
+{
+    result.e2 = 0;
+    result.e3 = 0;
+    result.C2 = -10;
+    result.D2 = -10;
+    if (!fConfig.do_ecf || fSumPt <= 0) return;
+
+    unsigned int n = fView.Size();
+    const vector<double> &pt = fView.Pt();
+    double e2 = 0;
+    double e3 = 0;
+    for (unsigned int i = 0; i < n; i++)
+    {
+        const double *row_i = &fPairR[i * n];
+        for (unsigned int j = i + 1; j < n; j++)
+        {
+            const double *row_j = &fPairR[j * n];
+            double w = pt[i] * pt[j] * row_i[j];
+            e2 += w;
+
+            double acc = 0;
+            for (unsigned int k = j + 1; k < n; k++)
+            {
+                acc += pt[k] * row_i[k] * row_j[k];
+            }
+            e3 += w * acc;
+        }
+    }
+
+    double norm = fSumPt * fSumPt;
+    result.e2 = e2 / norm;
+    result.e3 = e3 / (norm * fSumPt);
+    if (fabs(result.e2) < 1e-8) return;
+
+    result.C2 = result.e3 / (result.e2 * result.e2);
+    result.D2 = result.e3 / (result.e2 * result.e2 * result.e2);
+}
+
+// Same definition as MITools::JetCharge
+void SubstructureEngine::ComputeCharges(SubstructureResult &result)
+{
+    unsigned int nkappa = fConfig.charge_kappas.size();
+    result.charges.assign(nkappa, 0.);
+    double jetpt = fView.JetPt();
+    const vector<double> &pt = fView.Pt();
+    const vector<double> &q = fView.Charge();
+    for (unsigned int k = 0; k < nkappa; k++)
+    {
+        double kappa = fConfig.charge_kappas[k];
+        double charge = 0.;
+        for (unsigned int i = 0; i < fView.Size(); i++)
+        {
+            if (q[i] != 0) charge += q[i] * pow(pt[i], kappa);
+        }
+        result.charges[k] = charge / pow(jetpt, kappa);
+    }
+}
@@ -18,7 +18,7 @@ import logging
 
 import numpy as np
 
-from jettools import plot_mean_jet, buffer_to_jet, is_signal
+from jettools import plot_mean_jet, buffer_to_jet, is_signal, decode_intensity
 import array
 
 
@@ -152,7 +152,7 @@ if __name__ == '__main__':
 
                 n_entries = df.shape[0]
 
-                pix = df[0]['Intensity'].shape[0]
+                pix = decode_intensity(df[0]).shape[0]
 
                 if not perfectsquare(pix):
                     raise ValueError('shape of image array must be square.')
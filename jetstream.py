@@ -0,0 +1,193 @@
+#!/usr/bin/env python
+'''
+file: jetstream.py
+
+Reads the records that `event-gen --Stream=<path>` writes to a shared ring
+(see event-gen/include/RecordStream.h) as numpy arrays, without copying
+them out of the ring and without any intermediate file.
+
+    from jetstream import JetStream
+
+    with JetStream('/dev/shm/jets') as stream:
+        for batch in stream:
+            images = batch['Intensity'].reshape(-1, 25, 25)
+            train_on(images, batch['LeadingPt'])
+
+Each batch is a numpy structured array that is a view on the ring, one
+field per branch of the EventTree. The records of a batch are handed back
+to event-gen when the next batch is asked for, so a batch must be used (or
+copied) before that. event-gen waits while the ring is full, so a slow
+consumer slows the generation down rather than losing events. The consumer
+leaves its pid in the ring, and event-gen stops once that process is gone
+(or after --StreamTimeout seconds without a free slot).
+
+Run as a script, it reads a stream to the end and reports the rate.
+'''
+
+from argparse import ArgumentParser
+import mmap
+import os
+import time
+import logging
+
+import numpy as np
+
+logging.basicConfig(level=logging.INFO)
+logger = logging.getLogger(__name__)
+
+MAGIC = b'JETRING1'
+LAYOUT_OFFSET = 256
+
+# header: magic, header_size, record_size, nslots, head, tail, done,
+# consumer_pid
+HEADER = np.dtype([('magic', 'S8'),
+                   ('header_size', '<u4'),
+                   ('record_size', '<u4'),
+                   ('nslots', '<u8'),
+                   ('head', '<u8'),
+                   ('tail', '<u8'),
+                   ('done', '<u8'),
+                   ('consumer_pid', '<u8')])
+
+
+class JetStream(object):
+    '''
+    Consumer of an event-gen record stream. Waits up to `timeout` seconds
+    for event-gen to create the ring; `max_batch` caps the records in a
+    batch (default: all that are ready).
+    '''
+    def __init__(self, path, timeout=60., max_batch=None, poll=0.0005):
+        self.path = path
+        self.max_batch = max_batch
+        self.poll = poll
+        self._pending = 0
+
+        self._map = self._open(path, timeout)
+        self._header = np.ndarray((), dtype=HEADER, buffer=self._map)
+        # head, tail, done as one aligned word each
+        self._counters = np.ndarray((3, ), dtype='<u8', buffer=self._map,
+                                    offset=HEADER.fields['head'][1])
+        # event-gen stops waiting for a free slot once this process is gone
+        self._header['consumer_pid'] = os.getpid()
+
+        header_size = int(self._header['header_size'])
+        record_size = int(self._header['record_size'])
+        self.nslots = int(self._header['nslots'])
+
+        self.dtype = self._layout(header_size, record_size)
+        self.ring = np.ndarray((self.nslots, ), dtype=self.dtype,
+                               buffer=self._map, offset=header_size)
+
+    @staticmethod
+    def _open(path, timeout):
+        start = time.time()
+        while True:
+            try:
+                with open(path, 'r+b') as f:
+                    size = os.fstat(f.fileno()).st_size
+                    if size > LAYOUT_OFFSET:
+                        m = mmap.mmap(f.fileno(), size)
+                        if m[:len(MAGIC)] == MAGIC:
+                            return m
+                        m.close()
+            except (IOError, OSError):
+                pass
+            if time.time() - start > timeout:
+                raise IOError('no event-gen stream at {}'.format(path))
+            time.sleep(0.05)
+
+    def _layout(self, header_size, record_size):
+        text = self._map[LAYOUT_OFFSET:header_size].split(b'\0')[0].decode()
+        names, formats, offsets = [], [], []
+        for line in text.splitlines():
+            name, kind, offset, count = line.split()
+            names.append(name)
+            formats.append((kind, (int(count), )) if int(count) != 1 else kind)
+            offsets.append(int(offset))
+        return np.dtype({'names': names, 'formats': formats,
+                         'offsets': offsets, 'itemsize': record_size})
+
+    def _release(self):
+        if self._pending:
+            # an aligned 8 byte store, seen whole by event-gen
+            self._counters[1] += self._pending
+            self._pending = 0
+
+    @property
+    def done(self):
+        '''True once event-gen has finished and every record was read.'''
+        head, tail, done = [int(c) for c in self._counters]
+        return bool(done) and head == tail + self._pending
+
+    def next_batch(self):
+        '''
+        The next records as a view on the ring, None at the end of the
+        stream. Hands the records of the previous batch back to event-gen.
+        '''
+        self._release()
+        while True:
+            # done before head: no record can come after a done we saw
+            done = bool(self._counters[2])
+            head = int(self._counters[0])
+            tail = int(self._counters[1])
+            if head > tail:
+                break
+            if done:
+                return None
+            time.sleep(self.poll)
+
+        start = tail % self.nslots
+        n = min(head - tail, self.nslots - start)
+        if self.max_batch is not None:
+            n = min(n, self.max_batch)
+        self._pending = n
+        return self.ring[start:start + n]
+
+    def __iter__(self):
+        while True:
+            batch = self.next_batch()
+            if batch is None:
+                return
+            yield batch
+
+    def close(self):
+        self._release()
+        self.ring = None
+        self._header = None
+        self._counters = None
+        try:
+            self._map.close()
+        except BufferError:
+            # batches still in use keep the ring mapped until they go
+            pass
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *args):
+        self.close()
+
+
+if __name__ == '__main__':
+    parser = ArgumentParser()
+    parser.add_argument('path', help='ring file given to event-gen --Stream')
+    parser.add_argument('--timeout', default=60., type=float,
+                        help='seconds to wait for event-gen to start')
+    parser.add_argument('--unlink', action='store_true',
+                        help='remove the ring file at the end of the stream')
+    args = parser.parse_args()
+
+    with JetStream(args.path, timeout=args.timeout) as stream:
+        logger.info('{} slots of {} bytes, fields: {}'.format(
+            stream.nslots, stream.dtype.itemsize, ', '.join(stream.dtype.names)))
+        start = time.time()
+        n = 0
+        for batch in stream:
+            n += len(batch)
+        elapsed = time.time() - start
+        logger.info('{} records in {:.1f} s, {:.0f} records/s, {:.1f} MB/s'.format(
+            n, elapsed, n / max(elapsed, 1e-9),
+            n * stream.dtype.itemsize / 1e6 / max(elapsed, 1e-9)))
+
+    if args.unlink:
+        os.remove(args.path)
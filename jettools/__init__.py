@@ -3,7 +3,10 @@ Import control for jet simulations.
 '''
 from .jettools import plot_jet, plot_mean_jet
 from .processing import buffer_to_jet, is_signal
+from .encoding import decode_intensity, reconstruction_error
 __all__ = ['plot_jet',
            'plot_mean_jet',
            'buffer_to_jet',
-           'is_signal']
\ No newline at end of file
+           'is_signal',
+           'decode_intensity',
+           'reconstruction_error']
\ No newline at end of file
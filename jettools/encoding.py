@@ -0,0 +1,78 @@
+'''
+file: encoding.py
+
+Decoding of the jet images that event-gen stores with --ImageEncoding
+(see event-gen/include/ImageCodec.h). The branch name gives the encoding:
+
+    Intensity          float32
+    Intensity_f16      float16
+    Intensity_log16    log-scaled uint16
+    Intensity_u8       uint8, with the per-image IntensityScale
+
+The images of --Images (ImageSet) use the same suffixes on their own names,
+e.g. Image_40x40_R1p2_f16; pass that name to decode them.
+
+decode_intensity repeats the arithmetic of ImageCodec::Decode, so it gives
+the same float32 values as the C++ side.
+'''
+import numpy as np
+
+# ImageCodec::log_min, log_max, log_step
+LOG16_MIN = 1e-4
+LOG16_MAX = 1e5
+LOG16_STEP = (np.log(LOG16_MAX) - np.log(LOG16_MIN)) / 65534.
+
+ENCODINGS = {'': 'float32',
+             '_f16': 'float16',
+             '_log16': 'log-uint16',
+             '_u8': 'uint8'}
+
+
+def image_encoding(entry, name='Intensity'):
+    '''
+    Name of the encoding of the image called name in an entry (or array of
+    entries) from an event-gen EventTree, None if it has no such image.
+    '''
+    for suffix, encoding in ENCODINGS.items():
+        if name + suffix in entry.dtype.names:
+            return encoding
+    return None
+
+
+def decode_intensity(entry, name='Intensity'):
+    '''
+    The float32 image(s) called name of an entry, or of a structured array of
+    entries, from an event-gen EventTree, whatever encoding they were stored
+    with.
+    '''
+    names = entry.dtype.names
+    if name in names:
+        return np.asarray(entry[name], dtype=np.float32)
+
+    if name + '_f16' in names:
+        codes = np.asarray(entry[name + '_f16'], dtype=np.uint16)
+        return codes.view(np.float16).astype(np.float32)
+
+    if name + '_log16' in names:
+        codes = np.asarray(entry[name + '_log16']).astype(np.int64)
+        values = LOG16_MIN * np.exp((codes - 1) * LOG16_STEP)
+        return np.where(codes == 0, 0., values).astype(np.float32)
+
+    if name + '_u8' in names:
+        codes = np.asarray(entry[name + '_u8']).astype(np.float32)
+        scale = np.asarray(entry[name + 'Scale'], dtype=np.float32)
+        return codes * scale[..., np.newaxis]
+
+    raise ValueError('entry has no image ' + name)
+
+
+def reconstruction_error(image, decoded):
+    '''
+    Relative L2 error |decoded - image| / |image| of each image (along the
+    last axis), as event-gen reports it.
+    '''
+    image = np.asarray(image, dtype=np.float64)
+    decoded = np.asarray(decoded, dtype=np.float64)
+    norm = np.linalg.norm(image, axis=-1)
+    diff = np.linalg.norm(decoded - image, axis=-1)
+    return np.where(norm > 0, diff / np.where(norm > 0, norm, 1.), 0.)
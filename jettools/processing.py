@@ -8,6 +8,7 @@ Simple utilities for processing the junk that comes out of the ntuple event gene
 import numpy.linalg as la
 import numpy as np
 from .jettools import rotate_jet, flip_jet, plot_mean_jet
+from .encoding import decode_intensity
 
 
 
@@ -27,7 +28,7 @@ def buffer_to_jet(entry, tag = 0, side = 'r', max_entry = None, pix = 25):
     jet image we want the highest energy.
 
     The `entry` must have the following fields (as produced by event-gen)
-        * Intensity
+        * Intensity (or one of its encoded forms, see decode_intensity)
         * PCEta, PCPhi
         * LeadingPt
         * LeadingEta
@@ -52,7 +53,7 @@ def buffer_to_jet(entry, tag = 0, side = 'r', max_entry = None, pix = 25):
     if (-np.sin(angle) * e + np.cos(angle) * p) > 0:
         angle += -4.0 * np.arctan(1.0)
 
-    image = flip_jet(rotate_jet(np.array(entry['Intensity']), -angle, normalizer=4000.0, dim=pix), side)
+    image = flip_jet(rotate_jet(decode_intensity(entry), -angle, normalizer=4000.0, dim=pix), side)
     e_norm = np.linalg.norm(image)
     return ((image / e_norm).astype('float32'), np.float32(tag), 
         np.float32(entry['LeadingPt']), np.float32(entry['LeadingEta']), 